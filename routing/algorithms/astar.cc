@@ -0,0 +1,158 @@
+#include "algorithms/astar.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::Edge;
+using graph::VertexID;
+using graph::Weight;
+
+namespace {
+
+using Index = CsrGraph::Index;
+
+constexpr double kRadiansPerDegree = M_PI / 180.0;
+
+// Settles the vertices by their cost plus their estimate, until the target
+// comes out. The bound is consistent, so a vertex is final when it is popped,
+// and the keys popped never decrease, as the radix heap requires. Returns the
+// cost of the target, or kInfiniteWeight.
+template <typename Queue>
+Weight Search(const CsrGraph &graph, const TravelTimeBound &bound, Index source,
+              Index target, AStarWorkspace *workspace, Queue *q, size_t *num_settled) {
+  DijkstraWorkspace &search = workspace->search();
+
+  workspace->set_estimate(source, bound.Estimate(source, target));
+  q->Push(source, workspace->estimate(source));
+
+  while (!q->empty()) {
+    QueueEntry elected = q->Pop();
+    Index current      = elected.vertex;
+    Weight cost        = search.score(current);
+    // The queues that push a vertex again when it improves leave stale entries
+    // behind, with a key above the current one of their vertex.
+    if (elected.key != graph::AddWeights(cost, workspace->estimate(current))) {
+      continue;
+    }
+    ++*num_settled;
+    if (current == target) {
+      return cost;
+    }
+
+    for (Index arc = graph.out_begin(current); arc < graph.out_end(current); ++arc) {
+      Index neighbor       = graph.out_head(arc);
+      Weight neighbor_cost = search.score(neighbor);
+      Weight updated_cost  = graph::AddWeights(cost, graph.out_weight(arc));
+      if (updated_cost >= neighbor_cost) {
+        continue;
+      }
+      // The estimate is computed once, when the vertex is first reached.
+      if (neighbor_cost == graph::kInfiniteWeight) {
+        workspace->set_estimate(neighbor, bound.Estimate(neighbor, target));
+      }
+      search.Relax(neighbor, updated_cost, graph.out_edge(arc));
+      q->Push(neighbor, graph::AddWeights(updated_cost, workspace->estimate(neighbor)));
+    }
+  }
+  return graph::kInfiniteWeight;
+}
+
+}  // namespace
+
+TravelTimeBound TravelTimeBound::Create(const CsrGraph &graph) {
+  TravelTimeBound bound;
+
+  const size_t n = graph.num_vertices();
+  bound.lats_.reserve(n);
+  bound.lons_.reserve(n);
+  bound.cos_lats_.reserve(n);
+  for (Index v = 0; v < n; ++v) {
+    const osmium::Location &location = graph.vertex(v).loc();
+    if (!location.valid()) {
+      spdlog::warn("TravelTimeBound: Vertex {} has no location, the bound is disabled.",
+                   graph.vertex(v).id());
+      return TravelTimeBound();
+    }
+    double lat = location.lat() * kRadiansPerDegree;
+    bound.lats_.emplace_back(lat);
+    bound.lons_.emplace_back(location.lon() * kRadiansPerDegree);
+    bound.cos_lats_.emplace_back(std::cos(lat));
+  }
+
+  // The fastest edge sets the scale. The edges without a length, which cost
+  // nothing anyway, are left out.
+  double weights_per_meter = std::numeric_limits<double>::infinity();
+  for (Index v = 0; v < n; ++v) {
+    for (Index arc = graph.out_begin(v); arc < graph.out_end(v); ++arc) {
+      double length = graph.out_edge(arc).length();
+      if (length > 0.0) {
+        weights_per_meter = std::min(weights_per_meter, graph.out_weight(arc) / length);
+      }
+    }
+  }
+  if (std::isinf(weights_per_meter)) {
+    return TravelTimeBound();
+  }
+  // Shaved a little, so that the rounding of the distances cannot make the
+  // bound overestimate.
+  bound.weights_per_meter_ = weights_per_meter * (1.0 - 1e-9);
+  return bound;
+}
+
+Route RunAStar(const CsrGraph &graph, const TravelTimeBound &bound, VertexID source,
+               VertexID target, AStarWorkspace *workspace) {
+  Route route;
+
+  Index source_index = graph.FindIndex(source);
+  if (source_index == CsrGraph::kInvalidIndex) {
+    spdlog::critical("RunAStar(): Cannot find vertex with ID = {}", source);
+    return route;
+  }
+  Index target_index = graph.FindIndex(target);
+  if (target_index == CsrGraph::kInvalidIndex) {
+    spdlog::critical("RunAStar(): Cannot find vertex with ID = {}", target);
+    return route;
+  }
+
+  workspace->Reset(graph.numbering(), source_index);
+  DijkstraWorkspace &search = workspace->search();
+  switch (search.queue_type()) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      route.cost = Search(graph, bound, source_index, target_index, workspace,
+                          &search.lazy_binary_heap(), &route.num_settled);
+      break;
+    case PriorityQueueType::kIndexedFourAryHeap:
+      route.cost = Search(graph, bound, source_index, target_index, workspace,
+                          &search.four_ary_heap(), &route.num_settled);
+      break;
+    case PriorityQueueType::kRadixHeap:
+      route.cost = Search(graph, bound, source_index, target_index, workspace,
+                          &search.radix_heap(), &route.num_settled);
+      break;
+  }
+  if (!route.found()) {
+    return route;
+  }
+
+  for (Index v = target_index; v != source_index;) {
+    const Edge &edge = search.parent(v);
+    route.edges.push_back(&edge);
+    v = edge.from().index();
+  }
+  std::reverse(route.edges.begin(), route.edges.end());
+  return route;
+}
+
+Route RunAStar(const CsrGraph &graph, const TravelTimeBound &bound, VertexID source,
+               VertexID target) {
+  AStarWorkspace workspace;
+  return RunAStar(graph, bound, source, target, &workspace);
+}
+
+}  // namespace open_semap
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "algorithms/dijkstra.h"
+#include "algorithms/priority_queue.h"
+#include "algorithms/route.h"
+#include "graph/csr_graph.h"
+#include "graph/defs.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// A lower bound of the travel time between two vertices of a CsrGraph: the
+// great-circle distance between them, at the fastest speed found on any edge
+// of the graph. The coordinates are kept in flat arrays by CSR index, in
+// radians, so that the bound only costs a few multiplications and a sqrt() and
+// asin(). Built once per graph, and shared by the queries.
+//
+// The lengths of the edges are at least the distance between their ends, and
+// their weights at least their lengths at the fastest speed, so the bound never
+// overestimates. It is also consistent: going over an edge never lowers it by
+// more than the weight of the edge.
+class TravelTimeBound {
+ public:
+  // A bound that is always 0, which turns RunAStar() into Dijkstra.
+  TravelTimeBound() = default;
+
+  // The bound is 0 if a vertex of the graph has no valid location.
+  static TravelTimeBound Create(const graph::CsrGraph &graph);
+
+  // The fastest speed of the graph, in weights per meter. 0 if the bound is
+  // disabled.
+  double weights_per_meter() const { return weights_per_meter_; }
+
+  inline graph::Weight Estimate(graph::VertexIndex from, graph::VertexIndex to) const {
+    if (weights_per_meter_ == 0.0) {
+      return 0;
+    }
+    // The haversine formula, as osmium::geom::haversine::distance().
+    double lat_sin = std::sin((lats_[from] - lats_[to]) * 0.5);
+    double lon_sin = std::sin((lons_[from] - lons_[to]) * 0.5);
+    double cosines = cos_lats_[from] * cos_lats_[to];
+    double h       = lat_sin * lat_sin + cosines * lon_sin * lon_sin;
+    double meters  = 2.0 * kEarthRadius * std::asin(std::sqrt(std::min(h, 1.0)));
+    return static_cast<graph::Weight>(meters * weights_per_meter_);
+  }
+
+ private:
+  // The same radius as osmium, so that the bound matches the lengths of the
+  // edges.
+  static constexpr double kEarthRadius = 6372797.560856;
+
+  double weights_per_meter_ = 0.0;
+  std::vector<double> lats_{};
+  std::vector<double> lons_{};
+  std::vector<double> cos_lats_{};
+};
+
+// The memory of RunAStar(), to be reused over the queries in the same way as
+// DijkstraWorkspace.
+class AStarWorkspace {
+ public:
+  explicit AStarWorkspace(PriorityQueueType queue_type = PriorityQueueType::kRadixHeap)
+      : search_(queue_type) {}
+
+  DijkstraWorkspace &search() { return search_; }
+
+  // The estimate of the vertex, computed when it is first reached. Only for the
+  // vertices reached by the current search.
+  graph::Weight estimate(graph::VertexIndex index) const { return estimates_[index]; }
+
+  void set_estimate(graph::VertexIndex index, graph::Weight estimate) {
+    estimates_[index] = estimate;
+  }
+
+  // Prepares the workspace for a search from the start.
+  void Reset(const graph::VertexNumbering &numbering, graph::VertexIndex start) {
+    search_.Reset(numbering, start);
+    if (estimates_.size() < numbering.size()) {
+      estimates_.resize(numbering.size());
+    }
+  }
+
+ private:
+  DijkstraWorkspace search_;
+  std::vector<graph::Weight> estimates_{};
+};
+
+// Finds the shortest route from the source to the target with A*: the vertices
+// are settled by their cost plus the bound of what is left to the target, so
+// the search heads for the target instead of growing a ball around the source.
+// Meant for the one-off queries on a graph that is not contracted.
+//
+// Returns a route that is not found(), after logging, if the source or the
+// target is not in the graph.
+Route RunAStar(const graph::CsrGraph &graph, const TravelTimeBound &bound,
+               graph::VertexID source, graph::VertexID target, AStarWorkspace *workspace);
+
+Route RunAStar(const graph::CsrGraph &graph, const TravelTimeBound &bound,
+               graph::VertexID source, graph::VertexID target);
+
+}  // namespace open_semap
@@ -0,0 +1,169 @@
+#include "algorithms/bidirectional_dijkstra.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::Edge;
+using graph::VertexID;
+using graph::Weight;
+
+namespace {
+
+using Index = CsrGraph::Index;
+
+// The state of one side of the search.
+template <typename Queue>
+struct Side {
+  DijkstraWorkspace *workspace;
+  Queue *queue;
+  // The key of the last settled vertex. Everything left in the queue costs at
+  // least as much.
+  Weight radius = 0;
+};
+
+// Settles the next vertex of the side and relaxes its arcs, the outgoing ones
+// forward and the incoming ones backward. Whenever a vertex is reached that the
+// other side has reached too, the route through it is a candidate for the
+// best, which is kept in best_cost and meeting. Returns false if the side has
+// run out of vertices.
+template <bool kForward, typename Queue>
+bool Step(const CsrGraph &graph, Side<Queue> *side, const DijkstraWorkspace &other,
+          Weight *best_cost, Index *meeting, size_t *num_settled) {
+  DijkstraWorkspace *workspace = side->workspace;
+
+  // The queues that push a vertex again when it improves leave stale entries
+  // behind, with a key above the score of their vertex.
+  QueueEntry elected{};
+  do {
+    if (side->queue->empty()) {
+      return false;
+    }
+    elected = side->queue->Pop();
+  } while (elected.key != workspace->score(elected.vertex));
+
+  side->radius = elected.key;
+  ++*num_settled;
+
+  Index current = elected.vertex;
+  Index end     = kForward ? graph.out_end(current) : graph.in_end(current);
+  for (Index arc = kForward ? graph.out_begin(current) : graph.in_begin(current);
+       arc < end; ++arc) {
+    Index neighbor      = kForward ? graph.out_head(arc) : graph.in_tail(arc);
+    Weight weight       = kForward ? graph.out_weight(arc) : graph.in_weight(arc);
+    Weight updated_cost = graph::AddWeights(elected.key, weight);
+    if (updated_cost >= workspace->score(neighbor)) {
+      continue;
+    }
+    workspace->Relax(neighbor, updated_cost,
+                     kForward ? graph.out_edge(arc) : graph.in_edge(arc));
+    side->queue->Push(neighbor, updated_cost);
+
+    Weight through = graph::AddWeights(updated_cost, other.score(neighbor));
+    if (through < *best_cost) {
+      *best_cost = through;
+      *meeting   = neighbor;
+    }
+  }
+  return true;
+}
+
+template <typename Queue>
+void Search(const CsrGraph &graph, Index source, Index target,
+            BidirectionalWorkspace *workspace, Queue *forward_queue,
+            Queue *backward_queue, Route *route, Index *meeting) {
+  Side<Queue> forward{&workspace->forward, forward_queue};
+  Side<Queue> backward{&workspace->backward, backward_queue};
+  forward_queue->Push(source, 0);
+  backward_queue->Push(target, 0);
+
+  // Each side stops as soon as it runs out of vertices: by then it has
+  // reached all it can, the other end included if there is a route.
+  bool forward_turn = true;
+  while (graph::AddWeights(forward.radius, backward.radius) < route->cost) {
+    bool stepped =
+        forward_turn
+            ? Step<true>(graph, &forward, workspace->backward, &route->cost, meeting,
+                         &route->num_settled)
+            : Step<false>(graph, &backward, workspace->forward, &route->cost, meeting,
+                          &route->num_settled);
+    if (!stepped) {
+      break;
+    }
+    forward_turn = forward.radius <= backward.radius;
+  }
+}
+
+}  // namespace
+
+Route RunBidirectionalDijkstra(const CsrGraph &graph, VertexID source, VertexID target,
+                               BidirectionalWorkspace *workspace) {
+  Route route;
+
+  Index source_index = graph.FindIndex(source);
+  if (source_index == CsrGraph::kInvalidIndex) {
+    spdlog::critical("RunBidirectionalDijkstra(): Cannot find vertex with ID = {}",
+                     source);
+    return route;
+  }
+  Index target_index = graph.FindIndex(target);
+  if (target_index == CsrGraph::kInvalidIndex) {
+    spdlog::critical("RunBidirectionalDijkstra(): Cannot find vertex with ID = {}",
+                     target);
+    return route;
+  }
+  if (source_index == target_index) {
+    route.cost = 0;
+    return route;
+  }
+
+  DijkstraWorkspace &forward  = workspace->forward;
+  DijkstraWorkspace &backward = workspace->backward;
+  forward.Reset(graph.numbering(), source_index);
+  backward.Reset(graph.numbering(), target_index);
+
+  Index meeting = CsrGraph::kInvalidIndex;
+  switch (forward.queue_type()) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      Search(graph, source_index, target_index, workspace, &forward.lazy_binary_heap(),
+             &backward.lazy_binary_heap(), &route, &meeting);
+      break;
+    case PriorityQueueType::kIndexedFourAryHeap:
+      Search(graph, source_index, target_index, workspace, &forward.four_ary_heap(),
+             &backward.four_ary_heap(), &route, &meeting);
+      break;
+    case PriorityQueueType::kRadixHeap:
+      Search(graph, source_index, target_index, workspace, &forward.radix_heap(),
+             &backward.radix_heap(), &route, &meeting);
+      break;
+  }
+  if (!route.found()) {
+    return route;
+  }
+
+  // The forward parents lead from the meeting vertex back to the source, and
+  // the backward ones from the meeting vertex on to the target.
+  for (Index v = meeting; v != source_index;) {
+    const Edge &edge = forward.parent(v);
+    route.edges.push_back(&edge);
+    v = edge.from().index();
+  }
+  std::reverse(route.edges.begin(), route.edges.end());
+  for (Index v = meeting; v != target_index;) {
+    const Edge &edge = backward.parent(v);
+    route.edges.push_back(&edge);
+    v = edge.to().index();
+  }
+  return route;
+}
+
+Route RunBidirectionalDijkstra(const CsrGraph &graph, VertexID source, VertexID target) {
+  BidirectionalWorkspace workspace;
+  return RunBidirectionalDijkstra(graph, source, target, &workspace);
+}
+
+}  // namespace open_semap
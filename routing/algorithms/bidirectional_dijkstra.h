@@ -0,0 +1,39 @@
+#pragma once
+
+#include "algorithms/dijkstra.h"
+#include "algorithms/priority_queue.h"
+#include "algorithms/route.h"
+#include "graph/csr_graph.h"
+#include "graph/defs.h"
+
+namespace open_semap {
+
+// The memory of the two searches of RunBidirectionalDijkstra(), to be reused
+// over the queries in the same way as DijkstraWorkspace.
+struct BidirectionalWorkspace {
+  explicit BidirectionalWorkspace(
+      PriorityQueueType queue_type = PriorityQueueType::kRadixHeap)
+      : forward(queue_type), backward(queue_type) {}
+
+  // Searches from the source on the outgoing arcs.
+  DijkstraWorkspace forward;
+  // Searches from the target on the incoming arcs.
+  DijkstraWorkspace backward;
+};
+
+// Finds the shortest route from the source to the target, searching forward
+// from the source and backward from the target at the same time. The side with
+// the smaller radius (the cost of its last settled vertex) goes next, so the
+// two balls grow evenly, and the search stops as soon as the two radii add up
+// to the best route seen through a vertex reached by both sides. On long
+// queries that settles about half as many vertices as RunDijkstra().
+//
+// Returns a route that is not found(), after logging, if the source or the
+// target is not in the graph.
+Route RunBidirectionalDijkstra(const graph::CsrGraph &graph, graph::VertexID source,
+                               graph::VertexID target, BidirectionalWorkspace *workspace);
+
+Route RunBidirectionalDijkstra(const graph::CsrGraph &graph, graph::VertexID source,
+                               graph::VertexID target);
+
+}  // namespace open_semap
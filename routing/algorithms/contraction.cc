@@ -1,8 +1,6 @@
 #include "algorithms/contraction.h"
 
 #include <algorithm>
-#include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 #include "algorithms/dijkstra.h"
@@ -20,6 +18,30 @@ using graph::RoadGraph;
 using graph::SimpleIndexer;
 using graph::Vertex;
 using graph::VertexID;
+using graph::VertexIndex;
+
+const Edge &Shortcuts::Create(const Edge &a, const Edge &b) {
+  const Edge &edge = *edges_.Create(a, b);
+  shortcuts_.emplace_back(
+      Shortcut{edge.from().index(), edge.to().index(), edge.cost(), a.to().index()});
+  return edge;
+}
+
+void Shortcuts::Append(Shortcuts &&other) {
+  edges_.Append(std::move(other.edges_));
+  shortcuts_.insert(shortcuts_.end(), other.shortcuts_.begin(), other.shortcuts_.end());
+  other.shortcuts_.clear();
+  contraction_order_.insert(contraction_order_.end(), other.contraction_order_.begin(),
+                            other.contraction_order_.end());
+  other.contraction_order_.clear();
+}
+
+void Shortcuts::ReleaseEdges() { edges_.Clear(); }
+
+size_t Shortcuts::used_memory() const {
+  return shortcuts_.capacity() * sizeof(Shortcut) + edges_.capacity_bytes() +
+         contraction_order_.capacity() * sizeof(VertexIndex);
+}
 
 struct SingleContractionPlan {
   // The connection info about the vertex of interest (called the center). The
@@ -31,7 +53,7 @@ struct SingleContractionPlan {
       planned;
 
   // Returns the number of shortcuts generated.
-  size_t CarryOut(SimpleIndexer *indexer, std::vector<std::unique_ptr<Edge>> *shortcuts) {
+  size_t CarryOut(SimpleIndexer *indexer, Shortcuts *shortcuts) {
     if (center == nullptr) {
       // Do not carry a plan twice. When a plan is carried out, center will be
       // set to nullptr.
@@ -39,11 +61,11 @@ struct SingleContractionPlan {
     }
 
     for (const auto &item : planned) {
-      shortcuts->emplace_back(
-          std::make_unique<Edge>(item.first.get(), item.second.get()));
       // NOTE(breakds): This may coexist with the origianl non-shortcut edge.
-      indexer->AddEdge(*shortcuts->back());
+      indexer->AddEdge(shortcuts->Create(item.first.get(), item.second.get()));
     }
+    // The connection info goes away with the vertex.
+    shortcuts->MarkContracted(center->vertex.get().index());
     indexer->RemoveVertex(center->vertex.get().id());
     size_t num_generated = planned.size();
 
@@ -66,47 +88,83 @@ struct SingleContractionPlan {
   }
 };
 
+// Whether the edge is the lightest of the edges in the list that share its
+// other end, the first of them on a tie. The others cannot be on a shortest
+// path, so no shortcut is planned over them.
+template <typename OtherEnd>
+static bool IsLightestParallel(
+    const Edge &edge, const std::vector<std::reference_wrapper<const Edge>> &edges,
+    const OtherEnd &other_end) {
+  for (const auto &item : edges) {
+    const Edge &other = item.get();
+    if (&other == &edge) {
+      return true;
+    }
+    if (&other_end(other) == &other_end(edge) && other.cost() <= edge.cost()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Plans a shortcut start -> center -> goal only if every path from start to
+// goal that avoids the center costs strictly more. So a witness of equal cost,
+// e.g. around the other corner of a square of a grid, or an existing edge or
+// shortcut start -> goal that is not heavier, rules the shortcut out.
+//
+// The searches run in the workspace, which is shared by all the dry runs of a
+// contraction so that they do not allocate.
 static SingleContractionPlan DryRunContraction(const SimpleIndexer &indexer,
-                                               const ConnectionInfo &conn) {
-  VertexID center_vertex_id = conn.vertex.get().id();
+                                               const ConnectionInfo &conn,
+                                               DijkstraWorkspace *workspace) {
+  VertexIndex center_index = conn.vertex.get().index();
 
   SingleContractionPlan plan;
   plan.center = &conn;
 
-  std::unordered_set<graph::VertexID> goal_ids;
+  auto from_of = [](const Edge &edge) -> const Vertex & { return edge.from(); };
+  auto to_of   = [](const Edge &edge) -> const Vertex & { return edge.to(); };
+
+  // The goals are the same for all the searches below, so they are marked once
+  // in the workspace instead of copied into a set for each of them.
+  const graph::VertexNumbering &numbering = *indexer.numbering();
+  workspace->ClearGoals(numbering.size());
+  graph::Weight max_outward_cost = 0;
   for (const auto &outgoing : conn.outwards) {
-    goal_ids.emplace(outgoing.get().to().id());
+    workspace->AddGoal(outgoing.get().to().index());
+    max_outward_cost = std::max(max_outward_cost, outgoing.get().cost());
   }
 
-  // Going over all the vertices on the start side, and run Dijkstra to try to
-  // reach the vertices on the other side. All the shortest path that uses
-  // only the center vertex is going to be contracted.
-  for (const auto &incoming : conn.inwards) {
-    VertexID start = incoming.get().from().id();
-
-    // NOTE(breakds): There is no chance that the outgoing vertices
-    // can not be reached from start. This is because any of the
-    // starts can at least reach all of the outgoing vertices via
-    // center vertex (the input to this function).
-    SearchTree tree          = RunDijkstra(indexer, start, goal_ids);
-    const SearchNode *center = tree.Find(center_vertex_id);
-    // If the center vertex does not even appear in the search tree, no
-    // shortcut can be added for this start vertex. Or, if the center vertex
-    // isn't directly reached by the start vertex, no shortcut as well.
-    if (center == nullptr || center->edge().from().id() != start) {
+  // Going over all the vertices on the start side, and run Dijkstra without
+  // the center to look for a witness path to each of the vertices on the other
+  // side. The goals without one get a shortcut.
+  for (const auto &incoming_ref : conn.inwards) {
+    const Edge &incoming = incoming_ref.get();
+    if (!IsLightestParallel(incoming, conn.inwards, from_of)) {
       continue;
     }
+    VertexID start = incoming.from().id();
+
+    // No path through the center costs more than the limit, so the search
+    // does not need to go further to tell the witnesses from the shortcuts.
+    graph::Weight limit = graph::AddWeights(incoming.cost(), max_outward_cost);
 
-    // Add shortcut for via-center reached goals.
-    for (VertexID goal_id : goal_ids) {
-      const SearchNode *goal = tree.Find(goal_id);
-      if (goal == nullptr) {
+    // On a two-way road the start is also one of the goals, which the search
+    // does not wait for.
+    RunDijkstraToMarkedGoals(indexer, start, workspace, limit, center_index);
+
+    for (const auto &outgoing_ref : conn.outwards) {
+      const Edge &outgoing = outgoing_ref.get();
+      if (&outgoing.to() == &incoming.from() ||
+          !IsLightestParallel(outgoing, conn.outwards, to_of)) {
         continue;
       }
-      if (goal->edge().from().id() == center_vertex_id) {
-        // In this case, start -> center -> goal appear in the Dijkstra search
-        // tree, suggesting a valid shortcut.
-        plan.planned.emplace_back(center->edge(), goal->edge());
+      // Every vertex within the limit is settled, so the score of the goal is
+      // either its exact cost without the center or above the via cost.
+      graph::Weight via     = graph::AddWeights(incoming.cost(), outgoing.cost());
+      graph::Weight witness = workspace->score(outgoing.to().index());
+      if (witness > via) {
+        plan.planned.emplace_back(incoming, outgoing);
       }
     }
   }
@@ -114,14 +172,15 @@ static SingleContractionPlan DryRunContraction(const SimpleIndexer &indexer,
   return plan;
 }
 
-std::vector<std::unique_ptr<Edge>> ContractVertices(
-    const std::vector<graph::VertexID> &ordered_vertex_ids, SimpleIndexer *indexer) {
-  std::vector<std::unique_ptr<Edge>> shortcuts;
+Shortcuts ContractVertices(const std::vector<graph::VertexID> &ordered_vertex_ids,
+                           SimpleIndexer *indexer) {
+  Shortcuts shortcuts;
+  DijkstraWorkspace workspace;
 
   for (VertexID id : ordered_vertex_ids) {
     const ConnectionInfo *conn = indexer->Find(id);
     if (conn != nullptr) {
-      SingleContractionPlan plan = DryRunContraction(*indexer, *conn);
+      SingleContractionPlan plan = DryRunContraction(*indexer, *conn, &workspace);
       plan.CarryOut(indexer, &shortcuts);
     }
   }
@@ -152,28 +211,34 @@ struct RankingInfo {
   double extra               = 0.0;
 };  // namespace open_semap
 
-void FetchNeighborVertexIDs(const ConnectionInfo &conn,
-                            std::vector<VertexID> *neighbors) {
+void FetchNeighborIndices(const ConnectionInfo &conn,
+                          std::vector<VertexIndex> *neighbors) {
   neighbors->clear();
   for (const auto &item : conn.inwards) {
-    neighbors->emplace_back(item.get().from().id());
+    neighbors->emplace_back(item.get().from().index());
   }
   for (const auto &item : conn.outwards) {
-    neighbors->emplace_back(item.get().to().id());
+    neighbors->emplace_back(item.get().to().index());
   }
 }
 
-std::vector<std::unique_ptr<graph::Edge>> ContractGraph(graph::SimpleIndexer *indexer,
-                                                        bool print_debug_info) {
+Shortcuts ContractGraph(graph::SimpleIndexer *indexer, bool print_debug_info) {
   if (print_debug_info && indexer->connections().size() > 20) {
     spdlog::warn(
         "ContractGraph: You asked to print debug info but the graph is too big to do "
         "so. Will ignore 'print_debug_info'.");
   }
 
+  if (indexer->numbering() == nullptr) {
+    spdlog::critical("ContractGraph: The indexer is not created from a graph.");
+    std::abort();
+  }
+
   // The owner of the created shortcuts. Will be returned and
   // transferred to the caller.
-  std::vector<std::unique_ptr<Edge>> shortcuts;
+  Shortcuts shortcuts;
+
+  DijkstraWorkspace workspace;
 
   // A priority queue that ranks the remaining vertices by their
   // score. It gives the next vertex to contract.
@@ -190,81 +255,96 @@ std::vector<std::unique_ptr<graph::Edge>> ContractGraph(graph::SimpleIndexer *in
   // but not in the `rankings` (because updating the heap is costly).
   // However, when a vertex is popped from the heap, it will have to
   // be compared with the scoreboard.
-  std::unordered_map<VertexID, RankingInfo> scoreboard;
-
-  // Initialize the rankings with the edege difference of each vertex.
-  for (const auto &item : indexer->connections()) {
-    const ConnectionInfo *conn = item.second.get();
-    SingleContractionPlan plan = DryRunContraction(*indexer, *conn);
+  //
+  // The scoreboard is indexed by Vertex::index(). The entries of the
+  // contracted vertices (and the ones not in the indexer) have a null
+  // conn.
+  std::vector<RankingInfo> scoreboard(indexer->numbering()->size(),
+                                      RankingInfo(nullptr, 0.0));
+
+  // Initialize the rankings with the edege difference of each vertex. They are
+  // seeded in the order of Vertex::index() rather than the order of the hash
+  // map, so that the ties are broken the same way on every run.
+  const graph::VertexNumbering &numbering = *indexer->numbering();
+  for (VertexIndex index = 0; index < numbering.size(); ++index) {
+    auto iter = indexer->connections().find(numbering.id(index));
+    if (iter == indexer->connections().end()) {
+      continue;
+    }
+    const ConnectionInfo *conn = iter->second.get();
+    SingleContractionPlan plan = DryRunContraction(*indexer, *conn, &workspace);
     double edge_diff           = plan.ComputeEdgeDifference();
     rankings.emplace_back(conn, edge_diff);
-    scoreboard.emplace(std::piecewise_construct,
-                       std::forward_as_tuple(conn->vertex.get().id()),
-                       std::forward_as_tuple(conn, edge_diff));
+    scoreboard[conn->vertex.get().index()] = RankingInfo(conn, edge_diff);
   }
   std::make_heap(rankings.begin(), rankings.end());
 
-  std::vector<VertexID> neighbors;
+  std::vector<VertexIndex> neighbors;
 
   while (!rankings.empty()) {
     std::pop_heap(rankings.begin(), rankings.end());
-    VertexID center_vertex_id = rankings.back().conn->vertex.get().id();
-    double current_score      = rankings.back().score();
+    const Vertex &center_vertex = rankings.back().conn->vertex.get();
+    VertexID center_vertex_id   = center_vertex.id();
+    double current_score        = rankings.back().score();
     rankings.pop_back();
 
     if (print_debug_info) {
       spdlog::info("Contracting Vertex {}", center_vertex_id);
-      for (const auto &entry : scoreboard) {
-        spdlog::info("  - {}: {}", entry.first, entry.second.score());
+      for (const RankingInfo &entry : scoreboard) {
+        if (entry.conn != nullptr) {
+          spdlog::info("  - {}: {}", entry.conn->vertex.get().id(), entry.score());
+        }
       }
     }
 
-    auto center_iter = scoreboard.find(center_vertex_id);
-    if (center_iter == scoreboard.end()) {
+    RankingInfo &center = scoreboard[center_vertex.index()];
+    if (center.conn == nullptr) {
       spdlog::critical(
           "ContractGraph: Vertex {} is not contracted but cannot be found in scoreboard.",
           center_vertex_id);
     }
 
-    if (current_score + SIGNIFICANT_SCORE_DIFF < center_iter->second.score() &&
+    if (current_score + SIGNIFICANT_SCORE_DIFF < center.score() &&
         // If there are only 2 or less vertices left (ranking's size
         // would be 1), do not do the update trick as the localization
         // heuristic won't work anyway.
         rankings.size() > 1) {
       if (print_debug_info) {
         spdlog::info("  Re-insert vertex {} with worse score {}.", center_vertex_id,
-                     center_iter->second.score());
+                     center.score());
       }
-      rankings.emplace_back(center_iter->second);
+      rankings.emplace_back(center);
       std::push_heap(rankings.begin(), rankings.end());
       continue;
     }
 
-    FetchNeighborVertexIDs(*center_iter->second.conn, &neighbors);
+    FetchNeighborIndices(*center.conn, &neighbors);
 
-    SingleContractionPlan plan = DryRunContraction(*indexer, *center_iter->second.conn);
+    SingleContractionPlan plan = DryRunContraction(*indexer, *center.conn, &workspace);
     plan.CarryOut(indexer, &shortcuts);
     if (print_debug_info) {
       spdlog::info("  Carry out plan on vertex {}. There are {} shortcuts now.",
                    center_vertex_id, shortcuts.size());
     }
-    scoreboard.erase(center_vertex_id);
+    center.conn = nullptr;
 
     // Now, update all the neighbors as center is now gone since the
     // plan is carried out.
-    for (VertexID neighbor_id : neighbors) {
-      auto item = scoreboard.find(neighbor_id);
-      if (item == scoreboard.end()) {
-        spdlog::warn("ContractGraph: The neighbor {} of {} is already gone.", neighbor_id,
-                     center_vertex_id);
+    for (VertexIndex neighbor : neighbors) {
+      RankingInfo &item = scoreboard[neighbor];
+      if (item.conn == nullptr) {
+        spdlog::warn("ContractGraph: The neighbor {} of {} is already gone.",
+                     indexer->numbering()->id(neighbor), center_vertex_id);
         continue;
       }
-      item->second.extra += ANTI_CLUSTERING_PENALTY;
-      SingleContractionPlan new_plan = DryRunContraction(*indexer, *item->second.conn);
-      item->second.edge_diff         = new_plan.ComputeEdgeDifference();
+      item.extra += ANTI_CLUSTERING_PENALTY;
+      SingleContractionPlan new_plan =
+          DryRunContraction(*indexer, *item.conn, &workspace);
+      item.edge_diff = new_plan.ComputeEdgeDifference();
     }
   }
 
+  shortcuts.ReleaseEdges();
   return shortcuts;
 }
 
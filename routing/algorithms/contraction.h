@@ -1,33 +1,97 @@
 #pragma once
 
 #include <functional>
-#include <memory>
 #include <vector>
 
 #include "graph/defs.h"
+#include "graph/edge.h"
+#include "graph/object_arena.h"
+#include "graph/weight.h"
 
 namespace open_semap {
 namespace graph {
 
 // Forward declaration
 class SimpleIndexer;
-class Edge;
 class RoadGraph;
 class Vertex;
 
 }  // namespace graph
 
+// A shortcut as kept by Shortcuts: the path from -> middle -> to, where middle is
+// the vertex whose contraction added the shortcut. Each half of the path is an
+// original edge or an earlier shortcut, which is what unpacking looks for. 16
+// bytes, instead of the Edge and the pointer to it that a shortcut used to
+// take.
+struct Shortcut {
+  graph::VertexIndex from;
+  graph::VertexIndex to;
+  graph::Weight weight;
+  graph::VertexIndex middle;
+};
+
+static_assert(sizeof(Shortcut) == 16, "Shortcut is expected to stay compact.");
+
+// Owns the shortcuts generated by the contraction, as a flat array of Shortcut
+// records. While the contraction goes on, each shortcut is also an Edge in the
+// indexer so that the searches can use it. Those edges are allocated from an
+// arena, never move, and are freed by ReleaseEdges().
+class Shortcuts {
+ public:
+  using value_type     = Shortcut;
+  using const_iterator = std::vector<Shortcut>::const_iterator;
+
+  // Adds the shortcut a + b, and returns the edge that stands for it in the
+  // indexer.
+  const graph::Edge &Create(const graph::Edge &a, const graph::Edge &b);
+
+  // Records that the vertex is contracted, after the ones recorded before.
+  void MarkContracted(graph::VertexIndex index) {
+    contraction_order_.emplace_back(index);
+  }
+
+  // Takes over the shortcuts and the contracted vertices of the other, whose
+  // edges stay where they are.
+  void Append(Shortcuts &&other);
+
+  // Frees the edges of the shortcuts, which must not be in any indexer
+  // anymore. The records are kept.
+  void ReleaseEdges();
+
+  // The memory held by the records and the edges, in bytes.
+  size_t used_memory() const;
+
+  inline size_t size() const { return shortcuts_.size(); }
+
+  inline const_iterator begin() const { return shortcuts_.begin(); }
+
+  inline const_iterator end() const { return shortcuts_.end(); }
+
+  inline const Shortcut &operator[](size_t i) const { return shortcuts_[i]; }
+
+  // The contracted vertices, in the order of their contraction, which ranks
+  // them in the hierarchy.
+  inline const std::vector<graph::VertexIndex> &contraction_order() const {
+    return contraction_order_;
+  }
+
+ private:
+  graph::ObjectArena<graph::Edge> edges_{};
+  std::vector<Shortcut> shortcuts_{};
+  std::vector<graph::VertexIndex> contraction_order_{};
+};
+
 // Contract the graph based on the Contraction Hierarchies algorithm. The order
 // of contraction is given. The algorithm will generate shortcuts when each
 // vertex is contracted, and the generated shortcuts will be returned.
-std::vector<std::unique_ptr<graph::Edge>> ContractVertices(
-    const std::vector<graph::VertexID> &ordered_vertex_ids,
-    graph::SimpleIndexer *indexer);
+Shortcuts ContractVertices(const std::vector<graph::VertexID> &ordered_vertex_ids,
+                           graph::SimpleIndexer *indexer);
 
 // Contract graph based on the Contraction Hierarchies algorithm. Unlike the
 // above function, this one does not take the contraction order as granted.
-// Instead, it figures out the contraction order by itself.
-std::vector<std::unique_ptr<graph::Edge>> ContractGraph(graph::SimpleIndexer *indexer,
-                                                        bool print_debug_info = false);
+// Instead, it figures out the contraction order by itself. As all the vertices
+// are removed from the indexer at the end, the edges of the returned shortcuts
+// are already released.
+Shortcuts ContractGraph(graph::SimpleIndexer *indexer, bool print_debug_info = false);
 
 }  // namespace open_semap
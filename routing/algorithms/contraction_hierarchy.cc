@@ -0,0 +1,333 @@
+#include "algorithms/contraction_hierarchy.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "algorithms/generation.h"
+#include "graph/vertex.h"
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+using graph::Edge;
+using graph::RoadGraph;
+using graph::Vertex;
+using graph::VertexID;
+using graph::VertexIndex;
+using graph::Weight;
+using graph::kInvalidVertexIndex;
+
+using Index = ContractionHierarchy::Index;
+
+namespace {
+
+// An arc before it goes into the CSR arrays, stored at low and heading to the
+// higher-ranked head.
+struct Arc {
+  Index low;
+  Index head;
+  Weight weight;
+  const Edge *edge;
+  Index middle;
+};
+
+// Sorts the arcs by their tails, and keeps the lightest of the parallel ones.
+// Fills the arrays of one direction of the CSR index.
+void BuildArcs(size_t num_vertices, std::vector<Arc> *arcs, std::vector<Index> *offsets,
+               std::vector<Index> *heads, std::vector<Weight> *weights,
+               std::vector<const Edge *> *edges, std::vector<Index> *middles) {
+  std::sort(arcs->begin(), arcs->end(), [](const Arc &a, const Arc &b) {
+    return std::tie(a.low, a.head, a.weight) < std::tie(b.low, b.head, b.weight);
+  });
+  arcs->erase(std::unique(arcs->begin(), arcs->end(),
+                          [](const Arc &a, const Arc &b) {
+                            return a.low == b.low && a.head == b.head;
+                          }),
+              arcs->end());
+
+  offsets->assign(num_vertices + 1, 0);
+  for (const Arc &arc : *arcs) {
+    ++(*offsets)[arc.low + 1];
+  }
+  for (size_t v = 0; v < num_vertices; ++v) {
+    (*offsets)[v + 1] += (*offsets)[v];
+  }
+  heads->reserve(arcs->size());
+  weights->reserve(arcs->size());
+  edges->reserve(arcs->size());
+  middles->reserve(arcs->size());
+  for (const Arc &arc : *arcs) {
+    heads->emplace_back(arc.head);
+    weights->emplace_back(arc.weight);
+    edges->emplace_back(arc.edge);
+    middles->emplace_back(arc.middle);
+  }
+}
+
+}  // namespace
+
+ContractionHierarchy ContractionHierarchy::Create(const RoadGraph &graph,
+                                                  const Shortcuts &shortcuts) {
+  ContractionHierarchy hierarchy;
+  hierarchy.numbering_ = &graph.numbering();
+
+  const size_t n               = graph.vertices().size();
+  constexpr uint32_t kUnranked = static_cast<uint32_t>(-1);
+  hierarchy.ranks_.assign(n, kUnranked);
+  uint32_t next_rank = 0;
+  for (VertexIndex v : shortcuts.contraction_order()) {
+    if (v < n && hierarchy.ranks_[v] == kUnranked) {
+      hierarchy.ranks_[v] = next_rank++;
+    }
+  }
+  for (uint32_t &rank : hierarchy.ranks_) {
+    if (rank == kUnranked) {
+      rank = next_rank++;
+    }
+  }
+
+  std::vector<Arc> up;
+  std::vector<Arc> down;
+  auto add = [&hierarchy, &up, &down](Index from, Index to, Weight weight,
+                                      const Edge *edge, Index middle) {
+    if (from == to) {
+      return;
+    }
+    if (hierarchy.ranks_[from] < hierarchy.ranks_[to]) {
+      up.emplace_back(Arc{from, to, weight, edge, middle});
+    } else {
+      down.emplace_back(Arc{to, from, weight, edge, middle});
+    }
+  };
+
+  // Skip the edges that refer to vertices not in the graph, the same way as
+  // CsrGraph does.
+  const std::vector<Vertex *> &vertices = graph.vertices();
+  auto index_of = [n, &vertices](const Vertex &vertex) -> Index {
+    Index index = vertex.index();
+    return index < n && vertices[index] == &vertex ? index : kInvalidVertexIndex;
+  };
+  for (const Edge *edge : graph.edges()) {
+    Index from = index_of(edge->from());
+    Index to   = index_of(edge->to());
+    if (from == kInvalidVertexIndex || to == kInvalidVertexIndex) {
+      continue;
+    }
+    add(from, to, edge->cost(), edge, kInvalidVertexIndex);
+  }
+  for (const Shortcut &shortcut : shortcuts) {
+    add(shortcut.from, shortcut.to, shortcut.weight, nullptr, shortcut.middle);
+  }
+
+  BuildArcs(n, &up, &hierarchy.out_offsets_, &hierarchy.out_heads_,
+            &hierarchy.out_weights_, &hierarchy.out_edges_, &hierarchy.out_middles_);
+  BuildArcs(n, &down, &hierarchy.in_offsets_, &hierarchy.in_heads_,
+            &hierarchy.in_weights_, &hierarchy.in_edges_, &hierarchy.in_middles_);
+  return hierarchy;
+}
+
+void ContractionHierarchy::Unpack(Index from, Index to,
+                                  std::vector<const Edge *> *edges) const {
+  const Edge *edge = nullptr;
+  Index middle     = kInvalidVertexIndex;
+  if (ranks_[from] < ranks_[to]) {
+    for (Index arc = out_begin(from); arc < out_end(from); ++arc) {
+      if (out_heads_[arc] == to) {
+        edge   = out_edges_[arc];
+        middle = out_middles_[arc];
+        break;
+      }
+    }
+  } else {
+    for (Index arc = in_begin(to); arc < in_end(to); ++arc) {
+      if (in_heads_[arc] == from) {
+        edge   = in_edges_[arc];
+        middle = in_middles_[arc];
+        break;
+      }
+    }
+  }
+
+  if (edge != nullptr) {
+    edges->emplace_back(edge);
+  } else if (middle != kInvalidVertexIndex) {
+    Unpack(from, middle, edges);
+    Unpack(middle, to, edges);
+  } else {
+    spdlog::critical("ContractionHierarchy: There is no arc {} -> {}.",
+                     numbering_->id(from), numbering_->id(to));
+  }
+}
+
+size_t ContractionHierarchy::used_memory() const {
+  return ranks_.capacity() * sizeof(uint32_t) +
+         (out_offsets_.capacity() + in_offsets_.capacity()) * sizeof(Index) +
+         (out_heads_.capacity() + in_heads_.capacity()) * sizeof(Index) +
+         (out_weights_.capacity() + in_weights_.capacity()) * sizeof(Weight) +
+         (out_edges_.capacity() + in_edges_.capacity()) * sizeof(const Edge *) +
+         (out_middles_.capacity() + in_middles_.capacity()) * sizeof(Index);
+}
+
+void UpwardSearch::Reset(size_t num_vertices, VertexIndex start) {
+  NextGeneration(num_vertices, &generation_, &generations_);
+  if (scores_.size() < num_vertices) {
+    scores_.resize(num_vertices);
+    parents_.resize(num_vertices);
+  }
+  queue_.Clear();
+  Relax(start, 0, kInvalidVertexIndex);
+  queue_.Push(start, 0);
+}
+
+namespace {
+
+template <bool kForward>
+Index SettleUpward(const ContractionHierarchy &hierarchy, Weight limit,
+                   UpwardSearch *search, bool *stalled) {
+  RadixHeap &queue = search->queue();
+  QueueEntry elected{};
+  do {
+    if (queue.empty()) {
+      return kInvalidVertexIndex;
+    }
+    elected = queue.Pop();
+  } while (elected.key != search->score(elected.vertex));
+  if (elected.key >= limit) {
+    return kInvalidVertexIndex;
+  }
+  Index current = elected.vertex;
+
+  // Stall-on-demand: the arcs from the higher vertices, which the search does
+  // not go down, tell whether one of them reaches this vertex cheaper.
+  *stalled        = false;
+  Index stall_end = kForward ? hierarchy.in_end(current) : hierarchy.out_end(current);
+  for (Index arc = kForward ? hierarchy.in_begin(current) : hierarchy.out_begin(current);
+       arc < stall_end; ++arc) {
+    Index higher  = kForward ? hierarchy.in_head(arc) : hierarchy.out_head(arc);
+    Weight weight = kForward ? hierarchy.in_weight(arc) : hierarchy.out_weight(arc);
+    if (graph::AddWeights(search->score(higher), weight) < elected.key) {
+      *stalled = true;
+      return current;
+    }
+  }
+
+  Index end = kForward ? hierarchy.out_end(current) : hierarchy.in_end(current);
+  for (Index arc = kForward ? hierarchy.out_begin(current) : hierarchy.in_begin(current);
+       arc < end; ++arc) {
+    Index neighbor      = kForward ? hierarchy.out_head(arc) : hierarchy.in_head(arc);
+    Weight weight       = kForward ? hierarchy.out_weight(arc) : hierarchy.in_weight(arc);
+    Weight updated_cost = graph::AddWeights(elected.key, weight);
+    if (updated_cost < search->score(neighbor)) {
+      search->Relax(neighbor, updated_cost, current);
+      queue.Push(neighbor, updated_cost);
+    }
+  }
+  return current;
+}
+
+}  // namespace
+
+Index UpwardSearch::SettleNext(const ContractionHierarchy &hierarchy,
+                               SearchDirection direction, Weight limit, bool *stalled) {
+  return direction == SearchDirection::kForward
+             ? SettleUpward<true>(hierarchy, limit, this, stalled)
+             : SettleUpward<false>(hierarchy, limit, this, stalled);
+}
+
+namespace {
+
+// Settles the next vertex of the side. A settled vertex also reached by the
+// other side is a candidate for the top of the route, unless it is stalled:
+// the top of a shortest route is never stalled. Returns false once the side
+// cannot beat the best cost anymore.
+bool Step(const ContractionHierarchy &hierarchy, SearchDirection direction,
+          UpwardSearch *side, const UpwardSearch &other, Weight *best_cost,
+          Index *meeting, size_t *num_settled) {
+  bool stalled  = false;
+  Index current = side->SettleNext(hierarchy, direction, *best_cost, &stalled);
+  if (current == kInvalidVertexIndex) {
+    return false;
+  }
+  ++*num_settled;
+  if (stalled) {
+    return true;
+  }
+  Weight through = graph::AddWeights(side->score(current), other.score(current));
+  if (through < *best_cost) {
+    *best_cost = through;
+    *meeting   = current;
+  }
+  return true;
+}
+
+}  // namespace
+
+Route RunChQuery(const ContractionHierarchy &hierarchy, VertexID source, VertexID target,
+                 ChQueryWorkspace *workspace) {
+  Route route;
+
+  Index source_index = hierarchy.FindIndex(source);
+  if (source_index == kInvalidVertexIndex) {
+    spdlog::critical("RunChQuery(): Cannot find vertex with ID = {}", source);
+    return route;
+  }
+  Index target_index = hierarchy.FindIndex(target);
+  if (target_index == kInvalidVertexIndex) {
+    spdlog::critical("RunChQuery(): Cannot find vertex with ID = {}", target);
+    return route;
+  }
+
+  UpwardSearch &forward  = workspace->forward;
+  UpwardSearch &backward = workspace->backward;
+  forward.Reset(hierarchy.num_vertices(), source_index);
+  backward.Reset(hierarchy.num_vertices(), target_index);
+
+  // The sides take turns until both are done, each once its queue cannot beat
+  // the best cost anymore.
+  Index meeting      = kInvalidVertexIndex;
+  bool forward_done  = false;
+  bool backward_done = false;
+  bool forward_turn  = true;
+  while (!forward_done || !backward_done) {
+    if (forward_turn ? forward_done : backward_done) {
+      forward_turn = !forward_turn;
+      continue;
+    }
+    if (forward_turn) {
+      forward_done = !Step(hierarchy, SearchDirection::kForward, &forward, backward,
+                           &route.cost, &meeting, &route.num_settled);
+    } else {
+      backward_done = !Step(hierarchy, SearchDirection::kBackward, &backward, forward,
+                            &route.cost, &meeting, &route.num_settled);
+    }
+    forward_turn = !forward_turn;
+  }
+  if (!route.found()) {
+    return route;
+  }
+
+  // The vertices of the route on the hierarchy, from the source up to the
+  // meeting vertex and down to the target.
+  std::vector<Index> path;
+  for (Index v = meeting; v != source_index; v = forward.parent(v)) {
+    path.emplace_back(v);
+  }
+  path.emplace_back(source_index);
+  std::reverse(path.begin(), path.end());
+  for (Index v = meeting; v != target_index;) {
+    v = backward.parent(v);
+    path.emplace_back(v);
+  }
+  for (size_t i = 0; i + 1 < path.size(); ++i) {
+    hierarchy.Unpack(path[i], path[i + 1], &route.edges);
+  }
+  return route;
+}
+
+Route RunChQuery(const ContractionHierarchy &hierarchy, VertexID source,
+                 VertexID target) {
+  ChQueryWorkspace workspace;
+  return RunChQuery(hierarchy, source, target, &workspace);
+}
+
+}  // namespace open_semap
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "algorithms/contraction.h"
+#include "algorithms/priority_queue.h"
+#include "algorithms/route.h"
+#include "graph/defs.h"
+#include "graph/edge.h"
+#include "graph/road_graph.h"
+#include "graph/vertex_numbering.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// The search graph of a contracted RoadGraph, which answers the queries with
+// RunChQuery().
+//
+// The vertices are ranked by their contraction order, and each original edge
+// or shortcut is stored only once, at its lower-ranked end. The upward arcs of
+// the vertex v are the ones v -> w with w above v, in [out_begin(v),
+// out_end(v)); its downward arcs are the ones w -> v with w above v, in
+// [in_begin(v), in_end(v)), stored with w as their head. The forward search of
+// a query goes up the first ones, the backward search up the second ones, and
+// each side checks the other kind to stall the vertices it reached on a detour.
+//
+// Of the parallel arcs, only the lightest is kept. The RoadGraph must outlive
+// the hierarchy, whose arcs refer to its edges.
+class ContractionHierarchy {
+ public:
+  using Index = graph::VertexIndex;
+
+  // The shortcuts must come from the contraction of the whole graph, i.e. from
+  // ContractGraph(), or from ContractVertices() on all the vertices. The
+  // vertices that are not in their contraction order rank above all the others.
+  static ContractionHierarchy Create(const graph::RoadGraph &graph,
+                                     const Shortcuts &shortcuts);
+
+  ContractionHierarchy() = default;
+
+  ContractionHierarchy(ContractionHierarchy &&) noexcept = default;
+  ContractionHierarchy &operator=(ContractionHierarchy &&) noexcept = default;
+
+  inline size_t num_vertices() const { return ranks_.size(); }
+
+  inline size_t num_arcs() const { return out_heads_.size() + in_heads_.size(); }
+
+  // Returns graph::kInvalidVertexIndex if the graph does not have a vertex with
+  // the ID.
+  Index FindIndex(graph::VertexID id) const { return numbering_->Find(id); }
+
+  inline uint32_t rank(Index v) const { return ranks_[v]; }
+
+  inline Index out_begin(Index v) const { return out_offsets_[v]; }
+
+  inline Index out_end(Index v) const { return out_offsets_[v + 1]; }
+
+  inline Index out_head(Index arc) const { return out_heads_[arc]; }
+
+  inline graph::Weight out_weight(Index arc) const { return out_weights_[arc]; }
+
+  inline Index in_begin(Index v) const { return in_offsets_[v]; }
+
+  inline Index in_end(Index v) const { return in_offsets_[v + 1]; }
+
+  inline Index in_head(Index arc) const { return in_heads_[arc]; }
+
+  inline graph::Weight in_weight(Index arc) const { return in_weights_[arc]; }
+
+  // Appends the original edges of the arc from -> to, a shortcut or not, in
+  // order. The arc must exist. A shortcut is unpacked into the two arcs through
+  // its middle vertex, which ranks below both ends.
+  void Unpack(Index from, Index to, std::vector<const graph::Edge *> *edges) const;
+
+  // The memory held by the arcs and the ranks, in bytes.
+  size_t used_memory() const;
+
+ private:
+  const graph::VertexNumbering *numbering_ = nullptr;
+
+  std::vector<uint32_t> ranks_{};
+
+  std::vector<Index> out_offsets_{};
+  std::vector<Index> out_heads_{};
+  std::vector<graph::Weight> out_weights_{};
+
+  std::vector<Index> in_offsets_{};
+  std::vector<Index> in_heads_{};
+  std::vector<graph::Weight> in_weights_{};
+
+  // For each arc, out_ and in_ alike, either the original edge (with an
+  // invalid middle) or the middle vertex of the shortcut (with a null edge).
+  std::vector<const graph::Edge *> out_edges_{};
+  std::vector<Index> out_middles_{};
+  std::vector<const graph::Edge *> in_edges_{};
+  std::vector<Index> in_middles_{};
+};
+
+enum class SearchDirection {
+  // From the source, up the upward arcs.
+  kForward,
+  // From the target, up the downward arcs, i.e. against the edges.
+  kBackward,
+};
+
+// A search that only goes up the ranks of a ContractionHierarchy, one of the
+// two of RunChQuery(). Reused over the queries, and cleared in O(1) the same
+// way as DijkstraWorkspace.
+class UpwardSearch {
+ public:
+  // Prepares a search from the start.
+  void Reset(size_t num_vertices, graph::VertexIndex start);
+
+  // Settles the next vertex and returns it, or returns kInvalidVertexIndex if
+  // the queue has run out or only holds keys not below the limit. The arcs of
+  // the vertex are relaxed unless it is stalled, i.e. unless a higher vertex
+  // already reached reaches it cheaper. The score of a stalled vertex is not
+  // its cost, and nothing should be reported for it.
+  graph::VertexIndex SettleNext(const ContractionHierarchy &hierarchy,
+                                SearchDirection direction, graph::Weight limit,
+                                bool *stalled);
+
+  // The best cost so far of the vertex, kInfiniteWeight if it is not reached.
+  graph::Weight score(graph::VertexIndex v) const {
+    return generations_[v] == generation_ ? scores_[v] : graph::kInfiniteWeight;
+  }
+
+  // The vertex before this one on the search, a lower-ranked one. Only for the
+  // reached vertices other than the start.
+  graph::VertexIndex parent(graph::VertexIndex v) const { return parents_[v]; }
+
+  void Relax(graph::VertexIndex v, graph::Weight score, graph::VertexIndex parent) {
+    generations_[v] = generation_;
+    scores_[v]      = score;
+    parents_[v]     = parent;
+  }
+
+  RadixHeap &queue() { return queue_; }
+
+ private:
+  uint32_t generation_ = 0;
+  std::vector<uint32_t> generations_{};
+  std::vector<graph::Weight> scores_{};
+  std::vector<graph::VertexIndex> parents_{};
+  RadixHeap queue_{};
+};
+
+struct ChQueryWorkspace {
+  UpwardSearch forward;
+  UpwardSearch backward;
+};
+
+// Finds the shortest route from the source to the target on the hierarchy: a
+// forward search from the source and a backward search from the target, both
+// only going up the ranks, meet at the highest vertex of the route. A vertex is
+// stalled, i.e. not expanded, if a higher vertex reached by the same search
+// proves that it was reached on a detour. The shortcuts on the route are
+// unpacked, so the edges of the route are the original ones.
+//
+// Returns a route that is not found(), after logging, if the source or the
+// target is not in the graph.
+Route RunChQuery(const ContractionHierarchy &hierarchy, graph::VertexID source,
+                 graph::VertexID target, ChQueryWorkspace *workspace);
+
+Route RunChQuery(const ContractionHierarchy &hierarchy, graph::VertexID source,
+                 graph::VertexID target);
+
+}  // namespace open_semap
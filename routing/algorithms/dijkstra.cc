@@ -2,44 +2,136 @@
 
 #include <algorithm>
 #include <cstdio>
-#include <unordered_map>
+#include <limits>
+#include <vector>
 
+#include "algorithms/generation.h"
+#include "graph/csr_graph.h"
 #include "graph/simple_indexer.h"
 #include "spdlog/spdlog.h"
 
 namespace open_semap {
 
 using graph::ConnectionInfo;
+using graph::CsrGraph;
 using graph::Edge;
 using graph::SimpleIndexer;
 using graph::Vertex;
 using graph::VertexID;
+using graph::VertexIndex;
+using graph::VertexNumbering;
+using graph::Weight;
+using graph::kInfiniteWeight;
+
+void SearchTree::Reset(const VertexNumbering &numbering, VertexIndex start) {
+  numbering_ = &numbering;
+  start_     = start;
+  NextGeneration(numbering.size(), &generation_, &generations_);
+  if (slots_.size() < numbering.size()) {
+    slots_.resize(numbering.size());
+  }
+  nodes_.clear();
+}
 
 const SearchNode *SearchTree::Find(VertexID vertex_id) const {
-  auto iter = nodes_.find(vertex_id);
-  if (iter == nodes_.end()) {
+  VertexIndex index = numbering_->Find(vertex_id);
+  if (index == graph::kInvalidVertexIndex || index == start_ ||
+      generations_[index] != generation_) {
     return nullptr;
   }
-  return &iter->second;
+  return &nodes_[slots_[index]];
 }
 
-SearchTree RunDijkstra(const SimpleIndexer &indexer, VertexID start,
-                       const std::unordered_set<VertexID> &goals) {
-  SearchTree tree(start);
+const char *PriorityQueueName(PriorityQueueType type) {
+  switch (type) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      return "lazy_binary_heap";
+    case PriorityQueueType::kIndexedFourAryHeap:
+      return "indexed_four_ary_heap";
+    case PriorityQueueType::kRadixHeap:
+      return "radix_heap";
+  }
+  return "unknown";
+}
+
+void DijkstraWorkspace::Reset(const VertexNumbering &numbering, VertexIndex start) {
+  tree_.Reset(numbering, start);
+  NextGeneration(numbering.size(), &generation_, &generations_);
+  if (scores_.size() < numbering.size()) {
+    scores_.resize(numbering.size());
+    parents_.resize(numbering.size());
+  }
+  generations_[start] = generation_;
+  scores_[start]      = 0;
+  parents_[start]     = nullptr;
+  switch (queue_type_) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      lazy_binary_heap_.Clear();
+      break;
+    case PriorityQueueType::kIndexedFourAryHeap:
+      four_ary_heap_.Clear();
+      four_ary_heap_.Reserve(numbering.size());
+      break;
+    case PriorityQueueType::kRadixHeap:
+      radix_heap_.Clear();
+      break;
+  }
+}
+
+void DijkstraWorkspace::ClearGoals(size_t num_vertices) {
+  NextGeneration(num_vertices, &goal_generation_, &goal_generations_);
+  num_goals_ = 0;
+}
+
+void DijkstraWorkspace::AddGoal(VertexIndex index) {
+  if (!IsGoal(index)) {
+    goal_generations_[index] = goal_generation_;
+    ++num_goals_;
+  }
+}
+
+const PriorityQueueStats &DijkstraWorkspace::queue_stats() const {
+  switch (queue_type_) {
+    case PriorityQueueType::kIndexedFourAryHeap:
+      return four_ary_heap_.stats();
+    case PriorityQueueType::kRadixHeap:
+      return radix_heap_.stats();
+    case PriorityQueueType::kLazyBinaryHeap:
+      break;
+  }
+  return lazy_binary_heap_.stats();
+}
 
-  // Before a vertex is finalized and inserted to the search tree, its
-  // current best cost (score) is stored in the scoreboard. The
-  // scoreboard is an unordered_map so that it can be queried against
-  // the VertexID.
-  std::unordered_map<VertexID, double> scoreboard;
-  // NOTE(breakds): if later SearchNode becomes significantly larger, we can
-  // consider make this vector<unique_ptr<SearchNode>> instead.
-  std::vector<SearchNode> q;
+namespace {
+
+// Pops the queue until a vertex that is not in the tree yet comes out, and
+// adds it to the tree. With the queues that push a vertex again when it
+// improves, the vertices popped before may be stale duplicates of finalized
+// ones. Returns kInvalidVertexIndex if the queue runs out.
+template <typename Queue>
+VertexIndex SettleNext(Queue *q, DijkstraWorkspace *workspace) {
+  SearchTree &tree = workspace->tree();
+  while (!q->empty()) {
+    QueueEntry elected = q->Pop();
+    if (!tree.Has(elected.vertex)) {
+      tree.Emplace(SearchNode(elected.key, workspace->parent(elected.vertex)));
+      return elected.vertex;
+    }
+  }
+  return graph::kInvalidVertexIndex;
+}
+
+// The search stops once it has settled num_goals vertices for which
+// is_goal(index, id) holds. It never relaxes the avoided vertex.
+template <typename Queue, typename IsGoal>
+void SearchIndexer(const SimpleIndexer &indexer, VertexID start, const IsGoal &is_goal,
+                   size_t num_goals, Weight limit, VertexIndex avoid,
+                   DijkstraWorkspace *workspace, Queue *q) {
+  SearchTree &tree = workspace->tree();
 
   VertexID current    = start;
-  double current_cost = 0.0;
+  Weight current_cost = 0;
 
-  size_t num_goals = goals.size();
   size_t hit_goals = 0;
 
   do {
@@ -56,65 +148,130 @@ SearchTree RunDijkstra(const SimpleIndexer &indexer, VertexID start,
       spdlog::debug("  Check edge {} -> {}", edge_ref.get().from().id(),
                     edge_ref.get().to().id());
 
-      double edge_cost     = edge_ref.get().cost();
-      VertexID neighbor_id = edge_ref.get().to().id();
+      VertexIndex neighbor = edge_ref.get().to().index();
 
       // Case I: The neighbor vertex is already finalized (i.e. it is already in
-      // the search tree). In this case, we can skip relaxing it.
-      if (tree.Has(neighbor_id)) {
+      // the search tree), or is avoided. In this case, we can skip relaxing it.
+      if (neighbor == avoid || tree.Has(neighbor)) {
         continue;
       }
 
-      auto iter = scoreboard.find(neighbor_id);
-
       // Case II: If this is the first time it reaches this neighbor vertex, or
-      // if this vertex can now be relaxed with a better cost, do it.
-      if (iter == scoreboard.end() || current_cost + edge_cost < iter->second) {
-        double updated_cost     = current_cost + edge_cost;
-        scoreboard[neighbor_id] = updated_cost;
-        spdlog::debug("    Update {} with cost {}", neighbor_id, updated_cost);
-        // NOTE(breakds) that we lazily add the corresponding SearchNode to the
-        // search tree. There may have already been SearchNode with the same ID,
-        // but we can be sure that the new SearchNdoe has a better cost, so that
-        // is will have a better position in the heap.
-        //
-        // Lazy update is mainly to avoid having to implement heap update.
-        //
-        // Although this may make the algorithm more expensive, but since the
-        // RoadGraph is sparse, each vertex won't have more than O(1) edges, and
-        // each vertex can only be relaxed by at most [number of edges] times,
-        // this is fine.
-        q.emplace_back(updated_cost, edge_ref.get());
-        std::push_heap(q.begin(), q.end());
+      // if this vertex can now be relaxed with a better cost, do it. The queue
+      // either lowers the key of the vertex or takes it again, see
+      // PriorityQueueType.
+      Weight updated_cost = graph::AddWeights(current_cost, edge_ref.get().cost());
+      if (updated_cost < workspace->score(neighbor)) {
+        workspace->Relax(neighbor, updated_cost, edge_ref.get());
+        spdlog::debug("    Update {} with cost {}", edge_ref.get().to().id(),
+                      updated_cost);
+        q->Push(neighbor, updated_cost);
       }
     }
 
-    bool can_continue = false;
-
-    // Normally we just need to the get the top of the heap to go on. However,
-    // since we are doing lazy update, the top may be a duplicate vertex that
-    // has already been finalized. In this case, keep popping until we get a new
-    // vertex or the heap is empty.
-    while (!q.empty()) {
-      std::pop_heap(q.begin(), q.end());
-      SearchNode elected = q.back();
-      q.pop_back();
-      if (!tree.Has(elected.vertex().id())) {
-        can_continue = true;
-        current      = elected.vertex().id();
-        current_cost = elected.cost();
-        tree.Emplace(elected);
-        spdlog::debug("  Elected {} with cost {}", current, current_cost);
+    VertexIndex elected = SettleNext(q, workspace);
+
+    // This marks the end of the algorithm (i.e. exhaust of the graph).
+    if (elected == graph::kInvalidVertexIndex) {
+      break;
+    }
+    current      = workspace->parent(elected).to().id();
+    current_cost = workspace->score(elected);
+    spdlog::debug("  Elected {} with cost {}", current, current_cost);
+
+    // Everything within the limit is settled already.
+    if (current_cost > limit) {
+      break;
+    }
+
+    if (is_goal(elected, current)) {
+      ++hit_goals;
+      if (hit_goals == num_goals) {
         break;
       }
     }
 
-    // This marks the end of the algorithm (i.e. exhaust of the graph).
-    if (!can_continue) {
+  } while (true);
+}
+
+template <typename IsGoal>
+void SearchIndexer(const SimpleIndexer &indexer, VertexID start, const IsGoal &is_goal,
+                   size_t num_goals, Weight limit, VertexIndex avoid,
+                   DijkstraWorkspace *workspace) {
+  switch (workspace->queue_type()) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      SearchIndexer(indexer, start, is_goal, num_goals, limit, avoid, workspace,
+                    &workspace->lazy_binary_heap());
+      break;
+    case PriorityQueueType::kIndexedFourAryHeap:
+      SearchIndexer(indexer, start, is_goal, num_goals, limit, avoid, workspace,
+                    &workspace->four_ary_heap());
+      break;
+    case PriorityQueueType::kRadixHeap:
+      SearchIndexer(indexer, start, is_goal, num_goals, limit, avoid, workspace,
+                    &workspace->radix_heap());
+      break;
+  }
+}
+
+// Returns the index of the start, after preparing the workspace for a search
+// from it.
+VertexIndex ResetForIndexer(const SimpleIndexer &indexer, VertexID start,
+                            DijkstraWorkspace *workspace) {
+  if (indexer.numbering() == nullptr) {
+    spdlog::critical("RunDijkstra(): The indexer is not created from a graph.");
+    std::abort();
+  }
+  const VertexNumbering &numbering = *indexer.numbering();
+
+  VertexIndex start_index = numbering.Find(start);
+  if (start_index == graph::kInvalidVertexIndex) {
+    spdlog::critical("RunDijkstra(): Cannot find vertex with ID = {}", start);
+    std::abort();
+  }
+
+  workspace->Reset(numbering, start_index);
+  return start_index;
+}
+
+template <typename Queue>
+void SearchCsr(const CsrGraph &graph, CsrGraph::Index start,
+               const std::unordered_set<VertexID> &goals, DijkstraWorkspace *workspace,
+               Queue *q) {
+  using Index = CsrGraph::Index;
+
+  SearchTree &tree = workspace->tree();
+
+  // The vertices in the tree, the start included, are the finalized ones.
+  Index current       = start;
+  Weight current_cost = 0;
+
+  size_t num_goals = goals.size();
+  size_t hit_goals = 0;
+
+  do {
+    for (Index arc = graph.out_begin(current); arc < graph.out_end(current); ++arc) {
+      Index neighbor = graph.out_head(arc);
+      if (tree.Has(neighbor)) {
+        continue;
+      }
+      Weight updated_cost = graph::AddWeights(current_cost, graph.out_weight(arc));
+      if (updated_cost < workspace->score(neighbor)) {
+        // The parent is kept as the original edge of the arc, so that the
+        // search node can be reported in terms of it.
+        workspace->Relax(neighbor, updated_cost, graph.out_edge(arc));
+        q->Push(neighbor, updated_cost);
+      }
+    }
+
+    Index elected = SettleNext(q, workspace);
+    if (elected == graph::kInvalidVertexIndex) {
       break;
     }
+    current      = elected;
+    current_cost = workspace->score(elected);
 
-    if (goals.count(current) > 0) {
+    if (goals.count(graph.vertex(current).id()) > 0) {
       ++hit_goals;
       if (hit_goals == num_goals) {
         break;
@@ -122,8 +279,78 @@ SearchTree RunDijkstra(const SimpleIndexer &indexer, VertexID start,
     }
 
   } while (true);
+}
+
+}  // namespace
+
+SearchTree RunDijkstra(const SimpleIndexer &indexer, VertexID start,
+                       const std::unordered_set<VertexID> &goals) {
+  DijkstraWorkspace workspace;
+  RunDijkstra(indexer, start, goals, &workspace);
+  return workspace.ReleaseTree();
+}
+
+const SearchTree &RunDijkstra(const SimpleIndexer &indexer, VertexID start,
+                              const std::unordered_set<VertexID> &goals,
+                              DijkstraWorkspace *workspace, Weight limit) {
+  ResetForIndexer(indexer, start, workspace);
+  SearchIndexer(
+      indexer, start,
+      [&goals](VertexIndex, VertexID id) { return goals.count(id) > 0; }, goals.size(),
+      limit, graph::kInvalidVertexIndex, workspace);
+  return workspace->tree();
+}
+
+const SearchTree &RunDijkstraToMarkedGoals(const SimpleIndexer &indexer, VertexID start,
+                                           DijkstraWorkspace *workspace, Weight limit,
+                                           VertexIndex avoid) {
+  VertexIndex start_index = ResetForIndexer(indexer, start, workspace);
+  // Neither the start nor the avoided vertex is ever settled, so they would
+  // never be hit.
+  size_t num_goals = workspace->num_goals();
+  if (workspace->IsGoal(start_index)) {
+    --num_goals;
+  }
+  if (avoid != graph::kInvalidVertexIndex && avoid != start_index &&
+      workspace->IsGoal(avoid)) {
+    --num_goals;
+  }
+  SearchIndexer(
+      indexer, start,
+      [workspace](VertexIndex index, VertexID) { return workspace->IsGoal(index); },
+      num_goals, limit, avoid, workspace);
+  return workspace->tree();
+}
+
+SearchTree RunDijkstra(const CsrGraph &graph, VertexID start,
+                       const std::unordered_set<VertexID> &goals) {
+  DijkstraWorkspace workspace;
+  RunDijkstra(graph, start, goals, &workspace);
+  return workspace.ReleaseTree();
+}
 
-  return tree;
+const SearchTree &RunDijkstra(const CsrGraph &graph, VertexID start,
+                              const std::unordered_set<VertexID> &goals,
+                              DijkstraWorkspace *workspace) {
+  CsrGraph::Index start_index = graph.FindIndex(start);
+  if (start_index == CsrGraph::kInvalidIndex) {
+    spdlog::critical("RunDijkstra(): Cannot find vertex with ID = {}", start);
+    std::abort();
+  }
+
+  workspace->Reset(graph.numbering(), start_index);
+  switch (workspace->queue_type()) {
+    case PriorityQueueType::kLazyBinaryHeap:
+      SearchCsr(graph, start_index, goals, workspace, &workspace->lazy_binary_heap());
+      break;
+    case PriorityQueueType::kIndexedFourAryHeap:
+      SearchCsr(graph, start_index, goals, workspace, &workspace->four_ary_heap());
+      break;
+    case PriorityQueueType::kRadixHeap:
+      SearchCsr(graph, start_index, goals, workspace, &workspace->radix_heap());
+      break;
+  }
+  return workspace->tree();
 }
 
 }  // namespace open_semap
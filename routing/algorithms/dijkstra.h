@@ -1,53 +1,164 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "algorithms/priority_queue.h"
 #include "graph/defs.h"
 #include "graph/edge.h"
 #include "graph/vertex.h"
+#include "graph/vertex_numbering.h"
+#include "graph/weight.h"
 
 namespace open_semap {
 
 // Forward declaration
 namespace graph {
 
+class CsrGraph;
 class SimpleIndexer;
 
 }  // namespace graph
 
 class SearchNode {
  public:
-  SearchNode(double cost, const graph::Edge &edge) : cost_(cost), edge_(edge) {}
+  SearchNode(graph::Weight cost, const graph::Edge &edge) : cost_(cost), edge_(edge) {}
 
   const graph::Vertex &vertex() const { return edge_.get().to(); }
 
-  double cost() const { return cost_; }
+  graph::Weight cost() const { return cost_; }
 
   const graph::Edge &edge() const { return edge_.get(); }
 
   bool operator<(const SearchNode &other) const { return cost_ > other.cost_; }
 
  private:
-  double cost_;
+  graph::Weight cost_;
   std::reference_wrapper<const graph::Edge> edge_;
 };  // namespace open_semap
 
 class SearchTree {
  public:
-  SearchTree(graph::VertexID start_id) : start_id_(start_id) {}
+  // An empty tree, to be prepared by Reset().
+  SearchTree() = default;
 
-  bool Has(graph::VertexID vertex_id) {
-    return vertex_id == start_id_ || nodes_.count(vertex_id) > 0;
+  // The numbering must cover all the vertices that the search can reach.
+  SearchTree(const graph::VertexNumbering &numbering, graph::VertexIndex start) {
+    Reset(numbering, start);
   }
 
-  void Emplace(const SearchNode &node) { nodes_.emplace(node.vertex().id(), node); }
+  // Empties the tree for a search from the start. The memory is kept, and the
+  // per-vertex slots are cleared in O(1) by moving on to the next generation,
+  // so that a reused tree costs no allocation.
+  void Reset(const graph::VertexNumbering &numbering, graph::VertexIndex start);
+
+  bool Has(graph::VertexIndex index) const {
+    return index == start_ || generations_[index] == generation_;
+  }
+
+  void Emplace(const SearchNode &node) {
+    graph::VertexIndex index = node.vertex().index();
+    generations_[index]      = generation_;
+    slots_[index]            = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back(node);
+  }
 
   const SearchNode *Find(graph::VertexID vertex_id) const;
 
+  // The number of vertices settled, the start excluded.
+  size_t size() const { return nodes_.size(); }
+
+ private:
+  const graph::VertexNumbering *numbering_ = nullptr;
+  graph::VertexIndex start_                = graph::kInvalidVertexIndex;
+  // A vertex is in the tree if its entry in generations_ is generation_.
+  uint32_t generation_ = 0;
+  std::vector<uint32_t> generations_{};
+  // The position of each reached vertex in nodes_, indexed by
+  // Vertex::index(). Only meaningful for the vertices in the tree.
+  std::vector<uint32_t> slots_{};
+  std::vector<SearchNode> nodes_{};
+};
+
+// The memory of a search: the tree, the scoreboard and the priority queue. Pass
+// the same workspace to repeated searches, e.g. the many small ones of the
+// contraction, so that once it has grown to the size of the graph a search does
+// not allocate at all. Clearing it is O(1) as well, see SearchTree::Reset().
+//
+// The radix heap is the default, as it was the fastest on road-like grids,
+// where the searches rarely improve a vertex that is already in the queue.
+class DijkstraWorkspace {
+ public:
+  explicit DijkstraWorkspace(PriorityQueueType queue_type = PriorityQueueType::kRadixHeap)
+      : queue_type_(queue_type) {}
+
+  // Prepares the workspace for a search from the start, which is reached at
+  // cost 0 and has no parent.
+  void Reset(const graph::VertexNumbering &numbering, graph::VertexIndex start);
+
+  // The best cost so far of the vertex, kInfiniteWeight if it is not reached.
+  graph::Weight score(graph::VertexIndex index) const {
+    return generations_[index] == generation_ ? scores_[index] : graph::kInfiniteWeight;
+  }
+
+  // The edge that reaches the vertex at score(). Only for the reached vertices
+  // other than the start.
+  const graph::Edge &parent(graph::VertexIndex index) const { return *parents_[index]; }
+
+  // Records that the vertex is reached at the cost through the edge.
+  void Relax(graph::VertexIndex index, graph::Weight score, const graph::Edge &edge) {
+    generations_[index] = generation_;
+    scores_[index]      = score;
+    parents_[index]     = &edge;
+  }
+
+  SearchTree &tree() { return tree_; }
+
+  PriorityQueueType queue_type() const { return queue_type_; }
+
+  LazyBinaryHeap &lazy_binary_heap() { return lazy_binary_heap_; }
+
+  IndexedFourAryHeap &four_ary_heap() { return four_ary_heap_; }
+
+  RadixHeap &radix_heap() { return radix_heap_; }
+
+  // The operations of the queue, over all the searches run in the workspace.
+  const PriorityQueueStats &queue_stats() const;
+
+  // Moves the tree of the last search out of the workspace.
+  SearchTree ReleaseTree() { return std::move(tree_); }
+
+  // Goals marked in the workspace instead of passed as a set, for the callers
+  // that run many searches toward the same goals, e.g. the witness searches of
+  // the contraction. Clearing them is O(1), the same way as Reset().
+  void ClearGoals(size_t num_vertices);
+
+  // Marking a goal twice counts it once.
+  void AddGoal(graph::VertexIndex index);
+
+  bool IsGoal(graph::VertexIndex index) const {
+    return goal_generations_[index] == goal_generation_;
+  }
+
+  size_t num_goals() const { return num_goals_; }
+
  private:
-  graph::VertexID start_id_;
-  std::unordered_map<graph::VertexID, SearchNode> nodes_{};
+  PriorityQueueType queue_type_;
+  SearchTree tree_{};
+  uint32_t generation_ = 0;
+  std::vector<uint32_t> generations_{};
+  std::vector<graph::Weight> scores_{};
+  std::vector<const graph::Edge *> parents_{};
+  uint32_t goal_generation_ = 0;
+  std::vector<uint32_t> goal_generations_{};
+  size_t num_goals_ = 0;
+  LazyBinaryHeap lazy_binary_heap_{};
+  IndexedFourAryHeap four_ary_heap_{};
+  RadixHeap radix_heap_{};
 };
 
 // Run Dijkstra algorithm on the input graph represented by the indexer, with
@@ -55,8 +166,37 @@ class SearchTree {
 // goals. The algorithm stops after the all the goals are reached or when the
 // search exhausts all the reachable vertices.
 //
-// Returns a search tree with one record for each of the reached vertices.
+// Returns a search tree with one record for each of the reached vertices. The
+// indexer must be created by SimpleIndexer::CreateFromRawGraph().
 SearchTree RunDijkstra(const graph::SimpleIndexer &indexer, graph::VertexID start,
                        const std::unordered_set<graph::VertexID> &goals);
 
+// Same as above, but runs in the workspace. The returned tree lives in the
+// workspace, and stays valid until its next search. The search also stops at
+// the first vertex it settles that costs more than the limit, so all the
+// vertices within the limit are in the tree but the goals beyond it may not be.
+const SearchTree &RunDijkstra(const graph::SimpleIndexer &indexer, graph::VertexID start,
+                              const std::unordered_set<graph::VertexID> &goals,
+                              DijkstraWorkspace *workspace,
+                              graph::Weight limit = graph::kInfiniteWeight);
+
+// Same as above, but toward the goals marked in the workspace by AddGoal(), so
+// that the searches do not copy a goal set. The start does not count as a goal
+// even if it is marked. The search never goes through the avoided vertex, e.g.
+// the one being contracted when looking for witnesses.
+const SearchTree &RunDijkstraToMarkedGoals(
+    const graph::SimpleIndexer &indexer, graph::VertexID start,
+    DijkstraWorkspace *workspace, graph::Weight limit = graph::kInfiniteWeight,
+    graph::VertexIndex avoid = graph::kInvalidVertexIndex);
+
+// Same as above, but runs on the CSR index, where the relaxation loop does not
+// do any hash lookup. Produces the same search tree as the SimpleIndexer
+// version on the same graph.
+SearchTree RunDijkstra(const graph::CsrGraph &graph, graph::VertexID start,
+                       const std::unordered_set<graph::VertexID> &goals);
+
+const SearchTree &RunDijkstra(const graph::CsrGraph &graph, graph::VertexID start,
+                              const std::unordered_set<graph::VertexID> &goals,
+                              DijkstraWorkspace *workspace);
+
 }  // namespace open_semap
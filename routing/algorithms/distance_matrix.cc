@@ -0,0 +1,164 @@
+#include "algorithms/distance_matrix.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+using graph::VertexID;
+using graph::VertexIndex;
+using graph::Weight;
+using graph::kInvalidVertexIndex;
+
+namespace {
+
+// A vertex settled by the backward search from a target.
+struct Settled {
+  VertexIndex vertex;
+  uint32_t target;
+  Weight cost;
+};
+
+// What the bucket of a vertex holds for each target whose search settled it.
+struct BucketEntry {
+  uint32_t target;
+  Weight cost;
+};
+
+// Calls task(i, worker) for each i in [0, count), over up to num_workers
+// threads. The tasks of the same worker run one after the other, so that they
+// can share the worker's workspace.
+template <typename Task>
+void ParallelFor(size_t count, size_t num_workers, const Task &task) {
+  num_workers = std::min(num_workers, count);
+  if (num_workers <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i, 0);
+    }
+    return;
+  }
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < num_workers; ++worker) {
+    workers.emplace_back([&next, &task, count, worker]() {
+      for (size_t i = next++; i < count; i = next++) {
+        task(i, worker);
+      }
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+std::vector<VertexIndex> FindIndices(const ContractionHierarchy &hierarchy,
+                                     const std::vector<VertexID> &ids) {
+  std::vector<VertexIndex> indices;
+  indices.reserve(ids.size());
+  for (VertexID id : ids) {
+    VertexIndex index = hierarchy.FindIndex(id);
+    if (index == kInvalidVertexIndex) {
+      spdlog::critical("ComputeDistanceMatrix(): Cannot find vertex with ID = {}", id);
+    }
+    indices.emplace_back(index);
+  }
+  return indices;
+}
+
+}  // namespace
+
+DistanceMatrix ComputeDistanceMatrix(const ContractionHierarchy &hierarchy,
+                                     const std::vector<VertexID> &sources,
+                                     const std::vector<VertexID> &targets,
+                                     int num_threads) {
+  DistanceMatrix matrix;
+  matrix.num_sources = sources.size();
+  matrix.num_targets = targets.size();
+  matrix.costs.assign(sources.size() * targets.size(), graph::kInfiniteWeight);
+
+  const size_t n = hierarchy.num_vertices();
+
+  std::vector<VertexIndex> source_indices = FindIndices(hierarchy, sources);
+  std::vector<VertexIndex> target_indices = FindIndices(hierarchy, targets);
+
+  const size_t num_workers = static_cast<size_t>(std::max(num_threads, 1));
+  std::vector<UpwardSearch> searches(num_workers);
+
+  // The backward searches, each worker collecting what it settles.
+  std::vector<std::vector<Settled>> settled(num_workers);
+  ParallelFor(targets.size(), num_workers, [&](size_t j, size_t worker) {
+    if (target_indices[j] == kInvalidVertexIndex) {
+      return;
+    }
+    UpwardSearch &search = searches[worker];
+    search.Reset(n, target_indices[j]);
+    bool stalled = false;
+    while (true) {
+      VertexIndex v = search.SettleNext(hierarchy, SearchDirection::kBackward,
+                                        graph::kInfiniteWeight, &stalled);
+      if (v == kInvalidVertexIndex) {
+        break;
+      }
+      if (!stalled) {
+        settled[worker].emplace_back(
+            Settled{v, static_cast<uint32_t>(j), search.score(v)});
+      }
+    }
+  });
+
+  // Counting sort the settled vertices into the buckets, a CSR index by
+  // vertex.
+  std::vector<size_t> offsets(n + 1, 0);
+  for (const std::vector<Settled> &entries : settled) {
+    for (const Settled &entry : entries) {
+      ++offsets[entry.vertex + 1];
+    }
+  }
+  for (size_t v = 0; v < n; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<BucketEntry> buckets(offsets[n]);
+  {
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::vector<Settled> &entries : settled) {
+      for (const Settled &entry : entries) {
+        buckets[fill[entry.vertex]++] = BucketEntry{entry.target, entry.cost};
+      }
+      entries = std::vector<Settled>();
+    }
+  }
+
+  // The forward searches, each filling its own row.
+  ParallelFor(sources.size(), num_workers, [&](size_t i, size_t worker) {
+    if (source_indices[i] == kInvalidVertexIndex) {
+      return;
+    }
+    Weight *row          = matrix.costs.data() + i * targets.size();
+    UpwardSearch &search = searches[worker];
+    search.Reset(n, source_indices[i]);
+    bool stalled = false;
+    while (true) {
+      VertexIndex v = search.SettleNext(hierarchy, SearchDirection::kForward,
+                                        graph::kInfiniteWeight, &stalled);
+      if (v == kInvalidVertexIndex) {
+        break;
+      }
+      if (stalled) {
+        continue;
+      }
+      Weight cost = search.score(v);
+      for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+        const BucketEntry &entry = buckets[k];
+        Weight through           = graph::AddWeights(cost, entry.cost);
+        row[entry.target]        = std::min(row[entry.target], through);
+      }
+    }
+  });
+
+  return matrix;
+}
+
+}  // namespace open_semap
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "algorithms/contraction_hierarchy.h"
+#include "graph/defs.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// The travel costs from each of the sources to each of the targets, as a dense
+// row-major matrix: one row per source, one column per target.
+struct DistanceMatrix {
+  inline graph::Weight at(size_t source, size_t target) const {
+    return costs[source * num_targets + target];
+  }
+
+  size_t num_sources = 0;
+  size_t num_targets = 0;
+  // kInfiniteWeight where the target cannot be reached from the source.
+  std::vector<graph::Weight> costs{};
+};
+
+// Computes the costs from all the sources to all the targets on the hierarchy,
+// with the bucket method. A backward upward search from each target leaves the
+// cost of each vertex it settles in the bucket of the vertex. A forward upward
+// search from each source then scans the buckets of the vertices it settles:
+// every shortest route goes up from the source and down to the target, and
+// meets the target's search at its highest vertex. So the matrix takes one
+// search per source and one per target, each only as large as a CH query side,
+// instead of a full Dijkstra per source.
+//
+// The gain grows with the graph, since a Dijkstra search grows with the graph
+// and an upward search much slower. On a graph of a few thousand vertices the
+// bucket scans cost as much as the Dijkstra searches they replace.
+//
+// The searches are spread over num_threads threads, each with its own
+// workspace. The rows and columns of the IDs not in the graph are left
+// infinite, after logging.
+DistanceMatrix ComputeDistanceMatrix(const ContractionHierarchy &hierarchy,
+                                     const std::vector<graph::VertexID> &sources,
+                                     const std::vector<graph::VertexID> &targets,
+                                     int num_threads = 1);
+
+}  // namespace open_semap
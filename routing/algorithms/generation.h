@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace open_semap {
+
+// The searches keep their per-vertex state in arrays indexed by vertex, and
+// tag every entry with the generation that wrote it. An entry only counts if
+// its generation is the current one, so the arrays are cleared in O(1) between
+// searches.
+//
+// Moves on to the next generation of the entries, so that all of them read as
+// cleared. Grows the entries to the size first.
+inline void NextGeneration(size_t size, uint32_t *generation,
+                           std::vector<uint32_t> *generations) {
+  if (generations->size() < size) {
+    generations->resize(size, 0);
+  }
+  if (++*generation == 0) {
+    // Wrapped around: the old entries could match again, clear them for real.
+    std::fill(generations->begin(), generations->end(), 0);
+    *generation = 1;
+  }
+}
+
+}  // namespace open_semap
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "graph/defs.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// The priority queues that RunDijkstra() can settle the vertices with, see
+// DijkstraWorkspace.
+enum class PriorityQueueType {
+  // A binary heap on std::push_heap(). An improved vertex is pushed again, and
+  // the stale entries are skipped when they are popped.
+  kLazyBinaryHeap,
+  // A 4-ary heap that knows the position of each vertex, and lowers its key in
+  // place. Shallower than a binary heap, and never holds a vertex twice.
+  kIndexedFourAryHeap,
+  // A radix heap over the integer weights. It only works because Dijkstra pops
+  // the keys in increasing order. Improved vertices are pushed again, as with
+  // the lazy binary heap.
+  kRadixHeap,
+};
+
+const char *PriorityQueueName(PriorityQueueType type);
+
+// The number of operations done by a queue since it was created.
+struct PriorityQueueStats {
+  uint64_t pushes        = 0;
+  uint64_t decrease_keys = 0;
+  uint64_t pops          = 0;
+};
+
+// All the queues have the same interface:
+//
+//   void Clear();
+//   bool empty() const;
+//   // Adds the vertex with the key, or lowers its key.
+//   void Push(graph::VertexIndex vertex, graph::Weight key);
+//   // Removes and returns the entry of the lowest key.
+//   QueueEntry Pop();
+//
+// Clear() keeps the memory, so that a queue reused over many searches stops
+// allocating once it has grown.
+struct QueueEntry {
+  graph::Weight key;
+  graph::VertexIndex vertex;
+};
+
+class LazyBinaryHeap {
+ public:
+  void Clear() { heap_.clear(); }
+
+  bool empty() const { return heap_.empty(); }
+
+  void Push(graph::VertexIndex vertex, graph::Weight key) {
+    ++stats_.pushes;
+    heap_.push_back(QueueEntry{key, vertex});
+    std::push_heap(heap_.begin(), heap_.end(), Greater);
+  }
+
+  QueueEntry Pop() {
+    ++stats_.pops;
+    std::pop_heap(heap_.begin(), heap_.end(), Greater);
+    QueueEntry top = heap_.back();
+    heap_.pop_back();
+    return top;
+  }
+
+  const PriorityQueueStats &stats() const { return stats_; }
+
+ private:
+  static bool Greater(const QueueEntry &a, const QueueEntry &b) { return a.key > b.key; }
+
+  std::vector<QueueEntry> heap_{};
+  PriorityQueueStats stats_{};
+};
+
+class IndexedFourAryHeap {
+ public:
+  // The vertices pushed must be less than the size.
+  void Reserve(size_t num_vertices) {
+    if (positions_.size() < num_vertices) {
+      positions_.resize(num_vertices, kNotInHeap);
+    }
+  }
+
+  void Clear() {
+    for (const QueueEntry &entry : heap_) {
+      positions_[entry.vertex] = kNotInHeap;
+    }
+    heap_.clear();
+  }
+
+  bool empty() const { return heap_.empty(); }
+
+  void Push(graph::VertexIndex vertex, graph::Weight key) {
+    uint32_t position = positions_[vertex];
+    if (position == kNotInHeap) {
+      ++stats_.pushes;
+      position = static_cast<uint32_t>(heap_.size());
+      heap_.push_back(QueueEntry{key, vertex});
+    } else if (key < heap_[position].key) {
+      ++stats_.decrease_keys;
+      heap_[position].key = key;
+    } else {
+      return;
+    }
+    SiftUp(position);
+  }
+
+  QueueEntry Pop() {
+    ++stats_.pops;
+    QueueEntry top         = heap_.front();
+    positions_[top.vertex] = kNotInHeap;
+    QueueEntry last        = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+      heap_.front()           = last;
+      positions_[last.vertex] = 0;
+      SiftDown(0);
+    }
+    return top;
+  }
+
+  const PriorityQueueStats &stats() const { return stats_; }
+
+ private:
+  static constexpr uint32_t kArity     = 4;
+  static constexpr uint32_t kNotInHeap = std::numeric_limits<uint32_t>::max();
+
+  void SiftUp(uint32_t position) {
+    QueueEntry entry = heap_[position];
+    while (position > 0) {
+      uint32_t parent = (position - 1) / kArity;
+      if (heap_[parent].key <= entry.key) {
+        break;
+      }
+      Place(position, heap_[parent]);
+      position = parent;
+    }
+    Place(position, entry);
+  }
+
+  void SiftDown(uint32_t position) {
+    QueueEntry entry    = heap_[position];
+    const uint32_t size = static_cast<uint32_t>(heap_.size());
+    while (true) {
+      uint32_t first = position * kArity + 1;
+      if (first >= size) {
+        break;
+      }
+      uint32_t last = std::min(first + kArity, size);
+      uint32_t best = first;
+      for (uint32_t child = first + 1; child < last; ++child) {
+        if (heap_[child].key < heap_[best].key) {
+          best = child;
+        }
+      }
+      if (entry.key <= heap_[best].key) {
+        break;
+      }
+      Place(position, heap_[best]);
+      position = best;
+    }
+    Place(position, entry);
+  }
+
+  void Place(uint32_t position, const QueueEntry &entry) {
+    heap_[position]          = entry;
+    positions_[entry.vertex] = position;
+  }
+
+  std::vector<QueueEntry> heap_{};
+  // The position of each vertex in heap_, or kNotInHeap.
+  std::vector<uint32_t> positions_{};
+  PriorityQueueStats stats_{};
+};
+
+// Keys are put in buckets by the highest bit in which they differ from the last
+// popped key, so that an entry moves down at most 32 times before it is popped.
+// The keys pushed must not be less than the last popped key.
+class RadixHeap {
+ public:
+  void Clear() {
+    for (std::vector<QueueEntry> &bucket : buckets_) {
+      bucket.clear();
+    }
+    size_ = 0;
+    last_ = 0;
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  void Push(graph::VertexIndex vertex, graph::Weight key) {
+    ++stats_.pushes;
+    buckets_[Bucket(key)].push_back(QueueEntry{key, vertex});
+    ++size_;
+  }
+
+  QueueEntry Pop() {
+    ++stats_.pops;
+    if (buckets_[0].empty()) {
+      size_t i = 1;
+      while (buckets_[i].empty()) {
+        ++i;
+      }
+      // The entries of the first non-empty bucket all go to lower buckets once
+      // their minimum is the last key.
+      std::vector<QueueEntry> &bucket = buckets_[i];
+      last_                           = bucket.front().key;
+      for (const QueueEntry &entry : bucket) {
+        last_ = std::min(last_, entry.key);
+      }
+      for (const QueueEntry &entry : bucket) {
+        buckets_[Bucket(entry.key)].push_back(entry);
+      }
+      bucket.clear();
+    }
+    QueueEntry top = buckets_[0].back();
+    buckets_[0].pop_back();
+    --size_;
+    return top;
+  }
+
+  const PriorityQueueStats &stats() const { return stats_; }
+
+ private:
+  static constexpr size_t kNumBuckets = 33;
+
+  size_t Bucket(graph::Weight key) const {
+    graph::Weight diff = key ^ last_;
+    return diff == 0 ? 0 : 32 - static_cast<size_t>(__builtin_clz(diff));
+  }
+
+  std::array<std::vector<QueueEntry>, kNumBuckets> buckets_{};
+  size_t size_        = 0;
+  graph::Weight last_ = 0;
+  PriorityQueueStats stats_{};
+};
+
+}  // namespace open_semap
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "graph/edge.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// The answer to a point-to-point query.
+struct Route {
+  inline bool found() const { return cost != graph::kInfiniteWeight; }
+
+  // kInfiniteWeight if the target cannot be reached from the source.
+  graph::Weight cost = graph::kInfiniteWeight;
+
+  // The edges from the source to the target, in order. Empty if the source is
+  // the target, or if the route is not found.
+  std::vector<const graph::Edge *> edges{};
+
+  // The number of vertices settled to answer the query, to compare the
+  // algorithms with each other.
+  size_t num_settled = 0;
+};
+
+}  // namespace open_semap
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "algorithms/route.h"
+#include "graph/edge.h"
+#include "graph/weight.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+// Shared by the tests of the point-to-point queries. Only include it from the
+// tests, as it depends on gtest.
+//
+// Checks that the edges of the route lead from the source to the target, one
+// after the other, and add up to its cost.
+inline void ExpectConnected(const Route &route, graph::VertexID source,
+                            graph::VertexID target) {
+  graph::Weight cost      = 0;
+  graph::VertexID current = source;
+  for (const graph::Edge *edge : route.edges) {
+    ASSERT_EQ(current, edge->from().id());
+    cost    = graph::AddWeights(cost, edge->cost());
+    current = edge->to().id();
+  }
+  EXPECT_EQ(target, current);
+  EXPECT_EQ(route.cost, cost);
+}
+
+}  // namespace open_semap
@@ -0,0 +1,109 @@
+#include "algorithms/snapshot_dijkstra.h"
+
+#include <algorithm>
+
+#include "algorithms/generation.h"
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+using graph::GraphSnapshot;
+using graph::SnapshotArc;
+using graph::VertexID;
+using graph::VertexIndex;
+using graph::Weight;
+
+void SnapshotSearchWorkspace::Reset(size_t num_vertices, VertexIndex start) {
+  NextGeneration(num_vertices, &generation_, &generations_);
+  if (scores_.size() < num_vertices) {
+    scores_.resize(num_vertices);
+    parents_.resize(num_vertices);
+  }
+  generations_[start] = generation_;
+  scores_[start]      = 0;
+  queue_.Clear();
+}
+
+SnapshotRoute RunDijkstra(const GraphSnapshot &snapshot, VertexID source, VertexID target,
+                          SnapshotSearchWorkspace *workspace) {
+  SnapshotRoute route;
+
+  VertexIndex source_index = snapshot.FindIndex(source);
+  if (source_index == graph::kInvalidVertexIndex) {
+    spdlog::critical("RunDijkstra(): Cannot find vertex with ID = {}", source);
+    return route;
+  }
+  VertexIndex target_index = snapshot.FindIndex(target);
+  if (target_index == graph::kInvalidVertexIndex) {
+    spdlog::critical("RunDijkstra(): Cannot find vertex with ID = {}", target);
+    return route;
+  }
+  if (source_index == target_index) {
+    route.cost = 0;
+    return route;
+  }
+
+  const size_t num_vertices = snapshot.num_vertices();
+  const size_t num_edges    = snapshot.num_edges();
+  workspace->Reset(num_vertices, source_index);
+  RadixHeap &queue = workspace->queue();
+  queue.Push(source_index, 0);
+
+  while (!queue.empty()) {
+    // A vertex is pushed again whenever it improves, which leaves stale
+    // entries behind with a key above its score.
+    QueueEntry elected = queue.Pop();
+    if (elected.key != workspace->score(elected.vertex)) {
+      continue;
+    }
+    ++route.num_settled;
+    if (elected.vertex == target_index) {
+      route.cost = elected.key;
+      break;
+    }
+
+    uint32_t end = snapshot.out_end(elected.vertex);
+    if (end > num_edges) {
+      spdlog::critical("Skipping the corrupted arcs of vertex {} in the snapshot.",
+                       snapshot.vertices()[elected.vertex].id);
+      continue;
+    }
+    for (uint32_t i = snapshot.out_begin(elected.vertex); i < end; ++i) {
+      const SnapshotArc &arc = snapshot.arc(i);
+      if (arc.head >= num_vertices || arc.edge >= num_edges) {
+        spdlog::critical("Skipping the corrupted arc {} in the snapshot.", i);
+        continue;
+      }
+      Weight updated_cost = graph::AddWeights(elected.key, arc.weight);
+      if (updated_cost < workspace->score(arc.head)) {
+        workspace->Relax(arc.head, updated_cost, arc.edge);
+        queue.Push(arc.head, updated_cost);
+      }
+    }
+  }
+
+  if (!route.found()) {
+    return route;
+  }
+  // The route has at most one edge per settled vertex, unless the arcs do not
+  // match their edges.
+  for (VertexIndex v = target_index; v != source_index;) {
+    uint32_t edge = workspace->parent(v);
+    if (snapshot.edges()[edge].to != v || route.edges.size() == route.num_settled) {
+      spdlog::critical("The arcs of the snapshot do not match its edges.");
+      return SnapshotRoute{};
+    }
+    route.edges.push_back(edge);
+    v = snapshot.edges()[edge].from;
+  }
+  std::reverse(route.edges.begin(), route.edges.end());
+  return route;
+}
+
+SnapshotRoute RunDijkstra(const GraphSnapshot &snapshot, VertexID source,
+                          VertexID target) {
+  SnapshotSearchWorkspace workspace;
+  return RunDijkstra(snapshot, source, target, &workspace);
+}
+
+}  // namespace open_semap
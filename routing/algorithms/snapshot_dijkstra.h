@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "algorithms/priority_queue.h"
+#include "graph/defs.h"
+#include "graph/snapshot.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+
+// The answer to a point-to-point query on a snapshot. Same as Route, but the
+// edges are indices into GraphSnapshot::edges(), since there are no Edge
+// objects behind a snapshot.
+struct SnapshotRoute {
+  inline bool found() const { return cost != graph::kInfiniteWeight; }
+
+  // kInfiniteWeight if the target cannot be reached from the source.
+  graph::Weight cost = graph::kInfiniteWeight;
+
+  // The edges from the source to the target, in order. Empty if the source is
+  // the target, or if the route is not found.
+  std::vector<uint32_t> edges{};
+
+  // The number of vertices settled to answer the query.
+  size_t num_settled = 0;
+};
+
+// The memory of the searches on a snapshot, to be reused over the queries in
+// the same way as DijkstraWorkspace. The only memory a query needs beyond the
+// mapping.
+class SnapshotSearchWorkspace {
+ public:
+  // Prepares the workspace for a search from the start, which is reached at
+  // cost 0.
+  void Reset(size_t num_vertices, graph::VertexIndex start);
+
+  // The best cost so far of the vertex, kInfiniteWeight if it is not reached.
+  graph::Weight score(graph::VertexIndex index) const {
+    return generations_[index] == generation_ ? scores_[index] : graph::kInfiniteWeight;
+  }
+
+  // The edge that reaches the vertex at score(). Only for the reached vertices
+  // other than the start.
+  uint32_t parent(graph::VertexIndex index) const { return parents_[index]; }
+
+  void Relax(graph::VertexIndex index, graph::Weight score, uint32_t edge) {
+    generations_[index] = generation_;
+    scores_[index]      = score;
+    parents_[index]     = edge;
+  }
+
+  RadixHeap &queue() { return queue_; }
+
+ private:
+  uint32_t generation_ = 0;
+  std::vector<uint32_t> generations_{};
+  std::vector<graph::Weight> scores_{};
+  std::vector<uint32_t> parents_{};
+  RadixHeap queue_{};
+};
+
+// Finds the shortest route from the source to the target with Dijkstra
+// algorithm, on the search index of the snapshot as it is mapped, so that a
+// server answers queries right after GraphSnapshot::Open() without building a
+// RoadGraph. Settles the same vertices as RunDijkstra() on a CsrGraph of the
+// same graph, up to ties.
+//
+// Returns a route that is not found(), after logging, if the source or the
+// target is not in the snapshot. The arcs that point out of the snapshot are
+// skipped, after logging, as in GraphSnapshot::ToRoadGraph().
+SnapshotRoute RunDijkstra(const graph::GraphSnapshot &snapshot, graph::VertexID source,
+                          graph::VertexID target, SnapshotSearchWorkspace *workspace);
+
+SnapshotRoute RunDijkstra(const graph::GraphSnapshot &snapshot, graph::VertexID source,
+                          graph::VertexID target);
+
+}  // namespace open_semap
@@ -1,6 +1,7 @@
+#include <memory>
 #include <sstream>
 #include <string>
-#include <unordered_set>
+#include <thread>
 #include <vector>
 
 #include "gflags/gflags.h"
@@ -11,6 +12,9 @@
 #include "utils/extract_junction.h"
 #include "utils/filter_bounding_box.h"
 #include "utils/filter_isolated_roads.h"
+#include "utils/fused_pipeline.h"
+#include "utils/metrics.h"
+#include "utils/routing_profile.h"
 #include "utils/split_road.h"
 
 DEFINE_string(input, "/home/breakds/dataset/osm/kirkwood.osm",
@@ -23,6 +27,30 @@ DEFINE_string(
     bounding_box, "-180.0,-90.0,180.0,90.0",
     "The bounding box of interest, in format \"lon_min,lat_min,lon_max,lat_max\".");
 
+DEFINE_int32(num_threads, std::thread::hardware_concurrency(),
+             "The number of threads used to extract the junctions and split the roads.");
+
+DEFINE_bool(fused, false,
+            "Run the fused pipeline which decodes the input twice instead of four times. "
+            "The input has to be sorted (nodes before ways). It holds the road nodes "
+            "(40 bytes each) and the split ways in memory until the end, i.e. tens of "
+            "GB for the planet.");
+
+DEFINE_int32(junction_memory_budget_mb, 0,
+             "When positive, extract the junctions with sorted runs on disk, using at "
+             "most this much memory (in MB) for the node refs. It only bounds the "
+             "junction extraction: the later stages still hold the roads and their "
+             "nodes as ID sets, and the locations of the useful nodes (16 bytes each), "
+             "in memory. Not used by --fused.");
+
+DEFINE_string(tmp_dir, "/tmp",
+              "The directory for the temporary files of --junction_memory_budget_mb.");
+
+DEFINE_string(profile, "",
+              "The routing profile that decides which ways are roads, e.g. "
+              "profiles/car.profile. When empty, any highway except footways and "
+              "service roads is a road.");
+
 osmium::Box ParseBoundingBox(const std::string text) {
   std::stringstream stream(text);
   std::string token;
@@ -41,13 +69,39 @@ int main(int argc, char** argv) {
 
   osmium::Box box = ParseBoundingBox(FLAGS_bounding_box);
 
-  std::unordered_set<osmium::object_id_type> junctions =
-      open_semap::ExtractJunction(FLAGS_input);
+  if (!FLAGS_profile.empty()) {
+    std::unique_ptr<open_semap::RoutingProfile> profile =
+        open_semap::RoutingProfile::LoadFromFile(FLAGS_profile);
+    if (profile == nullptr) {
+      return 1;
+    }
+    open_semap::SetActiveProfile(std::move(profile));
+  }
+
+  if (FLAGS_fused) {
+    open_semap::FusedPipelineStats stats =
+        open_semap::ExtractRoutesFused(FLAGS_input, FLAGS_output, box, FLAGS_num_threads);
+    spdlog::info("Stats: {} nodes", stats.num_useful_nodes);
+    spdlog::info("Stats: {} junctions", stats.num_junctions);
+    spdlog::info("Stats: {} roads", stats.num_roads);
+    open_semap::MetricsRegistry::Global().WriteJson(FLAGS_output + ".metrics.json");
+    return 0;
+  }
+
+  open_semap::IdSet junctions;
+  if (FLAGS_junction_memory_budget_mb > 0) {
+    open_semap::ExternalMemoryOptions options;
+    options.memory_budget = static_cast<size_t>(FLAGS_junction_memory_budget_mb) << 20;
+    options.tmp_dir       = FLAGS_tmp_dir;
+    junctions             = open_semap::ExtractJunctionExternal(FLAGS_input, options);
+  } else {
+    junctions = open_semap::ExtractJunction(FLAGS_input, FLAGS_num_threads);
+  }
 
   junctions = open_semap::FilterBoundingBox(FLAGS_input, junctions, box);
 
-  std::unordered_set<osmium::object_id_type> roads;
-  std::unordered_set<osmium::object_id_type> useful_nodes;
+  open_semap::IdSet roads;
+  open_semap::IdSet useful_nodes;
   // Thank god we have copy ellision.
   std::tie(roads, useful_nodes) = open_semap::FilterIsolatedRoads(FLAGS_input, junctions);
 
@@ -55,7 +109,11 @@ int main(int argc, char** argv) {
   spdlog::info("Stats: {} junctions", junctions.size());
   spdlog::info("Stats: {} roads", roads.size());
 
-  open_semap::SplitRoad(FLAGS_input, FLAGS_output, junctions, roads, useful_nodes);
+  open_semap::SplitRoad(FLAGS_input, FLAGS_output, junctions, roads, useful_nodes,
+                        FLAGS_num_threads);
+
+  // Next to the output, so that runs can be compared against each other.
+  open_semap::MetricsRegistry::Global().WriteJson(FLAGS_output + ".metrics.json");
 
   return 0;
 }
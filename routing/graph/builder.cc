@@ -1,30 +1,94 @@
 #include "graph/builder.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "osmium/geom/haversine.hpp"
+
 namespace open_semap {
 namespace graph {
 
-static auto AddVertexIfNotExist(VertexID id,
-                                std::vector<std::unique_ptr<Vertex>> *vertices)
-    -> const Vertex & {
-  auto iter = std::find_if(
-      vertices->begin(), vertices->end(),
-      [id](const std::unique_ptr<Vertex> &vertex) { return vertex->id() == id; });
-  if (iter != vertices->end()) {
-    return **iter;
-  }
-  vertices->emplace_back(std::make_unique<Vertex>(id, osmium::Location()));
-  return *vertices->back();
-};
-
 RoadGraphBuilder &RoadGraphBuilder::AddEdge(VertexID from, VertexID to, double length) {
-  const Vertex &a = AddVertexIfNotExist(from, &vertices_);
-  const Vertex &b = AddVertexIfNotExist(to, &vertices_);
-  edges_.emplace_back(std::make_unique<Edge>(a, b, length));
+  const Vertex *a = graph_.FindVertex(from);
+  if (a == nullptr) {
+    a = &graph_.AddVertex(from, osmium::Location());
+  }
+  const Vertex *b = graph_.FindVertex(to);
+  if (b == nullptr) {
+    b = &graph_.AddVertex(to, osmium::Location());
+  }
+  Edge &edge = graph_.AddEdge(*a, *b, length);
+  // Edges are numbered in the order they are added, starting from 1.
+  edge.id_     = static_cast<EdgeID>(graph_.edges().size());
+  edge.weight_ = static_cast<Weight>(std::lround(length));
   return *this;
 }
 
 RoadGraph RoadGraphBuilder::Build() {
-  return RoadGraph(std::move(vertices_), std::move(edges_));
+  return std::move(graph_);
+}
+
+RoadGraph MakePaperExampleGraph() {
+  return RoadGraphBuilder()
+      .AddEdge(2, 6, 2.0)
+      .AddEdge(6, 2, 2.0)
+      .AddEdge(6, 1, 3.0)
+      .AddEdge(1, 6, 3.0)
+      .AddEdge(1, 4, 2.0)
+      .AddEdge(4, 1, 2.0)
+      .AddEdge(5, 3, 2.0)
+      .AddEdge(3, 5, 2.0)
+      .AddEdge(3, 4, 1.0)
+      .AddEdge(4, 3, 1.0)
+      .Build();
+}
+
+RoadGraph MakeGridGraph(size_t num_rows, size_t num_cols, uint32_t shuffle_seed) {
+  constexpr double kOriginLon = -122.0;
+  constexpr double kOriginLat = 37.4;
+  constexpr double kSpacing   = 0.001;
+  constexpr double kSpeed     = 50.0;
+
+  std::vector<size_t> cells(num_rows * num_cols);
+  std::iota(cells.begin(), cells.end(), 0);
+  if (shuffle_seed != 0) {
+    std::mt19937 rng(shuffle_seed);
+    std::shuffle(cells.begin(), cells.end(), rng);
+  }
+
+  RoadGraph graph;
+  std::vector<const Vertex *> vertices(num_rows * num_cols);
+  for (size_t cell : cells) {
+    size_t row = cell / num_cols;
+    size_t col = cell % num_cols;
+    osmium::Location location(kOriginLon + kSpacing * col, kOriginLat + kSpacing * row);
+    vertices[cell] = &graph.AddVertex(static_cast<VertexID>(cell + 1), location);
+  }
+
+  auto connect = [&graph](const Vertex &a, const Vertex &b) {
+    double length = osmium::geom::haversine::distance(a.loc(), b.loc());
+    for (const auto &ends : {std::make_pair(&a, &b), std::make_pair(&b, &a)}) {
+      Edge &edge = graph.AddEdge(*ends.first, *ends.second, length);
+      edge.id_     = static_cast<EdgeID>(graph.edges().size());
+      edge.weight_ = TravelTime(length, kSpeed);
+      graph.SetPoints(edge, {ends.first->loc(), ends.second->loc()});
+    }
+  };
+  for (size_t row = 0; row < num_rows; ++row) {
+    for (size_t col = 0; col < num_cols; ++col) {
+      const Vertex &vertex = *vertices[row * num_cols + col];
+      if (col + 1 < num_cols) {
+        connect(vertex, *vertices[row * num_cols + col + 1]);
+      }
+      if (row + 1 < num_rows) {
+        connect(vertex, *vertices[(row + 1) * num_cols + col]);
+      }
+    }
+  }
+
+  return graph;
 }
 
 }  // namespace graph
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 #include "graph/edge.h"
@@ -16,15 +17,36 @@ class RoadGraphBuilder {
   RoadGraphBuilder() = default;
 
   // Add an edge that connects the vertices `from` and `to`, with the
-  // specified length.
+  // specified length. The length rounded is used as the travel time as well, so
+  // that tests can spell out the costs directly.
   RoadGraphBuilder &AddEdge(VertexID from, VertexID to, double length);
 
   RoadGraph Build();
 
  private:
-  std::vector<std::unique_ptr<Vertex>> vertices_{};
-  std::vector<std::unique_ptr<Edge>> edges_{};
+  RoadGraph graph_{};
 };
 
+// The example of the contraction hierarchy slides at
+// https://algo2.iti.kit.edu/download/presentation.pdf, a path with roads in
+// both directions:
+//
+//    2     3     2     1     2
+// 2 --- 6 --- 1 --- 4 --- 3 --- 5
+//
+// Used by the tests of the contraction and of the hierarchy.
+RoadGraph MakePaperExampleGraph();
+
+// Builds a synthetic grid of num_rows x num_cols vertices, 0.001 degree apart,
+// where each vertex connects its 4 neighbors with 50 km/h roads in both
+// directions.
+// The vertex IDs are row * num_cols + col + 1. Used by the tests and the
+// benchmarks that need a graph larger than the test data.
+//
+// The vertices are added row by row, unless shuffle_seed is not 0, in which
+// case they are added in a random order, the way the nodes of a real OSM file
+// (sorted by ID) are scattered over the map.
+RoadGraph MakeGridGraph(size_t num_rows, size_t num_cols, uint32_t shuffle_seed = 0);
+
 }  // namespace graph
 }  // namespace open_semap
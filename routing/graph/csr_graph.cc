@@ -0,0 +1,83 @@
+#include "graph/csr_graph.h"
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+namespace graph {
+
+CsrGraph::Index CsrGraph::FindIndex(VertexID id) const { return numbering_->Find(id); }
+
+CsrGraph CsrGraph::CreateFromRawGraph(const RoadGraph &graph) {
+  CsrGraph csr;
+
+  csr.numbering_ = &graph.numbering();
+  csr.vertices_.reserve(graph.vertices().size());
+  for (const Vertex *vertex : graph.vertices()) {
+    csr.vertices_.emplace_back(vertex);
+  }
+
+  // Drop the edges that refer to vertices not in the graph, the same way as
+  // SimpleIndexer does.
+  auto index_of = [&csr](const Vertex &vertex) -> Index {
+    Index index = vertex.index();
+    return index < csr.vertices_.size() && csr.vertices_[index] == &vertex ? index
+                                                                          : kInvalidIndex;
+  };
+  struct Arc {
+    Index from;
+    Index to;
+    const Edge *edge;
+  };
+  std::vector<Arc> arcs;
+  arcs.reserve(graph.edges().size());
+  for (const Edge *edge : graph.edges()) {
+    Index from = index_of(edge->from());
+    Index to   = index_of(edge->to());
+    if (from == kInvalidIndex || to == kInvalidIndex) {
+      spdlog::info("CsrGraph cannot add edge ({} -> {}).", edge->from().id(),
+                   edge->to().id());
+      continue;
+    }
+    arcs.emplace_back(Arc{from, to, edge});
+  }
+
+  // Counting sort the arcs by their tails (forward) and heads (backward). The
+  // sort is stable, so the arcs of a vertex keep the order of
+  // RoadGraph::edges(), same as the outwards and inwards of SimpleIndexer.
+  const size_t n = csr.vertices_.size();
+  csr.out_offsets_.assign(n + 1, 0);
+  csr.in_offsets_.assign(n + 1, 0);
+  for (const Arc &arc : arcs) {
+    ++csr.out_offsets_[arc.from + 1];
+    ++csr.in_offsets_[arc.to + 1];
+  }
+  for (size_t v = 0; v < n; ++v) {
+    csr.out_offsets_[v + 1] += csr.out_offsets_[v];
+    csr.in_offsets_[v + 1] += csr.in_offsets_[v];
+  }
+
+  csr.out_heads_.resize(arcs.size());
+  csr.out_weights_.resize(arcs.size());
+  csr.out_edges_.resize(arcs.size());
+  csr.in_tails_.resize(arcs.size());
+  csr.in_weights_.resize(arcs.size());
+  csr.in_edges_.resize(arcs.size());
+
+  std::vector<Index> out_cursor(csr.out_offsets_.begin(), csr.out_offsets_.end() - 1);
+  std::vector<Index> in_cursor(csr.in_offsets_.begin(), csr.in_offsets_.end() - 1);
+  for (const Arc &arc : arcs) {
+    Index i             = out_cursor[arc.from]++;
+    csr.out_heads_[i]   = arc.to;
+    csr.out_weights_[i] = arc.edge->cost();
+    csr.out_edges_[i]   = arc.edge;
+    Index j             = in_cursor[arc.to]++;
+    csr.in_tails_[j]    = arc.from;
+    csr.in_weights_[j]  = arc.edge->cost();
+    csr.in_edges_[j]    = arc.edge;
+  }
+
+  return csr;
+}
+
+}  // namespace graph
+}  // namespace open_semap
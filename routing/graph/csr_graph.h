@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "graph/defs.h"
+#include "graph/edge.h"
+#include "graph/road_graph.h"
+#include "graph/vertex.h"
+#include "graph/vertex_numbering.h"
+#include "graph/weight.h"
+
+namespace open_semap {
+namespace graph {
+
+// An immutable, compressed sparse row (CSR) adjacency index of a RoadGraph.
+//
+// The vertices are indexed by Vertex::index(), i.e. in the order of
+// RoadGraph::vertices(). The outgoing arcs of the vertex v are the arcs
+// [out_begin(v), out_end(v)), and their heads and weights are stored in flat
+// arrays, so that the relaxation loop of a search reads contiguous memory
+// without any hash lookup. The incoming arcs are indexed the same way for
+// backward searches.
+//
+// Unlike SimpleIndexer, a CsrGraph cannot be patched. Rebuild it from the
+// RoadGraph after the graph changes. The RoadGraph must outlive it.
+class CsrGraph {
+ public:
+  using Index = VertexIndex;
+
+  static constexpr Index kInvalidIndex = kInvalidVertexIndex;
+
+  static CsrGraph CreateFromRawGraph(const RoadGraph &graph);
+
+  CsrGraph() = default;
+
+  CsrGraph(CsrGraph &&) noexcept = default;
+  CsrGraph &operator=(CsrGraph &&) noexcept = default;
+
+  inline size_t num_vertices() const { return vertices_.size(); }
+
+  inline size_t num_edges() const { return out_heads_.size(); }
+
+  // Returns kInvalidIndex if the graph does not have a vertex with the ID.
+  Index FindIndex(VertexID id) const;
+
+  inline const Vertex &vertex(Index v) const { return *vertices_[v]; }
+
+  inline const VertexNumbering &numbering() const { return *numbering_; }
+
+  // ---------- Outgoing arcs ----------
+
+  inline Index out_begin(Index v) const { return out_offsets_[v]; }
+
+  inline Index out_end(Index v) const { return out_offsets_[v + 1]; }
+
+  inline Index out_head(Index arc) const { return out_heads_[arc]; }
+
+  inline Weight out_weight(Index arc) const { return out_weights_[arc]; }
+
+  inline const Edge &out_edge(Index arc) const { return *out_edges_[arc]; }
+
+  // ---------- Incoming arcs ----------
+
+  inline Index in_begin(Index v) const { return in_offsets_[v]; }
+
+  inline Index in_end(Index v) const { return in_offsets_[v + 1]; }
+
+  // The index of the vertex that the arc comes from.
+  inline Index in_tail(Index arc) const { return in_tails_[arc]; }
+
+  inline Weight in_weight(Index arc) const { return in_weights_[arc]; }
+
+  inline const Edge &in_edge(Index arc) const { return *in_edges_[arc]; }
+
+ private:
+  std::vector<const Vertex *> vertices_{};
+  const VertexNumbering *numbering_ = nullptr;
+
+  // num_vertices() + 1 offsets each.
+  std::vector<Index> out_offsets_{};
+  std::vector<Index> in_offsets_{};
+
+  // num_edges() arcs each. The Edge pointers are only needed to report the
+  // search results in terms of the RoadGraph, and are never read during the
+  // relaxation.
+  std::vector<Index> out_heads_{};
+  std::vector<Weight> out_weights_{};
+  std::vector<const Edge *> out_edges_{};
+
+  std::vector<Index> in_tails_{};
+  std::vector<Weight> in_weights_{};
+  std::vector<const Edge *> in_edges_{};
+};
+
+}  // namespace graph
+}  // namespace open_semap
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+
 #include "osmium/osm/types.hpp"
 
 namespace open_semap {
@@ -8,5 +11,10 @@ namespace graph {
 using VertexID = osmium::object_id_type;
 using EdgeID   = osmium::object_id_type;
 
+// The dense index of a vertex in its graph, see VertexNumbering.
+using VertexIndex = uint32_t;
+
+constexpr VertexIndex kInvalidVertexIndex = std::numeric_limits<VertexIndex>::max();
+
 }  // namespace graph
 }  // namespace open_semap
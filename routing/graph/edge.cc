@@ -10,7 +10,10 @@ Edge::Edge(const Vertex &from, const Vertex &to) : Edge(from, to, 0.0) {}
 
 // Special constructor to create a shortcut edge.
 Edge::Edge(const Edge &a, const Edge &b)
-    : from_(a.from()), to_(b.to()), length_(a.cost() + b.cost()), car_(&a), cdr_(&b) {}
+    : from_(a.from()),
+      to_(b.to()),
+      weight_(AddWeights(a.cost(), b.cost())),
+      length_(a.length() + b.length()) {}
 
 }  // namespace graph
 }  // namespace open_semap
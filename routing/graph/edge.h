@@ -1,11 +1,13 @@
 #pragma once
 
 #include <functional>
-#include <vector>
 
-#include "osmium/osm/location.hpp"
 #include "osmium/osm/types.hpp"
 
+#include "graph/defs.h"
+#include "graph/geometry_store.h"
+#include "graph/weight.h"
+
 namespace open_semap {
 namespace graph {
 
@@ -17,33 +19,37 @@ class Edge {
 
   Edge(const Vertex &from, const Vertex &to, double length);
 
-  // Special constructor to create a shortcut edge.
+  // Special constructor to create a shortcut edge, from the start of a to the
+  // end of b. The edges it is made of are recorded by Shortcuts.
   Edge(const Edge &a, const Edge &b);
 
-  inline double cost() const {
-    // FIXME: for routing, we should store the travel time instead of
-    // travel distance.
-    return length_;
-  }
+  // The travel time, which is what the searches minimize. See graph/weight.h.
+  inline Weight cost() const { return weight_; }
+
+  // In meters.
+  inline double length() const { return length_; }
+
+  // The ID of the way in the routing graph file that this edge comes from. For
+  // graphs produced by SplitRoad, SourceWayId() of it gives the original road.
+  // It is 0 for shortcuts.
+  inline EdgeID id() const { return id_; }
 
   inline const Vertex &from() const { return from_.get(); }
 
   inline const Vertex &to() const { return to_.get(); }
 
-  inline const Edge *car() const { return car_; }
-  inline const Edge *cdr() const { return cdr_; }
+  // The points of the edge are kept in the GeometryStore of the graph, see
+  // RoadGraph::points(). kNoGeometry for shortcuts.
+  inline GeometryIndex geometry() const { return geometry_; }
 
  public:
+  // The fields read by the searches come first.
   std::reference_wrapper<const Vertex> from_;
   std::reference_wrapper<const Vertex> to_;
-  // Store the intermediate points for visualization uses. They do not
-  // participate in the routing algorithm.
-  std::vector<osmium::Location> points_{};
-  double length_ = 0.0;
-  // points, it stores a pair of edges that makes this shortcut. Use
-  // car and con as a convention from Lisp.
-  const Edge *car_ = nullptr;
-  const Edge *cdr_ = nullptr;
+  Weight weight_          = 0;
+  GeometryIndex geometry_ = kNoGeometry;
+  double length_          = 0.0;
+  EdgeID id_              = 0;
 };
 
 }  // namespace graph
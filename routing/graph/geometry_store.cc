@@ -0,0 +1,41 @@
+#include "graph/geometry_store.h"
+
+namespace open_semap {
+namespace graph {
+
+GeometryIndex GeometryStore::Add(PointSpan points) {
+  points_.insert(points_.end(), points.begin(), points.end());
+  offsets_.emplace_back(points_.size());
+  return static_cast<GeometryIndex>(size() - 1);
+}
+
+PointSpan GeometryStore::Get(GeometryIndex index) const {
+  if (index == kNoGeometry || index >= size()) {
+    return PointSpan();
+  }
+  const osmium::Location *base = points_.data();
+  return PointSpan(base + offsets_[index], base + offsets_[index + 1]);
+}
+
+void GeometryStore::Release(GeometryIndex index) {
+  if (index == kNoGeometry || index >= size()) {
+    return;
+  }
+  ++num_released_;
+  num_released_points_ += offsets_[index + 1] - offsets_[index];
+}
+
+void GeometryStore::Reserve(size_t num_geometries, size_t num_points) {
+  offsets_.reserve(num_geometries + 1);
+  points_.reserve(num_points);
+}
+
+void GeometryStore::Clear() {
+  points_.clear();
+  offsets_.assign(1, 0);
+  num_released_        = 0;
+  num_released_points_ = 0;
+}
+
+}  // namespace graph
+}  // namespace open_semap
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "osmium/osm/location.hpp"
+
+namespace open_semap {
+namespace graph {
+
+using GeometryIndex = uint32_t;
+
+constexpr GeometryIndex kNoGeometry = std::numeric_limits<GeometryIndex>::max();
+
+// A read-only view of the points of one edge, valid until the store changes.
+class PointSpan {
+ public:
+  PointSpan() = default;
+
+  PointSpan(const osmium::Location *begin, const osmium::Location *end)
+      : begin_(begin), end_(end) {}
+
+  inline const osmium::Location *begin() const { return begin_; }
+  inline const osmium::Location *end() const { return end_; }
+
+  inline size_t size() const { return end_ - begin_; }
+  inline bool empty() const { return begin_ == end_; }
+
+  inline const osmium::Location &operator[](size_t i) const { return begin_[i]; }
+
+  inline std::vector<osmium::Location> ToVector() const {
+    return std::vector<osmium::Location>(begin_, end_);
+  }
+
+ private:
+  const osmium::Location *begin_ = nullptr;
+  const osmium::Location *end_   = nullptr;
+};
+
+// Keeps the points (geometry) of all the edges of a graph in one contiguous
+// array, with an offset per edge.
+//
+// The points are only read to unpack or draw a path, so they are kept out of
+// Edge, which then only holds what the searches read. Each Add() appends a new
+// range. The range of a replaced or removed edge stays in place once
+// Release()d, so that the other indices stay valid. The owner rebuilds the
+// store once too much of it is released, see RoadGraph.
+class GeometryStore {
+ public:
+  GeometryStore() = default;
+
+  GeometryStore(GeometryStore &&) noexcept = default;
+  GeometryStore &operator=(GeometryStore &&) noexcept = default;
+
+  // The number of geometries added.
+  inline size_t size() const { return offsets_.size() - 1; }
+
+  inline size_t num_points() const { return points_.size(); }
+
+  // The geometries released, and their points, which are still counted in
+  // size() and num_points().
+  inline size_t num_released() const { return num_released_; }
+  inline size_t num_released_points() const { return num_released_points_; }
+
+  GeometryIndex Add(PointSpan points);
+
+  // Returns an empty span for kNoGeometry.
+  PointSpan Get(GeometryIndex index) const;
+
+  // Marks the geometry as no longer used. Each geometry must be released at
+  // most once. Does nothing for kNoGeometry.
+  void Release(GeometryIndex index);
+
+  void Reserve(size_t num_geometries, size_t num_points);
+
+  void Clear();
+
+ private:
+  std::vector<osmium::Location> points_{};
+  // The geometry i is points_[offsets_[i], offsets_[i + 1]).
+  std::vector<uint64_t> offsets_{0};
+  size_t num_released_        = 0;
+  size_t num_released_points_ = 0;
+};
+
+}  // namespace graph
+}  // namespace open_semap
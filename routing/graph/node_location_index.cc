@@ -0,0 +1,55 @@
+#include "graph/node_location_index.h"
+
+#include "osmium/index/map/dense_file_array.hpp"
+#include "osmium/index/map/sparse_file_array.hpp"
+#include "osmium/index/map/sparse_mem_array.hpp"
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+namespace graph {
+
+NodeLocationIndexType ChooseNodeLocationIndex(uint64_t input_size) {
+  if (input_size <= kSortedArrayMaxInputSize) {
+    return NodeLocationIndexType::kSortedArray;
+  }
+  if (input_size <= kSparseFileMaxInputSize) {
+    return NodeLocationIndexType::kSparseFile;
+  }
+  return NodeLocationIndexType::kDenseFile;
+}
+
+std::unique_ptr<NodeLocationIndex> CreateNodeLocationIndex(NodeLocationIndexType type) {
+  switch (type) {
+    case NodeLocationIndexType::kSortedArray:
+      return std::make_unique<osmium::index::map::SparseMemArray<
+          osmium::unsigned_object_id_type, osmium::Location>>();
+    case NodeLocationIndexType::kSparseFile:
+      return std::make_unique<osmium::index::map::SparseFileArray<
+          osmium::unsigned_object_id_type, osmium::Location>>();
+    case NodeLocationIndexType::kDenseFile:
+      return std::make_unique<osmium::index::map::DenseFileArray<
+          osmium::unsigned_object_id_type, osmium::Location>>();
+    case NodeLocationIndexType::kAuto:
+      break;
+  }
+  spdlog::critical("Cannot create a node location index of type {}.",
+                   NodeLocationIndexName(type));
+  return nullptr;
+}
+
+const char *NodeLocationIndexName(NodeLocationIndexType type) {
+  switch (type) {
+    case NodeLocationIndexType::kAuto:
+      return "auto";
+    case NodeLocationIndexType::kSortedArray:
+      return "sorted_array";
+    case NodeLocationIndexType::kSparseFile:
+      return "sparse_file";
+    case NodeLocationIndexType::kDenseFile:
+      return "dense_file";
+  }
+  return "unknown";
+}
+
+}  // namespace graph
+}  // namespace open_semap
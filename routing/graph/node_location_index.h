@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "osmium/index/map.hpp"
+#include "osmium/osm/location.hpp"
+#include "osmium/osm/types.hpp"
+
+namespace open_semap {
+namespace graph {
+
+// Where RoadGraph::LoadFromFile() keeps the locations of the intermediate
+// points of the roads until the ways are loaded. All of them are libosmium
+// location indices, and are safe to be read by multiple threads once sorted.
+enum class NodeLocationIndexType {
+  // Picked by ChooseNodeLocationIndex() from the size of the input.
+  kAuto,
+  // A sorted flat array of (ID, location) in memory. 16 bytes per point.
+  kSortedArray,
+  // The same sorted array, but in a memory-mapped temporary file, so that the
+  // kernel can page it out.
+  kSparseFile,
+  // A memory-mapped temporary file indexed by the node ID. 8 bytes for every
+  // ID up to the largest one, which only pays off when most of the IDs are
+  // used, i.e. at planet scale.
+  kDenseFile,
+};
+
+using NodeLocationIndex =
+    osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
+
+// Inputs up to this size keep the points in memory.
+constexpr uint64_t kSortedArrayMaxInputSize = uint64_t{1} << 30;
+
+// Inputs up to this size use the sparse file, the larger ones the dense file.
+constexpr uint64_t kSparseFileMaxInputSize = uint64_t{16} << 30;
+
+NodeLocationIndexType ChooseNodeLocationIndex(uint64_t input_size);
+
+// kAuto is not accepted.
+std::unique_ptr<NodeLocationIndex> CreateNodeLocationIndex(NodeLocationIndexType type);
+
+const char *NodeLocationIndexName(NodeLocationIndexType type);
+
+}  // namespace graph
+}  // namespace open_semap
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace open_semap {
+namespace graph {
+
+// A slab allocator for the graph objects (vertices, edges and shortcuts).
+//
+// Objects are constructed in place in slabs of kSlabSize objects, so creating
+// one costs no heap allocation most of the time, and the objects of a graph sit
+// next to each other in memory. An object never moves until it is destroyed,
+// and the arena can be moved without moving the objects, so the references
+// held by the indexers stay valid.
+//
+// The slot of a destroyed object is reused by the next Create(). Destroying
+// the arena destroys all the objects still alive.
+template <typename T, size_t kSlabSize = 4096>
+class ObjectArena {
+ public:
+  ObjectArena() = default;
+
+  ~ObjectArena() { Clear(); }
+
+  ObjectArena(ObjectArena &&other) noexcept
+      : slabs_(std::move(other.slabs_)), free_(std::move(other.free_)) {
+    other.slabs_.clear();
+    other.free_.clear();
+  }
+
+  ObjectArena &operator=(ObjectArena &&other) noexcept {
+    if (this != &other) {
+      Clear();
+      slabs_ = std::move(other.slabs_);
+      free_  = std::move(other.free_);
+      other.slabs_.clear();
+      other.free_.clear();
+    }
+    return *this;
+  }
+
+  ObjectArena(const ObjectArena &) = delete;
+  ObjectArena &operator=(const ObjectArena &) = delete;
+
+  template <typename... Args>
+  T *Create(Args &&... args) {
+    void *slot = nullptr;
+    if (!free_.empty()) {
+      slot = free_.back();
+      free_.pop_back();
+    } else {
+      if (slabs_.empty() || slabs_.back().used == kSlabSize) {
+        slabs_.emplace_back(Slab{std::make_unique<Storage[]>(kSlabSize), 0});
+      }
+      slot = &slabs_.back().data[slabs_.back().used++];
+    }
+    return new (slot) T(std::forward<Args>(args)...);
+  }
+
+  // The object must be created by this arena.
+  void Destroy(T *object) {
+    object->~T();
+    free_.emplace_back(object);
+  }
+
+  // Takes over all the objects of the other arena. They stay where they are.
+  void Append(ObjectArena &&other) {
+    // Keep the own last slab at the back, as it is the one that Create() fills
+    // next. The free space left in the slabs of the other is not used.
+    if (slabs_.empty()) {
+      slabs_ = std::move(other.slabs_);
+    } else {
+      Slab last = std::move(slabs_.back());
+      slabs_.pop_back();
+      for (Slab &slab : other.slabs_) {
+        slabs_.emplace_back(std::move(slab));
+      }
+      slabs_.emplace_back(std::move(last));
+    }
+    free_.insert(free_.end(), other.free_.begin(), other.free_.end());
+    other.slabs_.clear();
+    other.free_.clear();
+  }
+
+  // The number of objects alive.
+  size_t size() const {
+    size_t total = 0;
+    for (const Slab &slab : slabs_) {
+      total += slab.used;
+    }
+    return total - free_.size();
+  }
+
+  // The memory held by the slabs, in bytes.
+  size_t capacity_bytes() const { return slabs_.size() * kSlabSize * sizeof(T); }
+
+  void Clear() {
+    if (!std::is_trivially_destructible<T>::value) {
+      std::sort(free_.begin(), free_.end(), std::less<T *>());
+      for (Slab &slab : slabs_) {
+        for (size_t i = 0; i < slab.used; ++i) {
+          T *object = reinterpret_cast<T *>(&slab.data[i]);
+          if (!std::binary_search(free_.begin(), free_.end(), object, std::less<T *>())) {
+            object->~T();
+          }
+        }
+      }
+    }
+    slabs_.clear();
+    free_.clear();
+  }
+
+ private:
+  using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  struct Slab {
+    std::unique_ptr<Storage[]> data;
+    // The number of slots handed out, including the destroyed ones.
+    size_t used;
+  };
+
+  std::vector<Slab> slabs_{};
+  std::vector<T *> free_{};
+};
+
+}  // namespace graph
+}  // namespace open_semap
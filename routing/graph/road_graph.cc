@@ -1,6 +1,11 @@
 #include "graph/road_graph.h"
 
-#include <unordered_map>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
 
 #include "osmium/geom/haversine.hpp"
 #include "osmium/handler.hpp"
@@ -14,14 +19,17 @@
 #include "osmium/visitor.hpp"
 #include "spdlog/spdlog.h"
 
+#include "utils/ordered_task_queue.h"
+
 namespace open_semap {
 namespace graph {
 
-using VertexMap = std::unordered_map<VertexID, std::reference_wrapper<const Vertex>>;
-
+// Adds the vertices to the graph, and records the locations of the other
+// nodes (the intermediate points) into the index, unless it is nullptr.
 class NodeLoaderHandler : public osmium::handler::Handler {
  public:
-  NodeLoaderHandler() = default;
+  NodeLoaderHandler(RoadGraph *graph, NodeLocationIndex *points)
+      : graph_(graph), points_(points) {}
 
   void node(const osmium::Node &node) {
     // Take a look at the "vertex" tag of the node and decide where to
@@ -30,146 +38,394 @@ class NodeLoaderHandler : public osmium::handler::Handler {
     bool is_vertex = !(vertex_tag == nullptr || std::strcmp(vertex_tag, "no") == 0);
 
     if (is_vertex) {
-      vertices_.emplace_back(std::make_unique<Vertex>(node.id(), node.location()));
-    } else {
-      node_map_.emplace(node.id(), node.location());
+      graph_->AddVertex(node.id(), node.location());
+    } else if (points_ != nullptr) {
+      points_->set(static_cast<osmium::unsigned_object_id_type>(node.id()),
+                   node.location());
     }
   }
 
-  inline std::vector<std::unique_ptr<Vertex>> ReleaseVertices() {
-    return std::move(vertices_);
-  }
-
-  inline std::unordered_map<osmium::object_id_type, osmium::Location> ReleaseNodeMap() {
-    return std::move(node_map_);
-  }
-
  private:
-  std::vector<std::unique_ptr<Vertex>> vertices_;
-  std::unordered_map<osmium::object_id_type, osmium::Location> node_map_;
+  RoadGraph *graph_;
+  NodeLocationIndex *points_;
 };
 
-VertexMap GenerateIdToVertexMap(const std::vector<std::unique_ptr<Vertex>> &vertices) {
-  VertexMap result;
-  for (const std::unique_ptr<Vertex> &vertex : vertices) {
-    result.emplace(vertex->id(), *vertex);
-  }
-  return result;
-}
-
 struct EdgeInfo {
   EdgeInfo(osmium::object_id_type id_) : id(id_) {}
 
   osmium::object_id_type id;
   std::vector<osmium::object_id_type> point_ids{};
+  // The length written by SplitRoad. Negative if it is not available.
+  double length = -1.0;
+  // In km/h, from the profile.
+  double speed = 0.0;
 };
 
 class WayLoaderHandler : public osmium::handler::Handler {
  public:
-  WayLoaderHandler() = default;
+  WayLoaderHandler(bool ends_only, const RoutingProfile &profile)
+      : ends_only_(ends_only), profile_(profile) {}
 
   void way(const osmium::Way &way) {
     edges_.emplace_back(way.id());
-    for (const auto &node : way.nodes()) {
-      edges_.back().point_ids.emplace_back(node.ref());
+    if (ends_only_ && way.nodes().size() >= 2) {
+      edges_.back().point_ids.emplace_back(way.nodes().front().ref());
+      edges_.back().point_ids.emplace_back(way.nodes().back().ref());
+    } else {
+      for (const auto &node : way.nodes()) {
+        edges_.back().point_ids.emplace_back(node.ref());
+      }
+    }
+    const char *length = way.tags()["length"];
+    if (length != nullptr) {
+      edges_.back().length = std::strtod(length, nullptr);
     }
+    edges_.back().speed = profile_.Speed(way.tags());
   }
 
-  void Reset() { edges_.clear(); }
-
   const std::vector<EdgeInfo> &Edges() const { return edges_; }
 
  private:
+  bool ends_only_;
+  const RoutingProfile &profile_;
   std::vector<EdgeInfo> edges_{};
 };
 
-const Vertex &QueryVertex(
-    VertexID id, const std::unordered_map<VertexID, std::reference_wrapper<const Vertex>>
-                     &id_to_vertex) {
-  static Vertex INVALID_VERTEX(-1, osmium::Location(0.0, 0.0));
-  auto iter = id_to_vertex.find(id);
-  if (iter != id_to_vertex.end()) {
-    return iter->second.get();
+// The edges of one buffer of ways, with their ends, points, lengths and
+// travel times resolved. The points of all the edges are kept in one array.
+struct DecodedEdges {
+  struct Record {
+    EdgeID id;
+    const Vertex *from;
+    const Vertex *to;
+    double length;
+    Weight weight;
+    size_t points_begin;
+    size_t points_end;
+  };
+
+  std::vector<Record> records{};
+  std::vector<osmium::Location> points{};
+  size_t num_missing_lengths = 0;
+};
+
+// Runs on the worker threads. The graph is only read through FindVertex(),
+// which is safe as the vertices are all added before the ways are loaded, and
+// adding edges does not touch them. The points are sorted before as well.
+DecodedEdges DecodeEdges(const osmium::memory::Buffer &buffer, const RoadGraph &graph,
+                         const NodeLocationIndex *points, bool topology_only,
+                         const RoutingProfile &profile) {
+  WayLoaderHandler handler(topology_only, profile);
+  osmium::apply(buffer, handler);
+
+  DecodedEdges decoded;
+  decoded.records.reserve(handler.Edges().size());
+  for (const auto &edge_info : handler.Edges()) {
+    if (edge_info.point_ids.size() < 2) {
+      spdlog::warn("Skipping as edge {} has {} points, which is less than 2.",
+                   edge_info.id, edge_info.point_ids.size());
+      continue;
+    }
+    const Vertex *from = graph.FindVertex(edge_info.point_ids.front());
+    const Vertex *to   = graph.FindVertex(edge_info.point_ids.back());
+    if (from == nullptr || to == nullptr) {
+      spdlog::critical("Skipping edge {} as vertex {} or {} cannot be found.",
+                       edge_info.id, edge_info.point_ids.front(),
+                       edge_info.point_ids.back());
+      continue;
+    }
+
+    DecodedEdges::Record record{edge_info.id, from, to, 0.0, 0, decoded.points.size(), 0};
+    decoded.points.emplace_back(from->loc());
+
+    if (topology_only) {
+      decoded.points.emplace_back(to->loc());
+      if (edge_info.length >= 0.0) {
+        record.length = edge_info.length;
+      } else {
+        // Without the intermediate points, the straight line distance is the
+        // best estimation.
+        ++decoded.num_missing_lengths;
+        record.length = osmium::geom::haversine::distance(from->loc(), to->loc());
+      }
+    } else {
+      osmium::Location prev_loc = from->loc();
+      for (size_t i = 1; i + 1 < edge_info.point_ids.size(); ++i) {
+        osmium::Location location = points->get_noexcept(
+            static_cast<osmium::unsigned_object_id_type>(edge_info.point_ids[i]));
+        if (!location.valid()) {
+          spdlog::critical("Cannot find point with node id = {}", edge_info.point_ids[i]);
+          continue;
+        }
+        decoded.points.emplace_back(location);
+        record.length += osmium::geom::haversine::distance(prev_loc, location);
+        prev_loc = location;
+      }
+      decoded.points.emplace_back(to->loc());
+      record.length += osmium::geom::haversine::distance(prev_loc, to->loc());
+      // Prefer the length written by SplitRoad so that both modes agree.
+      if (edge_info.length >= 0.0) {
+        record.length = edge_info.length;
+      }
+    }
+
+    record.weight     = TravelTime(record.length, edge_info.speed);
+    record.points_end = decoded.points.size();
+    decoded.records.emplace_back(record);
   }
-  return INVALID_VERTEX;
+  return decoded;
 }
 
-RoadGraph RoadGraph::LoadFromFile(const std::string &path) {
-  spdlog::info("Loading the road graph.");
+RoadGraph RoadGraph::LoadFromFile(const std::string &path, const LoadOptions &options) {
+  spdlog::info("Loading the road graph{}.",
+               options.topology_only ? " (topology only)" : "");
 
   RoadGraph graph;
-  std::unordered_map<osmium::object_id_type, osmium::Location> node_map;
-  VertexMap vertex_map;
+  const RoutingProfile &profile =
+      options.profile != nullptr ? *options.profile : ActiveProfile();
+
+  // The intermediate points are not needed when only the topology is loaded.
+  std::unique_ptr<NodeLocationIndex> points;
+  if (!options.topology_only) {
+    NodeLocationIndexType type = options.location_index;
+    if (type == NodeLocationIndexType::kAuto) {
+      struct stat input_stat;
+      type = ChooseNodeLocationIndex(
+          ::stat(path.c_str(), &input_stat) == 0 ? input_stat.st_size : 0);
+    }
+    spdlog::info("Recording the intermediate points with the {} index.",
+                 NodeLocationIndexName(type));
+    points = CreateNodeLocationIndex(type);
+  }
 
   // Load nodes (vertices + imtermediate points)
   {
     osmium::io::File input_file(path);
     osmium::io::ReaderWithProgressBar reader(true, input_file,
                                              osmium::osm_entity_bits::node);
-    NodeLoaderHandler handler;
+    NodeLoaderHandler handler(&graph, points.get());
     osmium::apply(reader, handler);
-    graph.vertices_ = handler.ReleaseVertices();
-    vertex_map      = GenerateIdToVertexMap(graph.vertices_);
-    node_map        = handler.ReleaseNodeMap();
     reader.close();
   }
+  if (points != nullptr) {
+    points->sort();
+    spdlog::info("Recorded {} intermediate points ({} MB).", points->size(),
+                 points->used_memory() >> 20);
+  }
 
-  // Load ways (edges)
+  // Load ways (edges). The buffers are decoded on the workers, and the edges are
+  // added in the order of the buffers, so the graph does not depend on the
+  // number of threads.
   {
     osmium::io::File input_file(path);
     osmium::io::ReaderWithProgressBar reader(true, input_file,
                                              osmium::osm_entity_bits::way);
-    WayLoaderHandler handler;
+    size_t num_missing_lengths = 0;
+    OrderedTaskQueue<DecodedEdges> queue(
+        options.num_threads, [&graph, &num_missing_lengths](DecodedEdges &&decoded) {
+          const osmium::Location *points = decoded.points.data();
+          for (const DecodedEdges::Record &record : decoded.records) {
+            Edge &edge = graph.AddEdge(*record.from, *record.to, record.length);
+            edge.id_     = record.id;
+            edge.weight_ = record.weight;
+            graph.SetPoints(edge, PointSpan(points + record.points_begin,
+                                            points + record.points_end));
+          }
+          num_missing_lengths += decoded.num_missing_lengths;
+        });
 
     while (osmium::memory::Buffer buffer = reader.read()) {
-      handler.Reset();
-      osmium::apply(buffer, handler);
-      for (const auto &edge_info : handler.Edges()) {
-        if (edge_info.point_ids.size() < 2) {
-          spdlog::warn("Skipping as edge {} has {} points, which is less than 2.",
-                       edge_info.id, edge_info.point_ids.size());
-          continue;
-        }
-        // Construct edges and fill edge information in vertices. This
-        // exploits the friendship between RoadGraph and Edge/Vertex.
-        const Vertex &from = QueryVertex(edge_info.point_ids.front(), vertex_map);
-        const Vertex &to   = QueryVertex(edge_info.point_ids.back(), vertex_map);
-        if (from.id() == -1 || to.id() == -1) {
-          spdlog::critical("Cannot find vertex {} or {}.", edge_info.point_ids.front(),
-                           edge_info.point_ids.back());
-        }
-        graph.edges_.emplace_back(std::make_unique<Edge>(from, to));
-        graph.edges_.back()->points_.emplace_back(from.loc());
-
-        osmium::Location prev_loc = from.loc();
-        for (size_t i = 1; i + 1 < edge_info.point_ids.size(); ++i) {
-          auto iter = node_map.find(edge_info.point_ids[i]);
-          if (iter == node_map.end()) {
-            spdlog::critical("Cannot find point with node id = {}",
-                             edge_info.point_ids[i]);
-          }
-          graph.edges_.back()->points_.emplace_back(iter->second);
-          graph.edges_.back()->length_ +=
-              osmium::geom::haversine::distance(prev_loc, iter->second);
-          prev_loc = iter->second;
-        }
-        graph.edges_.back()->points_.emplace_back(to.loc());
-        graph.edges_.back()->length_ +=
-            osmium::geom::haversine::distance(prev_loc, to.loc());
-      }
+      queue.Submit([&graph, &points, &options, &profile, buffer = std::move(buffer)]() {
+        return DecodeEdges(buffer, graph, points.get(), options.topology_only, profile);
+      });
+    }
+    queue.Drain();
+
+    if (num_missing_lengths > 0) {
+      spdlog::warn(
+          "{} edges do not have the length tag, used the straight line distance "
+          "instead.",
+          num_missing_lengths);
     }
 
     reader.close();
   }
 
+  if (options.vertex_order != VertexOrder::kInput) {
+    graph.Reorder(options.vertex_order);
+  }
+
   return graph;
 }
 
-const std::vector<std::unique_ptr<Vertex>> &RoadGraph::vertices() const {
-  return vertices_;
+const std::vector<Vertex *> &RoadGraph::vertices() const { return vertices_; }
+
+const std::vector<Edge *> &RoadGraph::edges() const { return edges_; }
+
+void RoadGraph::EnsureEdgePositions() {
+  if (has_edge_positions_) {
+    return;
+  }
+  edge_positions_.reserve(edges_.size());
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    edge_positions_.emplace(edges_[i], i);
+  }
+  has_edge_positions_ = true;
+}
+
+const Vertex *RoadGraph::FindVertex(VertexID id) const {
+  VertexIndex index = numbering_->Find(id);
+  if (index == kInvalidVertexIndex) {
+    return nullptr;
+  }
+  return vertices_[index];
+}
+
+void RoadGraph::Reserve(size_t num_vertices, size_t num_edges, size_t num_points) {
+  vertices_.reserve(num_vertices);
+  numbering_->Reserve(num_vertices);
+  edges_.reserve(num_edges);
+  geometry_.Reserve(num_edges, num_points);
+}
+
+const Vertex &RoadGraph::AddVertex(VertexID id, osmium::Location location) {
+  VertexIndex index = numbering_->Find(id);
+  if (index != kInvalidVertexIndex) {
+    spdlog::warn("Vertex {} is already in the graph.", id);
+    return *vertices_[index];
+  }
+  vertices_.emplace_back(vertex_arena_.Create(id, location));
+  vertices_.back()->index_ = numbering_->Add(id);
+  return *vertices_.back();
 }
 
-const std::vector<std::unique_ptr<Edge>> &RoadGraph::edges() const { return edges_; }
+Edge &RoadGraph::AddEdge(const Vertex &from, const Vertex &to, double length) {
+  edges_.emplace_back(edge_arena_.Create(from, to, length));
+  if (has_edge_positions_) {
+    edge_positions_.emplace(edges_.back(), edges_.size() - 1);
+  }
+  return *edges_.back();
+}
+
+void RoadGraph::SetPoints(Edge &edge, PointSpan points) {
+  geometry_.Release(edge.geometry_);
+  edge.geometry_ = geometry_.Add(points);
+  CompactGeometry();
+}
+
+void RoadGraph::RemoveVertex(VertexID id) {
+  VertexIndex index = numbering_->Find(id);
+  if (index == kInvalidVertexIndex) {
+    return;
+  }
+  // Swap with the last one and pop, which keeps the removal O(1) and the
+  // indices dense.
+  numbering_->Remove(id);
+  if (index + 1 < vertices_.size()) {
+    std::swap(vertices_[index], vertices_.back());
+    vertices_[index]->index_ = index;
+  }
+  vertex_arena_.Destroy(vertices_.back());
+  vertices_.pop_back();
+}
+
+void RoadGraph::RemoveEdge(const Edge &edge) {
+  EnsureEdgePositions();
+  auto iter = edge_positions_.find(&edge);
+  if (iter == edge_positions_.end()) {
+    return;
+  }
+  geometry_.Release(edge.geometry());
+  size_t position = iter->second;
+  edge_positions_.erase(iter);
+  if (position + 1 < edges_.size()) {
+    std::swap(edges_[position], edges_.back());
+    edge_positions_[edges_[position]] = position;
+  }
+  edge_arena_.Destroy(edges_.back());
+  edges_.pop_back();
+  CompactGeometry();
+}
+
+void RoadGraph::CompactGeometry() {
+  if (geometry_.num_released() * 2 <= geometry_.size() &&
+      geometry_.num_released_points() * 2 <= geometry_.num_points()) {
+    return;
+  }
+  GeometryStore geometry;
+  geometry.Reserve(geometry_.size() - geometry_.num_released(),
+                   geometry_.num_points() - geometry_.num_released_points());
+  for (Edge *edge : edges_) {
+    if (edge->geometry_ != kNoGeometry) {
+      edge->geometry_ = geometry.Add(geometry_.Get(edge->geometry_));
+    }
+  }
+  geometry_ = std::move(geometry);
+}
+
+void RoadGraph::Reorder(VertexOrder order) {
+  if (order == VertexOrder::kInput) {
+    return;
+  }
+
+  std::vector<uint64_t> keys;
+  keys.reserve(vertices_.size());
+  for (const Vertex *vertex : vertices_) {
+    keys.emplace_back(order == VertexOrder::kHilbert ? HilbertKey(vertex->loc())
+                                                     : MortonKey(vertex->loc()));
+  }
+  std::vector<VertexIndex> sorted(vertices_.size());
+  std::iota(sorted.begin(), sorted.end(), 0);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [&keys](VertexIndex a, VertexIndex b) { return keys[a] < keys[b]; });
+
+  ObjectArena<Vertex> vertex_arena;
+  std::vector<Vertex *> vertices;
+  vertices.reserve(vertices_.size());
+  // The new vertex of each old index.
+  std::vector<const Vertex *> moved(vertices_.size());
+  VertexNumbering numbering;
+  numbering.Reserve(vertices_.size());
+  for (VertexIndex old_index : sorted) {
+    const Vertex &vertex = *vertices_[old_index];
+    vertices.emplace_back(vertex_arena.Create(vertex.id(), vertex.loc()));
+    vertices.back()->index_ = numbering.Add(vertex.id());
+    moved[old_index]        = vertices.back();
+  }
+
+  std::vector<const Edge *> old_edges(edges_.begin(), edges_.end());
+  std::stable_sort(old_edges.begin(), old_edges.end(),
+                   [&moved](const Edge *a, const Edge *b) {
+                     VertexIndex a_from = moved[a->from().index()]->index();
+                     VertexIndex b_from = moved[b->from().index()]->index();
+                     if (a_from != b_from) {
+                       return a_from < b_from;
+                     }
+                     return moved[a->to().index()]->index() <
+                            moved[b->to().index()]->index();
+                   });
+
+  ObjectArena<Edge> edge_arena;
+  std::vector<Edge *> edges;
+  edges.reserve(edges_.size());
+  for (const Edge *edge : old_edges) {
+    edges.emplace_back(edge_arena.Create(*moved[edge->from().index()],
+                                         *moved[edge->to().index()], edge->length_));
+    edges.back()->id_       = edge->id_;
+    edges.back()->weight_   = edge->weight_;
+    edges.back()->geometry_ = edge->geometry_;
+  }
+
+  // The old objects go away with the old arenas.
+  vertex_arena_ = std::move(vertex_arena);
+  edge_arena_   = std::move(edge_arena);
+  vertices_     = std::move(vertices);
+  edges_        = std::move(edges);
+  // Keep the numbering object itself, whose reference stays valid.
+  *numbering_         = std::move(numbering);
+  has_edge_positions_ = false;
+  edge_positions_.clear();
+}
 
 }  // namespace graph
 }  // namespace open_semap
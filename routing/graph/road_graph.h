@@ -2,36 +2,140 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "osmium/osm/types.hpp"
 
 #include "graph/defs.h"
 #include "graph/edge.h"
+#include "graph/geometry_store.h"
+#include "graph/node_location_index.h"
+#include "graph/object_arena.h"
+#include "graph/space_filling_curve.h"
 #include "graph/vertex.h"
+#include "graph/vertex_numbering.h"
+#include "utils/routing_profile.h"
 
 namespace open_semap {
 namespace graph {
 
+struct LoadOptions {
+  // Only load the vertices and the edges, using the lengths written by
+  // SplitRoad as the "length" tag. Intermediate points are skipped completely,
+  // so the edges only carry the locations of their two ends.
+  bool topology_only = false;
+
+  // The number of threads that decode the ways. The loaded graph is the same
+  // for any number of threads.
+  int num_threads = 1;
+
+  // Where to keep the intermediate points while loading. kAuto picks one from
+  // the size of the file, so that big regions load with modest RAM.
+  NodeLocationIndexType location_index = NodeLocationIndexType::kAuto;
+
+  // Reorders the loaded graph, see RoadGraph::Reorder().
+  VertexOrder vertex_order = VertexOrder::kInput;
+
+  // Gives the speeds from which the travel times of the edges are computed.
+  // nullptr means ActiveProfile().
+  const RoutingProfile *profile = nullptr;
+};
+
+// The vertices and edges are allocated from arenas owned by the graph, so
+// that loading tens of millions of them costs few heap allocations. They never
+// move, even when the graph is moved. The points of the edges are kept apart
+// in a GeometryStore, so that the edges stay small.
 class RoadGraph {
  public:
-  static RoadGraph LoadFromFile(const std::string &path);
+  static RoadGraph LoadFromFile(const std::string &path,
+                                const LoadOptions &options = LoadOptions());
 
-  RoadGraph(std::vector<std::unique_ptr<Vertex>> &&vertices,
-            std::vector<std::unique_ptr<Edge>> &&edges)
-      : vertices_(std::move(vertices)), edges_(std::move(edges)) {}
+  // Creates an empty graph, to be filled by AddVertex() and AddEdge().
+  RoadGraph() = default;
 
   RoadGraph(RoadGraph &&) noexcept = default;
   RoadGraph &operator=(RoadGraph &&) noexcept = default;
 
-  const std::vector<std::unique_ptr<Vertex>> &vertices() const;
-  const std::vector<std::unique_ptr<Edge>> &edges() const;
+  const std::vector<Vertex *> &vertices() const;
+  const std::vector<Edge *> &edges() const;
+
+  // Maps the vertex IDs to Vertex::index() and back. The reference stays valid
+  // when the graph is moved.
+  inline const VertexNumbering &numbering() const { return *numbering_; }
+
+  // Returns nullptr if the graph does not have a vertex with the ID.
+  const Vertex *FindVertex(VertexID id) const;
+
+  // The points of the edge, including its two ends. Empty for edges without
+  // geometry, e.g. the ones added by RoadGraphBuilder.
+  inline PointSpan points(const Edge &edge) const {
+    return geometry_.Get(edge.geometry());
+  }
+
+  inline const GeometryStore &geometry() const { return geometry_; }
+
+  // ==================== Mutable APIs ====================
+  //
+  // Used to build the graph, and to patch it in place (see
+  // utils/incremental_update.h). Adding or removing an element never moves the
+  // other vertices and edges, so the references held by the indexers stay
+  // valid. The order of vertices() and edges() is not preserved though, and
+  // removing a vertex gives its index to the last vertex.
+
+  // Makes room for that many vertices, edges and points of the edges, so that
+  // filling a graph of a known size does not grow the indices as it goes.
+  void Reserve(size_t num_vertices, size_t num_edges, size_t num_points);
+
+  // Returns the existing vertex if the graph already has one with the ID.
+  const Vertex &AddVertex(VertexID id, osmium::Location location);
+
+  // Both ends must be vertices of this graph. The returned edge can be used to
+  // fill in the ID, and passed to SetPoints().
+  Edge &AddEdge(const Vertex &from, const Vertex &to, double length = 0.0);
+
+  // Replaces the points of an edge of this graph. The old points are
+  // reclaimed, see CompactGeometry().
+  void SetPoints(Edge &edge, PointSpan points);
+
+  inline void SetPoints(Edge &edge, const std::vector<osmium::Location> &points) {
+    SetPoints(edge, PointSpan(points.data(), points.data() + points.size()));
+  }
+
+  // The edges connecting the vertex must be removed before the vertex.
+  void RemoveVertex(VertexID id);
+
+  void RemoveEdge(const Edge &edge);
+
+  // Sorts the vertices along the curve, and the edges by their from and to
+  // vertices, so that the searches read nearby memory when they relax the
+  // edges of nearby vertices. The vertices and edges are moved to new arenas
+  // in that order, which invalidates all the references to them, so reorder
+  // before building any indexer. The IDs and the points are kept.
+  void Reorder(VertexOrder order);
 
  private:
-  RoadGraph() = default;
+  // Builds the edge position map below on the first removal, so that graphs
+  // which are never patched do not pay for it. The position of a vertex is its
+  // index.
+  void EnsureEdgePositions();
+
+  // Copies the points of the edges to a new store, in the order of the edges,
+  // once more than half of the geometries or of the points are released. So
+  // patching the graph over and over keeps the store within twice its live
+  // size, at an amortized O(1) per released point. Invalidates the PointSpans.
+  void CompactGeometry();
+
+  ObjectArena<Vertex> vertex_arena_{};
+  ObjectArena<Edge> edge_arena_{};
+  GeometryStore geometry_{};
+
+  std::vector<Vertex *> vertices_{};
+  std::vector<Edge *> edges_{};
+  std::unique_ptr<VertexNumbering> numbering_ = std::make_unique<VertexNumbering>();
 
-  std::vector<std::unique_ptr<Vertex>> vertices_{};
-  std::vector<std::unique_ptr<Edge>> edges_{};
+  bool has_edge_positions_ = false;
+  std::unordered_map<const Edge *, size_t> edge_positions_{};
 };
 
 }  // namespace graph
@@ -100,14 +100,39 @@ void SimpleIndexer::RemoveVertex(VertexID vertex_id) {
   connections_.erase(iter);
 }
 
+bool SimpleIndexer::RemoveEdge(const Edge &edge) {
+  auto is_this_edge = [&edge](const std::reference_wrapper<const Edge> &e) -> bool {
+    return &e.get() == &edge;
+  };
+
+  bool found           = false;
+  ConnectionInfo *from = FindMutable(edge.from().id());
+  if (from != nullptr) {
+    auto iter =
+        std::remove_if(from->outwards.begin(), from->outwards.end(), is_this_edge);
+    found = iter != from->outwards.end();
+    from->outwards.erase(iter, from->outwards.end());
+  }
+
+  ConnectionInfo *to = FindMutable(edge.to().id());
+  if (to != nullptr) {
+    auto iter = std::remove_if(to->inwards.begin(), to->inwards.end(), is_this_edge);
+    found     = found || iter != to->inwards.end();
+    to->inwards.erase(iter, to->inwards.end());
+  }
+
+  return found;
+}
+
 SimpleIndexer SimpleIndexer::CreateFromRawGraph(const RoadGraph &graph) {
   SimpleIndexer indexer;
+  indexer.numbering_ = &graph.numbering();
 
-  for (const std::unique_ptr<Vertex> &vertex : graph.vertices()) {
+  for (const Vertex *vertex : graph.vertices()) {
     indexer.AddVertex(*vertex);
   }
 
-  for (const std::unique_ptr<Edge> &edge : graph.edges()) {
+  for (const Edge *edge : graph.edges()) {
     if (!indexer.AddEdge(*edge)) {
       spdlog::info("SimpleIndexer cannot AddEdge ({} -> {}).", edge->from().id(),
                    edge->to().id());
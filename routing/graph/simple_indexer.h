@@ -8,6 +8,7 @@
 #include "graph/edge.h"
 #include "graph/road_graph.h"
 #include "graph/vertex.h"
+#include "graph/vertex_numbering.h"
 
 namespace open_semap {
 namespace graph {
@@ -40,6 +41,11 @@ class SimpleIndexer {
 
   const Edge *FindEdge(VertexID from, VertexID to) const;
 
+  // The numbering of the graph that the indexer is created from, which the
+  // searches use to keep their per-vertex state in arrays. It is nullptr if the
+  // indexer is not created by CreateFromRawGraph().
+  inline const VertexNumbering *numbering() const { return numbering_; }
+
   // ==================== Mutable APIs ====================
 
   ConnectionInfo *FindMutable(VertexID vertex_id);
@@ -52,8 +58,13 @@ class SimpleIndexer {
 
   void RemoveVertex(VertexID vertex_id);
 
+  // Removes this very edge (compared by address) from the connections of its
+  // two ends. Returns false if it is not in the indexer.
+  bool RemoveEdge(const Edge &edge);
+
  private:
   std::unordered_map<VertexID, std::unique_ptr<ConnectionInfo>> connections_{};
+  const VertexNumbering *numbering_ = nullptr;
 };
 
 }  // namespace graph
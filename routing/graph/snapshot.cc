@@ -0,0 +1,286 @@
+#include "graph/snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+namespace graph {
+
+namespace {
+
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+inline uint64_t AlignUp(uint64_t offset) { return (offset + 7) & ~uint64_t{7}; }
+
+inline SnapshotPoint ToSnapshotPoint(const osmium::Location &location) {
+  return SnapshotPoint{location.x(), location.y()};
+}
+
+void WritePadding(std::ofstream *output, uint64_t from, uint64_t to) {
+  static const char zeros[8] = {0};
+  output->write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+}  // namespace
+
+bool GraphSnapshot::Save(const RoadGraph &graph, const std::string &path) {
+  std::unordered_map<VertexID, uint32_t> vertex_indices;
+  std::vector<SnapshotVertex> vertices;
+  vertices.reserve(graph.vertices().size());
+  for (const Vertex *vertex : graph.vertices()) {
+    vertex_indices.emplace(vertex->id(), static_cast<uint32_t>(vertices.size()));
+    vertices.emplace_back(SnapshotVertex{vertex->id(), ToSnapshotPoint(vertex->loc())});
+  }
+
+  std::vector<SnapshotEdge> edges;
+  std::vector<SnapshotPoint> points;
+  edges.reserve(graph.edges().size());
+  for (const Edge *edge : graph.edges()) {
+    auto from = vertex_indices.find(edge->from().id());
+    auto to   = vertex_indices.find(edge->to().id());
+    if (from == vertex_indices.end() || to == vertex_indices.end()) {
+      spdlog::critical("Edge {} ({} -> {}) refers to a vertex not in the graph.",
+                       edge->id(), edge->from().id(), edge->to().id());
+      return false;
+    }
+    SnapshotEdge record{edge->id(), from->second, to->second, edge->length_,
+                        points.size(), 0, edge->cost(), 0};
+    for (const osmium::Location &point : graph.points(*edge)) {
+      points.emplace_back(ToSnapshotPoint(point));
+    }
+    record.points_end = points.size();
+    edges.emplace_back(record);
+  }
+
+  // The search index: the arcs sorted by their tails, keeping the order of the
+  // edges for each vertex, and the vertices sorted by their IDs.
+  std::vector<uint32_t> out_offsets(vertices.size() + 1, 0);
+  for (const SnapshotEdge &edge : edges) {
+    ++out_offsets[edge.from + 1];
+  }
+  for (size_t v = 0; v < vertices.size(); ++v) {
+    out_offsets[v + 1] += out_offsets[v];
+  }
+  std::vector<SnapshotArc> arcs(edges.size());
+  {
+    std::vector<uint32_t> cursor(out_offsets.begin(), out_offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); ++i) {
+      arcs[cursor[edges[i].from]++] =
+          SnapshotArc{edges[i].to, edges[i].weight, static_cast<uint32_t>(i)};
+    }
+  }
+  std::vector<SnapshotIdEntry> ids;
+  ids.reserve(vertices.size());
+  for (size_t v = 0; v < vertices.size(); ++v) {
+    ids.emplace_back(SnapshotIdEntry{vertices[v].id, static_cast<uint32_t>(v), 0});
+  }
+  std::sort(ids.begin(), ids.end(),
+            [](const SnapshotIdEntry &a, const SnapshotIdEntry &b) {
+              return a.id < b.id;
+            });
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+  header.version      = kSnapshotVersion;
+  header.byte_order   = kByteOrderMark;
+  header.num_vertices = vertices.size();
+  header.num_edges    = edges.size();
+  header.num_points   = points.size();
+
+  // The sections in the order of the layout, each starting at the next
+  // multiple of 8.
+  struct Section {
+    uint64_t *offset;
+    const void *data;
+    uint64_t size;
+  };
+  const Section sections[] = {
+      {&header.vertices_offset, vertices.data(),
+       vertices.size() * sizeof(SnapshotVertex)},
+      {&header.edges_offset, edges.data(), edges.size() * sizeof(SnapshotEdge)},
+      {&header.points_offset, points.data(), points.size() * sizeof(SnapshotPoint)},
+      {&header.out_offsets_offset, out_offsets.data(),
+       out_offsets.size() * sizeof(uint32_t)},
+      {&header.arcs_offset, arcs.data(), arcs.size() * sizeof(SnapshotArc)},
+      {&header.ids_offset, ids.data(), ids.size() * sizeof(SnapshotIdEntry)},
+  };
+  uint64_t end = sizeof(SnapshotHeader);
+  for (const Section &section : sections) {
+    *section.offset = AlignUp(end);
+    end             = *section.offset + section.size;
+  }
+  header.file_size = end;
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if (!output) {
+    spdlog::critical("Cannot open {} to write the snapshot.", path);
+    return false;
+  }
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  end = sizeof(SnapshotHeader);
+  for (const Section &section : sections) {
+    WritePadding(&output, end, *section.offset);
+    output.write(static_cast<const char *>(section.data),
+                 static_cast<std::streamsize>(section.size));
+    end = *section.offset + section.size;
+  }
+  output.close();
+  if (!output) {
+    spdlog::critical("Failed to write the snapshot to {}.", path);
+    return false;
+  }
+
+  spdlog::info("Saved a snapshot of {} vertices, {} edges and {} points ({} MB) to {}.",
+               vertices.size(), edges.size(), points.size(), header.file_size >> 20,
+               path);
+  return true;
+}
+
+std::unique_ptr<GraphSnapshot> GraphSnapshot::Open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    spdlog::critical("Cannot open the snapshot {}.", path);
+    return nullptr;
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < sizeof(SnapshotHeader)) {
+    spdlog::critical("{} is too small to be a snapshot.", path);
+    ::close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  void *data  = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the file descriptor is closed.
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    spdlog::critical("Cannot map the snapshot {}.", path);
+    return nullptr;
+  }
+  // Owns the mapping from here, so that it is unmapped on every return below.
+  std::unique_ptr<GraphSnapshot> snapshot(new GraphSnapshot(data, size));
+
+  const SnapshotHeader &header = *snapshot->header_;
+  if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0) {
+    spdlog::critical("{} is not a graph snapshot.", path);
+    return nullptr;
+  }
+  if (header.byte_order != kByteOrderMark) {
+    spdlog::critical("{} is written on a host of a different byte order.", path);
+    return nullptr;
+  }
+  if (header.version != kSnapshotVersion) {
+    spdlog::critical("{} is of version {}, while version {} is expected.", path,
+                     header.version, kSnapshotVersion);
+    return nullptr;
+  }
+  // Check the sections against the file size. Divide instead of multiply to
+  // stay clear of overflows with a corrupted header.
+  auto fits = [size](uint64_t offset, uint64_t count, size_t record_size) {
+    return offset % 8 == 0 && offset <= size && count <= (size - offset) / record_size;
+  };
+  // The search index uses 32-bit indices.
+  if (header.file_size != size || header.num_vertices >= kInvalidVertexIndex ||
+      header.num_edges > std::numeric_limits<uint32_t>::max() ||
+      !fits(header.vertices_offset, header.num_vertices, sizeof(SnapshotVertex)) ||
+      !fits(header.edges_offset, header.num_edges, sizeof(SnapshotEdge)) ||
+      !fits(header.points_offset, header.num_points, sizeof(SnapshotPoint)) ||
+      !fits(header.out_offsets_offset, header.num_vertices + 1, sizeof(uint32_t)) ||
+      !fits(header.arcs_offset, header.num_edges, sizeof(SnapshotArc)) ||
+      !fits(header.ids_offset, header.num_vertices, sizeof(SnapshotIdEntry))) {
+    spdlog::critical("{} is truncated or corrupted.", path);
+    return nullptr;
+  }
+
+  const char *base = static_cast<const char *>(data);
+  snapshot->vertices_ =
+      reinterpret_cast<const SnapshotVertex *>(base + header.vertices_offset);
+  snapshot->edges_ = reinterpret_cast<const SnapshotEdge *>(base + header.edges_offset);
+  snapshot->points_ =
+      reinterpret_cast<const SnapshotPoint *>(base + header.points_offset);
+  snapshot->out_offsets_ =
+      reinterpret_cast<const uint32_t *>(base + header.out_offsets_offset);
+  snapshot->arcs_ = reinterpret_cast<const SnapshotArc *>(base + header.arcs_offset);
+  snapshot->ids_  = reinterpret_cast<const SnapshotIdEntry *>(base + header.ids_offset);
+  // Only the ends of the offsets are checked here, since checking every arc
+  // would read the whole file. The searches check the arcs they read.
+  if (snapshot->out_offsets_[0] != 0 ||
+      snapshot->out_offsets_[header.num_vertices] != header.num_edges) {
+    spdlog::critical("{} has a corrupted search index.", path);
+    return nullptr;
+  }
+  return snapshot;
+}
+
+GraphSnapshot::GraphSnapshot(void *data, size_t size)
+    : data_(data),
+      size_(size),
+      header_(static_cast<const SnapshotHeader *>(data)),
+      vertices_(nullptr),
+      edges_(nullptr),
+      points_(nullptr),
+      out_offsets_(nullptr),
+      arcs_(nullptr),
+      ids_(nullptr) {}
+
+GraphSnapshot::~GraphSnapshot() { ::munmap(data_, size_); }
+
+VertexIndex GraphSnapshot::FindIndex(VertexID id) const {
+  const SnapshotIdEntry *end = ids_ + num_vertices();
+  const SnapshotIdEntry *entry =
+      std::lower_bound(ids_, end, id, [](const SnapshotIdEntry &entry, VertexID id) {
+        return entry.id < id;
+      });
+  if (entry == end || entry->id != id || entry->index >= num_vertices()) {
+    return kInvalidVertexIndex;
+  }
+  return entry->index;
+}
+
+RoadGraph GraphSnapshot::ToRoadGraph() const {
+  RoadGraph graph;
+  graph.Reserve(num_vertices(), num_edges(), num_points());
+
+  std::vector<const Vertex *> vertices;
+  vertices.reserve(num_vertices());
+  for (size_t i = 0; i < num_vertices(); ++i) {
+    vertices.emplace_back(&graph.AddVertex(vertices_[i].id, vertices_[i].loc()));
+  }
+
+  std::vector<osmium::Location> points;
+  for (size_t i = 0; i < num_edges(); ++i) {
+    const SnapshotEdge &record = edges_[i];
+    if (record.from >= num_vertices() || record.to >= num_vertices() ||
+        record.points_begin > record.points_end || record.points_end > num_points()) {
+      spdlog::critical("Skipping the corrupted edge {} in the snapshot.", record.id);
+      continue;
+    }
+    Edge &edge =
+        graph.AddEdge(*vertices[record.from], *vertices[record.to], record.length);
+    edge.id_     = record.id;
+    edge.weight_ = record.weight;
+    points.clear();
+    for (const SnapshotPoint *point = points_begin(record); point != points_end(record);
+         ++point) {
+      points.emplace_back(point->loc());
+    }
+    graph.SetPoints(edge, points);
+  }
+
+  return graph;
+}
+
+}  // namespace graph
+}  // namespace open_semap
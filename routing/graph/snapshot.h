@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "osmium/osm/location.hpp"
+
+#include "graph/defs.h"
+#include "graph/road_graph.h"
+
+namespace open_semap {
+namespace graph {
+
+// The on-disk layout of a graph snapshot. The integers are in the byte order of
+// the host that saved it, see SnapshotHeader::byte_order, and every section
+// starts at an offset that is a multiple of 8, so that the records can be used
+// in place once the file is mapped.
+//
+//   SnapshotHeader
+//   SnapshotVertex[num_vertices]
+//   SnapshotEdge[num_edges]
+//   SnapshotPoint[num_points]
+//   uint32_t out_offsets[num_vertices + 1]
+//   SnapshotArc[num_edges]
+//   SnapshotIdEntry[num_vertices]
+//
+// The last three sections are the search index: the outgoing arcs of the
+// vertex v are arcs[out_offsets[v], out_offsets[v + 1]), and the vertices
+// sorted by ID map an ID to its index. So a search runs on the mapping as it
+// is, see algorithms/snapshot_dijkstra.h.
+//
+// Bump kSnapshotVersion whenever the layout changes.
+constexpr char kSnapshotMagic[8]  = {'O', 'S', 'M', 'G', 'R', 'A', 'P', 'H'};
+constexpr uint32_t kSnapshotVersion = 3;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  // Written as 0x01020304. Open() refuses a snapshot from a host of the other
+  // byte order rather than swapping every record.
+  uint32_t byte_order;
+  uint64_t num_vertices;
+  uint64_t num_edges;
+  uint64_t num_points;
+  uint64_t vertices_offset;
+  uint64_t edges_offset;
+  uint64_t points_offset;
+  uint64_t out_offsets_offset;
+  uint64_t arcs_offset;
+  uint64_t ids_offset;
+  uint64_t file_size;
+};
+
+// Coordinates are osmium's fixed point integers, see osmium::Location::x().
+struct SnapshotPoint {
+  int32_t x;
+  int32_t y;
+
+  inline osmium::Location loc() const {
+    return osmium::Location(x, y);
+  }
+};
+
+struct SnapshotVertex {
+  int64_t id;
+  SnapshotPoint point;
+
+  inline osmium::Location loc() const {
+    return point.loc();
+  }
+};
+
+struct SnapshotEdge {
+  int64_t id;
+  // Indices into the vertices.
+  uint32_t from;
+  uint32_t to;
+  double length;
+  // The geometry of the edge is points[points_begin, points_end), including
+  // both ends.
+  uint64_t points_begin;
+  uint64_t points_end;
+  // The travel time, see graph/weight.h.
+  uint32_t weight;
+  uint32_t padding;
+};
+
+// An outgoing arc of a vertex, i.e. the hot part of a SnapshotEdge.
+struct SnapshotArc {
+  // The index of the vertex that the arc goes to.
+  uint32_t head;
+  uint32_t weight;
+  // The index of the edge in the edges.
+  uint32_t edge;
+};
+
+struct SnapshotIdEntry {
+  int64_t id;
+  uint32_t index;
+  uint32_t padding;
+};
+
+static_assert(sizeof(SnapshotHeader) == 96, "Unexpected snapshot header layout.");
+static_assert(sizeof(SnapshotPoint) == 8, "Unexpected snapshot point layout.");
+static_assert(sizeof(SnapshotVertex) == 16, "Unexpected snapshot vertex layout.");
+static_assert(sizeof(SnapshotEdge) == 48, "Unexpected snapshot edge layout.");
+static_assert(sizeof(SnapshotArc) == 12, "Unexpected snapshot arc layout.");
+static_assert(sizeof(SnapshotIdEntry) == 16, "Unexpected snapshot ID entry layout.");
+
+// A read-only, memory mapped graph snapshot. Opening a snapshot only maps the
+// file and checks the header, and the searches of
+// algorithms/snapshot_dijkstra.h run on the mapping without building anything,
+// so that routing servers start instantly, and several processes serving the
+// same snapshot share the page cache.
+class GraphSnapshot {
+ public:
+  // Writes the graph as a snapshot. Returns false if the file cannot be
+  // written.
+  static bool Save(const RoadGraph &graph, const std::string &path);
+
+  // Returns nullptr if the file cannot be mapped, or is not a valid snapshot
+  // of the supported version.
+  static std::unique_ptr<GraphSnapshot> Open(const std::string &path);
+
+  ~GraphSnapshot();
+
+  GraphSnapshot(const GraphSnapshot &) = delete;
+  GraphSnapshot &operator=(const GraphSnapshot &) = delete;
+
+  inline size_t num_vertices() const { return header_->num_vertices; }
+  inline size_t num_edges() const { return header_->num_edges; }
+  inline size_t num_points() const { return header_->num_points; }
+
+  inline const SnapshotVertex *vertices() const { return vertices_; }
+  inline const SnapshotEdge *edges() const { return edges_; }
+  inline const SnapshotPoint *points() const { return points_; }
+
+  inline const SnapshotPoint *points_begin(const SnapshotEdge &edge) const {
+    return points_ + edge.points_begin;
+  }
+
+  inline const SnapshotPoint *points_end(const SnapshotEdge &edge) const {
+    return points_ + edge.points_end;
+  }
+
+  // Finds the index of the vertex by a binary search over the ID index.
+  // Returns kInvalidVertexIndex if the snapshot does not have a vertex with
+  // the ID.
+  VertexIndex FindIndex(VertexID id) const;
+
+  inline uint32_t out_begin(VertexIndex v) const { return out_offsets_[v]; }
+
+  inline uint32_t out_end(VertexIndex v) const { return out_offsets_[v + 1]; }
+
+  inline const SnapshotArc &arc(uint32_t i) const { return arcs_[i]; }
+
+  // Builds a RoadGraph out of the snapshot, for the code that works on
+  // RoadGraph, SimpleIndexer, CsrGraph and the hierarchy, which all point to
+  // Vertex and Edge objects. This copies the whole graph into the arenas of the
+  // RoadGraph, and numbers the vertices in a hash map, so it costs what a load
+  // from a parsed file would minus the parsing. Not needed for the searches on
+  // the snapshot itself.
+  RoadGraph ToRoadGraph() const;
+
+ private:
+  GraphSnapshot(void *data, size_t size);
+
+  void *data_;
+  size_t size_;
+  const SnapshotHeader *header_;
+  const SnapshotVertex *vertices_;
+  const SnapshotEdge *edges_;
+  const SnapshotPoint *points_;
+  const uint32_t *out_offsets_;
+  const SnapshotArc *arcs_;
+  const SnapshotIdEntry *ids_;
+};
+
+}  // namespace graph
+}  // namespace open_semap
@@ -0,0 +1,73 @@
+#include "graph/space_filling_curve.h"
+
+#include <limits>
+#include <utility>
+
+namespace open_semap {
+namespace graph {
+
+namespace {
+
+// Scales the fixed point coordinates of the location to the cells of the grid,
+// which spans [-180, 180] x [-90, 90]. Returns false for invalid locations.
+bool ToGridCell(const osmium::Location &location, uint32_t *x, uint32_t *y) {
+  if (!location.valid()) {
+    return false;
+  }
+  constexpr uint64_t kMaxCell = std::numeric_limits<uint32_t>::max();
+  uint64_t lon = static_cast<uint64_t>(static_cast<int64_t>(location.x()) + 1800000000);
+  uint64_t lat = static_cast<uint64_t>(static_cast<int64_t>(location.y()) + 900000000);
+  *x = static_cast<uint32_t>(lon * kMaxCell / 3600000000);
+  *y = static_cast<uint32_t>(lat * kMaxCell / 1800000000);
+  return true;
+}
+
+// Spreads the 32 bits of the value to the even bits of the result.
+uint64_t SpreadBits(uint32_t value) {
+  uint64_t bits = value;
+  bits = (bits | (bits << 16)) & 0x0000FFFF0000FFFFULL;
+  bits = (bits | (bits << 8)) & 0x00FF00FF00FF00FFULL;
+  bits = (bits | (bits << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  bits = (bits | (bits << 2)) & 0x3333333333333333ULL;
+  bits = (bits | (bits << 1)) & 0x5555555555555555ULL;
+  return bits;
+}
+
+}  // namespace
+
+uint64_t HilbertKey(const osmium::Location &location) {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  if (!ToGridCell(location, &x, &y)) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+
+  uint64_t key = 0;
+  for (uint32_t s = uint32_t{1} << 31; s > 0; s >>= 1) {
+    uint32_t rx = (x & s) > 0 ? 1 : 0;
+    uint32_t ry = (y & s) > 0 ? 1 : 0;
+    key += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+    // Rotate the quadrant so that the curve in it starts and ends next to the
+    // neighboring quadrants.
+    if (ry == 0) {
+      if (rx == 1) {
+        x = ~x;
+        y = ~y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return key;
+}
+
+uint64_t MortonKey(const osmium::Location &location) {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  if (!ToGridCell(location, &x, &y)) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return SpreadBits(x) | (SpreadBits(y) << 1);
+}
+
+}  // namespace graph
+}  // namespace open_semap
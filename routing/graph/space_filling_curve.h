@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include "osmium/osm/location.hpp"
+
+namespace open_semap {
+namespace graph {
+
+// The order in which a RoadGraph keeps its vertices, see RoadGraph::Reorder().
+enum class VertexOrder {
+  // The order of the nodes in the input file.
+  kInput,
+  // Along a Hilbert curve over the locations. Vertices close on the curve are
+  // close on the map, and neighbors in the road network mostly end up a few
+  // cache lines apart.
+  kHilbert,
+  // Along a Morton (Z-order) curve. Cheaper to compute than the Hilbert curve,
+  // but with jumps between the quadrants.
+  kMorton,
+};
+
+// The position of the location along the curve over a 2^32 x 2^32 grid that
+// covers the whole world, at the precision of osmium::Location. Invalid
+// locations are put at the end of the curve.
+uint64_t HilbertKey(const osmium::Location &location);
+
+uint64_t MortonKey(const osmium::Location &location);
+
+}  // namespace graph
+}  // namespace open_semap
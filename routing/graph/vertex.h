@@ -6,9 +6,13 @@
 #include "osmium/osm/location.hpp"
 #include "osmium/osm/types.hpp"
 
+#include "graph/defs.h"
+
 namespace open_semap {
 namespace graph {
 
+class RoadGraph;
+
 class Vertex {
  public:
   Vertex(osmium::object_id_type id, osmium::Location location) : id_(id), loc_(location) {
@@ -22,9 +26,19 @@ class Vertex {
     return loc_;
   }
 
+  // The dense index of the vertex in the graph that owns it, which equals its
+  // position in RoadGraph::vertices(). Algorithms use it to index plain arrays
+  // instead of hash maps keyed by id().
+  inline VertexIndex index() const {
+    return index_;
+  }
+
  private:
+  friend class RoadGraph;
+
   osmium::object_id_type id_;
   osmium::Location loc_;
+  VertexIndex index_ = 0;
 };
 
 }  // namespace graph
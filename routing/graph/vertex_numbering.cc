@@ -0,0 +1,44 @@
+#include "graph/vertex_numbering.h"
+
+namespace open_semap {
+namespace graph {
+
+VertexIndex VertexNumbering::Find(VertexID id) const {
+  auto iter = indices_.find(id);
+  if (iter == indices_.end()) {
+    return kInvalidVertexIndex;
+  }
+  return iter->second;
+}
+
+VertexIndex VertexNumbering::Add(VertexID id) {
+  auto result = indices_.emplace(id, static_cast<VertexIndex>(ids_.size()));
+  if (result.second) {
+    ids_.emplace_back(id);
+  }
+  return result.first->second;
+}
+
+VertexID VertexNumbering::Remove(VertexID id) {
+  auto iter = indices_.find(id);
+  if (iter == indices_.end()) {
+    return id;
+  }
+  VertexIndex index = iter->second;
+  indices_.erase(iter);
+  VertexID moved = ids_.back();
+  if (index + 1 < ids_.size()) {
+    ids_[index]     = moved;
+    indices_[moved] = index;
+  }
+  ids_.pop_back();
+  return moved;
+}
+
+void VertexNumbering::Reserve(size_t size) {
+  indices_.reserve(size);
+  ids_.reserve(size);
+}
+
+}  // namespace graph
+}  // namespace open_semap
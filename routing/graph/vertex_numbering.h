@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "graph/defs.h"
+
+namespace open_semap {
+namespace graph {
+
+// A bidirectional mapping between the sparse 64-bit OSM IDs of the vertices and
+// dense 32-bit indices in [0, size()).
+//
+// Every RoadGraph keeps one, built when the graph loads, so that the algorithms
+// can work on indices and keep their per-vertex state in plain arrays. The OSM
+// IDs are only translated at the API boundary.
+class VertexNumbering {
+ public:
+  VertexNumbering() = default;
+
+  VertexNumbering(VertexNumbering &&) noexcept = default;
+  VertexNumbering &operator=(VertexNumbering &&) noexcept = default;
+
+  inline size_t size() const { return ids_.size(); }
+
+  // Returns kInvalidVertexIndex if the ID is not numbered.
+  VertexIndex Find(VertexID id) const;
+
+  inline VertexID id(VertexIndex index) const { return ids_[index]; }
+
+  // Numbers the ID with the next index and returns it. Returns the existing
+  // index if the ID is already numbered.
+  VertexIndex Add(VertexID id);
+
+  // Gives the index of the removed ID to the last one, so that the indices
+  // stay dense. Returns the ID that is moved, or the removed ID itself if it
+  // was the last one.
+  VertexID Remove(VertexID id);
+
+  void Reserve(size_t size);
+
+ private:
+  std::unordered_map<VertexID, VertexIndex> indices_{};
+  std::vector<VertexID> ids_{};
+};
+
+}  // namespace graph
+}  // namespace open_semap
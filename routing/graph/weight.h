@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace open_semap {
+namespace graph {
+
+// The cost of an edge for the searches: its travel time in deciseconds. 32
+// bits are enough for any path on the planet, take half the space of a double,
+// and compare as plain integers.
+using Weight = uint32_t;
+
+constexpr Weight kInfiniteWeight = std::numeric_limits<Weight>::max();
+
+constexpr double kWeightsPerSecond = 10.0;
+
+// The travel time of a road of the length (in meters) at the speed (in km/h),
+// rounded up so that only roads of zero length are free.
+inline Weight TravelTime(double length, double speed) {
+  if (length <= 0.0) {
+    return 0;
+  }
+  if (speed <= 0.0) {
+    return kInfiniteWeight;
+  }
+  double weight = std::ceil(length / (speed / 3.6) * kWeightsPerSecond);
+  return weight >= static_cast<double>(kInfiniteWeight) ? kInfiniteWeight
+                                                        : static_cast<Weight>(weight);
+}
+
+// Saturates at kInfiniteWeight.
+inline Weight AddWeights(Weight a, Weight b) {
+  return a > kInfiniteWeight - b ? kInfiniteWeight : a + b;
+}
+
+}  // namespace graph
+}  // namespace open_semap
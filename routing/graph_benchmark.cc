@@ -0,0 +1,489 @@
+// Measures building and querying the routing graph, on a routing graph file
+// produced by extract_routes and/or on a synthetic grid. The time, the CPU
+// time and the RSS of each stage are written as JSON, the same way as
+// extract_routes does, so that runs can be compared against each other.
+//
+// With --num_threads greater than 1, the file is loaded once on a single thread
+// first, so that the speedup of the parallel load can be read from one run.
+//
+// With --vertex_order, the graph is also reordered along the curve and the
+// same queries run again, so that the query stages before and after can be
+// compared. The queries run once with each priority queue, then with the
+// bidirectional search and with A*. The query stages report the latency
+// percentiles, the vertices settled, the queue operations and, where the kernel
+// allows perf_event_open(), the hardware cache misses.
+//
+// With --contraction_grid_size, a smaller grid is contracted as well. The
+// memory taken by its shortcuts and its hierarchy is reported, and the queries
+// on the hierarchy are compared with Dijkstra on the same grid. So is a
+// --matrix_size x --matrix_size distance matrix, against one full Dijkstra per
+// source.
+//
+// With --snapshot, the graph is saved as a snapshot, opened, and the same
+// queries run on the mapping, against building a RoadGraph and a CsrGraph out
+// of the snapshot first.
+//
+// The peak RSS of a stage is reset when the stage starts where the kernel allows
+// it, otherwise it is the high-water mark of the whole process so far.
+//
+// For reference, building the unshuffled 1000x1000 grid (1M vertices, 4M
+// edges) on one core took:
+//
+//   one heap allocation per vertex and edge        0.66-0.70s   peak 545 MB
+//   slab arenas for the vertices and edges         0.63-0.83s   peak 518 MB
+//   this tree, with the geometry in GeometryStore  0.61-0.63s   peak 374 MB
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "spdlog/spdlog.h"
+
+#include "algorithms/astar.h"
+#include "algorithms/bidirectional_dijkstra.h"
+#include "algorithms/contraction.h"
+#include "algorithms/contraction_hierarchy.h"
+#include "algorithms/dijkstra.h"
+#include "algorithms/distance_matrix.h"
+#include "algorithms/snapshot_dijkstra.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "graph/simple_indexer.h"
+#include "graph/snapshot.h"
+#include "graph/space_filling_curve.h"
+#include "utils/metrics.h"
+
+DEFINE_string(input, "", "The routing graph file to benchmark. Skipped if empty.");
+
+DEFINE_int32(num_threads, std::thread::hardware_concurrency(),
+             "The number of threads used to load the routing graph file and to "
+             "compute the distance matrix.");
+
+DEFINE_int32(grid_size, 1000,
+             "Also benchmark a synthetic grid of grid_size x grid_size vertices. "
+             "Skipped if 0.");
+
+DEFINE_bool(shuffle_grid, true,
+            "Add the vertices of the grid in a random order, like the nodes of "
+            "a real OSM file, instead of row by row.");
+
+DEFINE_int32(num_queries, 100, "The number of random Dijkstra queries to run.");
+
+DEFINE_string(vertex_order, "",
+              "If \"hilbert\" or \"morton\", reorder the graph along the curve and "
+              "run the queries again.");
+
+DEFINE_int32(contraction_grid_size, 100,
+             "Also contract a synthetic grid of contraction_grid_size x "
+             "contraction_grid_size vertices. Skipped if 0.");
+
+DEFINE_int32(matrix_size, 1000,
+             "The number of random sources and targets of the distance matrix on "
+             "the contracted grid. Skipped if 0.");
+
+DEFINE_string(snapshot, "",
+              "Where to save the graphs as snapshots, to benchmark the queries on "
+              "the mapping. Skipped if empty.");
+
+DEFINE_string(metrics_output, "graph_benchmark.metrics.json",
+              "Where to write the metrics as JSON.");
+
+namespace open_semap {
+
+using Query = std::pair<graph::VertexID, graph::VertexID>;
+
+// Counts the hardware cache misses of the calling thread. Does nothing where
+// the counters are not available, e.g. in most containers.
+class CacheMissCounter {
+ public:
+  CacheMissCounter() {
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    fd_ = static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fd_ < 0) {
+      spdlog::warn("Hardware cache miss counters are not available.");
+      return;
+    }
+    ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  ~CacheMissCounter() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  CacheMissCounter(const CacheMissCounter &) = delete;
+  CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+  // Returns false if the counter is not available.
+  bool Read(uint64_t *count) const {
+    return fd_ >= 0 && ::read(fd_, count, sizeof(*count)) == sizeof(*count);
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// The same queries for every run on the same graph, whatever its order.
+std::vector<Query> MakeQueries(const graph::RoadGraph &graph) {
+  std::vector<Query> queries;
+  if (graph.vertices().empty()) {
+    return queries;
+  }
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, graph.vertices().size() - 1);
+  for (int i = 0; i < FLAGS_num_queries; ++i) {
+    graph::VertexID start = graph.vertices()[pick(rng)]->id();
+    graph::VertexID goal  = graph.vertices()[pick(rng)]->id();
+    queries.emplace_back(start, goal);
+  }
+  return queries;
+}
+
+// Sets the percentiles of the query latencies, in nanoseconds, on the stage.
+void SetLatencies(std::vector<uint64_t> *latencies, ScopedStage *stage) {
+  std::sort(latencies->begin(), latencies->end());
+  stage->SetSize("p50_query_ns", (*latencies)[latencies->size() / 2]);
+  stage->SetSize("p99_query_ns", (*latencies)[latencies->size() * 99 / 100]);
+}
+
+void BenchmarkQueries(const std::string &name, const graph::CsrGraph &csr,
+                      const std::vector<Query> &queries, PriorityQueueType queue_type) {
+  ScopedStage stage(name);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(queries.size());
+  // Shared by the queries, as a server would do.
+  DijkstraWorkspace workspace(queue_type);
+  uint64_t settled = 0;
+  CacheMissCounter cache_misses;
+  for (const Query &query : queries) {
+    auto start = std::chrono::steady_clock::now();
+    settled += RunDijkstra(csr, query.first, {query.second}, &workspace).size();
+    latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+  }
+  uint64_t count = 0;
+  if (cache_misses.Read(&count)) {
+    stage.SetSize("cache_misses", count);
+  }
+  SetLatencies(&latencies, &stage);
+  stage.SetSize("settled_vertices", settled);
+  stage.SetSize("queue_pushes", workspace.queue_stats().pushes);
+  stage.SetSize("queue_decrease_keys", workspace.queue_stats().decrease_keys);
+  stage.SetSize("queue_pops", workspace.queue_stats().pops);
+  stage.AddObjects(queries.size());
+}
+
+// The same queries as BenchmarkQueries(), answered by the bidirectional search
+// with the default queue. Compare its settled vertices with the radix heap
+// stage of the one-sided search.
+void BenchmarkBidirectionalQueries(const std::string &name, const graph::CsrGraph &csr,
+                                   const std::vector<Query> &queries) {
+  ScopedStage stage(name);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(queries.size());
+  BidirectionalWorkspace workspace;
+  uint64_t settled = 0;
+  for (const Query &query : queries) {
+    auto start = std::chrono::steady_clock::now();
+    settled += RunBidirectionalDijkstra(csr, query.first, query.second, &workspace)
+                   .num_settled;
+    latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+  }
+  SetLatencies(&latencies, &stage);
+  stage.SetSize("settled_vertices", settled);
+  stage.AddObjects(queries.size());
+}
+
+// The same queries again with A*, after building its bound for the graph.
+void BenchmarkAStarQueries(const std::string &name, const graph::CsrGraph &csr,
+                           const std::vector<Query> &queries) {
+  TravelTimeBound bound;
+  {
+    ScopedStage stage(name + "/travel_time_bound");
+    bound = TravelTimeBound::Create(csr);
+    stage.AddObjects(csr.num_vertices());
+  }
+
+  ScopedStage stage(name + "/astar");
+  std::vector<uint64_t> latencies;
+  latencies.reserve(queries.size());
+  AStarWorkspace workspace;
+  uint64_t settled = 0;
+  for (const Query &query : queries) {
+    auto start = std::chrono::steady_clock::now();
+    settled += RunAStar(csr, bound, query.first, query.second, &workspace).num_settled;
+    latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+  }
+  SetLatencies(&latencies, &stage);
+  stage.SetSize("settled_vertices", settled);
+  stage.AddObjects(queries.size());
+}
+
+void BenchmarkGraph(const std::string &name, const graph::RoadGraph &graph,
+                    const std::vector<Query> &queries) {
+  spdlog::info("[{}] {} vertices, {} edges.", name, graph.vertices().size(),
+               graph.edges().size());
+
+  {
+    ScopedStage stage(name + "/simple_indexer");
+    graph::SimpleIndexer indexer = graph::SimpleIndexer::CreateFromRawGraph(graph);
+    stage.AddObjects(graph.vertices().size() + graph.edges().size());
+  }
+
+  graph::CsrGraph csr;
+  {
+    ScopedStage stage(name + "/csr_graph");
+    csr = graph::CsrGraph::CreateFromRawGraph(graph);
+    stage.AddObjects(graph.vertices().size() + graph.edges().size());
+  }
+
+  if (queries.empty()) {
+    return;
+  }
+
+  for (PriorityQueueType queue_type :
+       {PriorityQueueType::kLazyBinaryHeap, PriorityQueueType::kIndexedFourAryHeap,
+        PriorityQueueType::kRadixHeap}) {
+    BenchmarkQueries(name + "/dijkstra/" + PriorityQueueName(queue_type), csr, queries,
+                     queue_type);
+  }
+  BenchmarkBidirectionalQueries(name + "/bidirectional_dijkstra", csr, queries);
+  BenchmarkAStarQueries(name, csr, queries);
+}
+
+// Saves the graph as a snapshot and runs the queries on the mapping. The time
+// to the first answer is open + the first query, against open + ToRoadGraph()
+// + a CsrGraph for the searches that need Edge objects.
+void BenchmarkSnapshot(const std::string &name, const graph::RoadGraph &graph,
+                       const std::vector<Query> &queries) {
+  if (FLAGS_snapshot.empty() || queries.empty()) {
+    return;
+  }
+  {
+    ScopedStage stage(name + "/snapshot/save");
+    if (!graph::GraphSnapshot::Save(graph, FLAGS_snapshot)) {
+      return;
+    }
+    stage.AddObjects(graph.vertices().size() + graph.edges().size());
+  }
+
+  std::unique_ptr<graph::GraphSnapshot> snapshot;
+  {
+    ScopedStage stage(name + "/snapshot/open");
+    snapshot = graph::GraphSnapshot::Open(FLAGS_snapshot);
+    if (snapshot == nullptr) {
+      return;
+    }
+    stage.AddObjects(snapshot->num_vertices() + snapshot->num_edges());
+  }
+
+  {
+    ScopedStage stage(name + "/snapshot/dijkstra");
+    std::vector<uint64_t> latencies;
+    latencies.reserve(queries.size());
+    SnapshotSearchWorkspace workspace;
+    uint64_t settled = 0;
+    for (const Query &query : queries) {
+      auto start = std::chrono::steady_clock::now();
+      settled +=
+          RunDijkstra(*snapshot, query.first, query.second, &workspace).num_settled;
+      latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count());
+    }
+    SetLatencies(&latencies, &stage);
+    stage.SetSize("settled_vertices", settled);
+    stage.AddObjects(queries.size());
+  }
+
+  ScopedStage stage(name + "/snapshot/to_csr_graph");
+  graph::RoadGraph copy = snapshot->ToRoadGraph();
+  graph::CsrGraph csr   = graph::CsrGraph::CreateFromRawGraph(copy);
+  stage.AddObjects(csr.num_vertices());
+}
+
+// Benchmarks the graph, and again after reordering it if asked to.
+void BenchmarkAndReorder(const std::string &name, graph::RoadGraph *graph) {
+  std::vector<Query> queries = MakeQueries(*graph);
+  BenchmarkGraph(name, *graph, queries);
+  BenchmarkSnapshot(name, *graph, queries);
+
+  if (FLAGS_vertex_order.empty()) {
+    return;
+  }
+  graph::VertexOrder order = graph::VertexOrder::kHilbert;
+  if (FLAGS_vertex_order == "morton") {
+    order = graph::VertexOrder::kMorton;
+  } else if (FLAGS_vertex_order != "hilbert") {
+    spdlog::critical("Unknown vertex order \"{}\".", FLAGS_vertex_order);
+    return;
+  }
+  {
+    ScopedStage stage(name + "/reorder_" + FLAGS_vertex_order);
+    graph->Reorder(order);
+    stage.AddObjects(graph->vertices().size() + graph->edges().size());
+  }
+  BenchmarkGraph(name + "/" + FLAGS_vertex_order, *graph, queries);
+}
+
+// Computes a matrix between random vertices on the hierarchy, then the same
+// costs with one full Dijkstra per source, on one thread.
+void BenchmarkDistanceMatrix(const std::string &name, const graph::RoadGraph &graph,
+                             const graph::CsrGraph &csr,
+                             const ContractionHierarchy &hierarchy) {
+  if (FLAGS_matrix_size <= 0) {
+    return;
+  }
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> pick(0, graph.vertices().size() - 1);
+  std::vector<graph::VertexID> sources;
+  std::vector<graph::VertexID> targets;
+  for (int i = 0; i < FLAGS_matrix_size; ++i) {
+    sources.emplace_back(graph.vertices()[pick(rng)]->id());
+    targets.emplace_back(graph.vertices()[pick(rng)]->id());
+  }
+  const uint64_t num_cells = sources.size() * targets.size();
+
+  {
+    ScopedStage stage(name + "/distance_matrix");
+    DistanceMatrix matrix =
+        ComputeDistanceMatrix(hierarchy, sources, targets, FLAGS_num_threads);
+    stage.AddObjects(num_cells);
+    stage.SetSize("threads", static_cast<uint64_t>(std::max(FLAGS_num_threads, 1)));
+    stage.SetSize("matrix_bytes", matrix.costs.size() * sizeof(graph::Weight));
+  }
+
+  ScopedStage stage(name + "/matrix_dijkstra");
+  DijkstraWorkspace workspace;
+  for (graph::VertexID source : sources) {
+    RunDijkstra(csr, source, {}, &workspace);
+  }
+  stage.AddObjects(num_cells);
+}
+
+// Contracts the graph, and reports the memory of the shortcuts as records
+// against what they would take as Edges. Then answers random queries on the
+// hierarchy, and the same ones with Dijkstra for comparison.
+void BenchmarkContraction(const std::string &name, const graph::RoadGraph &graph) {
+  graph::SimpleIndexer indexer = graph::SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts;
+  {
+    ScopedStage stage(name + "/contraction");
+    shortcuts = ContractGraph(&indexer);
+    stage.AddObjects(graph.vertices().size());
+    stage.SetSize("shortcuts", shortcuts.size());
+    stage.SetSize("shortcut_bytes", shortcuts.size() * sizeof(Shortcut));
+    stage.SetSize("shortcut_edge_bytes",
+                  shortcuts.size() * (sizeof(graph::Edge) + sizeof(const graph::Edge *)));
+  }
+
+  ContractionHierarchy hierarchy;
+  {
+    ScopedStage stage(name + "/contraction_hierarchy");
+    hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+    stage.AddObjects(hierarchy.num_arcs());
+    stage.SetSize("hierarchy_bytes", hierarchy.used_memory());
+  }
+
+  std::vector<Query> queries = MakeQueries(graph);
+  if (queries.empty()) {
+    return;
+  }
+  graph::CsrGraph csr = graph::CsrGraph::CreateFromRawGraph(graph);
+  BenchmarkQueries(name + "/contraction_dijkstra", csr, queries,
+                   PriorityQueueType::kRadixHeap);
+
+  {
+    ScopedStage stage(name + "/ch_query");
+    std::vector<uint64_t> latencies;
+    latencies.reserve(queries.size());
+    ChQueryWorkspace workspace;
+    uint64_t settled = 0;
+    for (const Query &query : queries) {
+      auto start = std::chrono::steady_clock::now();
+      settled += RunChQuery(hierarchy, query.first, query.second, &workspace).num_settled;
+      latencies.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count());
+    }
+    SetLatencies(&latencies, &stage);
+    stage.SetSize("settled_vertices", settled);
+    stage.AddObjects(queries.size());
+  }
+
+  BenchmarkDistanceMatrix(name, graph, csr, hierarchy);
+}
+
+}  // namespace open_semap
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (!FLAGS_input.empty()) {
+    if (FLAGS_num_threads > 1) {
+      // The single threaded baseline of the load below, from the same run.
+      open_semap::ScopedStage stage("file/load_1_thread");
+      open_semap::graph::RoadGraph graph =
+          open_semap::graph::RoadGraph::LoadFromFile(FLAGS_input);
+      stage.AddObjects(graph.vertices().size() + graph.edges().size());
+      stage.SetSize("threads", 1);
+    }
+    std::unique_ptr<open_semap::ScopedStage> stage =
+        std::make_unique<open_semap::ScopedStage>("file/load");
+    open_semap::graph::LoadOptions options;
+    options.num_threads = FLAGS_num_threads;
+    open_semap::graph::RoadGraph graph =
+        open_semap::graph::RoadGraph::LoadFromFile(FLAGS_input, options);
+    stage->AddObjects(graph.vertices().size() + graph.edges().size());
+    stage->SetSize("threads", static_cast<uint64_t>(std::max(FLAGS_num_threads, 1)));
+    stage.reset();
+    open_semap::BenchmarkAndReorder("file", &graph);
+  }
+
+  if (FLAGS_grid_size > 0) {
+    std::unique_ptr<open_semap::ScopedStage> stage =
+        std::make_unique<open_semap::ScopedStage>("grid/build");
+    open_semap::graph::RoadGraph graph = open_semap::graph::MakeGridGraph(
+        FLAGS_grid_size, FLAGS_grid_size, FLAGS_shuffle_grid ? 42 : 0);
+    stage->AddObjects(graph.vertices().size() + graph.edges().size());
+    stage.reset();
+    open_semap::BenchmarkAndReorder("grid", &graph);
+  }
+
+  if (FLAGS_contraction_grid_size > 0) {
+    open_semap::graph::RoadGraph graph =
+        open_semap::graph::MakeGridGraph(FLAGS_contraction_grid_size,
+                                         FLAGS_contraction_grid_size,
+                                         FLAGS_shuffle_grid ? 42 : 0);
+    open_semap::BenchmarkContraction("grid", graph);
+  }
+
+  open_semap::MetricsRegistry::Global().WriteJson(FLAGS_metrics_output);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+// Measures how fast a routing profile tells the roads from the other ways,
+// against the strcmp chain that predicate::IsValidRoad() used to hard-code, and
+// a car profile against the strcmp chain of the same rules. The ways of the
+// input are decoded once and kept in memory, so that only the checks are timed.
+// The time of each stage is written as JSON, the same way as graph_benchmark
+// does.
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "osmium/io/pbf_input.hpp"
+#include "osmium/io/reader.hpp"
+#include "osmium/io/xml_input.hpp"
+#include "osmium/memory/buffer.hpp"
+#include "osmium/osm.hpp"
+#include "spdlog/spdlog.h"
+
+#include "utils/metrics.h"
+#include "utils/routing_profile.h"
+
+DEFINE_string(input, "tests/data/adobe_wells.osm",
+              "The OSM file whose ways are checked, in xml or pbf format.");
+
+DEFINE_string(profile, "",
+              "Also time this profile file. The default profile is always timed.");
+
+DEFINE_int32(repeat, 20000, "How many times each way is checked.");
+
+DEFINE_string(metrics_output, "profile_benchmark.metrics.json",
+              "Where to write the metrics as JSON.");
+
+namespace open_semap {
+
+namespace {
+
+// predicate::IsValidRoad() before the routing profiles, as the baseline.
+bool LegacyIsValidRoad(const osmium::TagList &tags) {
+  const char *highway = tags["highway"];
+  if (highway == nullptr) {
+    return false;
+  }
+  if (std::strcmp(highway, "footway") == 0) {
+    return false;
+  }
+  if (std::strcmp(highway, "service") == 0) {
+    return false;
+  }
+  return true;
+}
+
+// A car profile, and the strcmp chain that would hard-code it, to compare the
+// two on a profile with more than a couple of values.
+constexpr char kCarProfile[] =
+    "name car\n"
+    "allow highway motorway trunk primary secondary tertiary residential "
+    "unclassified\n"
+    "deny access no private\n"
+    "deny motor_vehicle no\n";
+
+bool CarStrcmpChain(const osmium::TagList &tags) {
+  const char *highway = tags["highway"];
+  if (highway == nullptr) {
+    return false;
+  }
+  if (std::strcmp(highway, "motorway") != 0 && std::strcmp(highway, "trunk") != 0 &&
+      std::strcmp(highway, "primary") != 0 && std::strcmp(highway, "secondary") != 0 &&
+      std::strcmp(highway, "tertiary") != 0 && std::strcmp(highway, "residential") != 0 &&
+      std::strcmp(highway, "unclassified") != 0) {
+    return false;
+  }
+  const char *access = tags["access"];
+  if (access != nullptr &&
+      (std::strcmp(access, "no") == 0 || std::strcmp(access, "private") == 0)) {
+    return false;
+  }
+  const char *motor_vehicle = tags["motor_vehicle"];
+  return motor_vehicle == nullptr || std::strcmp(motor_vehicle, "no") != 0;
+}
+
+template <typename Check>
+void BenchmarkCheck(const std::string &name, const std::vector<const osmium::Way *> &ways,
+                    const Check &check) {
+  ScopedStage stage("profile/" + name);
+  uint64_t accepted = 0;
+  auto start        = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_repeat; ++i) {
+    for (const osmium::Way *way : ways) {
+      accepted += check(way->tags()) ? 1 : 0;
+    }
+  }
+  double nanoseconds = std::chrono::duration<double, std::nano>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  uint64_t num_checks = static_cast<uint64_t>(FLAGS_repeat) * ways.size();
+  stage.AddObjects(num_checks);
+  stage.SetSize("accepted_ways", accepted / std::max(FLAGS_repeat, 1));
+  // In picoseconds, as most checks take a few nanoseconds.
+  double picoseconds = nanoseconds * 1000.0 / std::max<uint64_t>(num_checks, 1);
+  stage.SetSize("ps_per_way", static_cast<uint64_t>(picoseconds));
+}
+
+}  // namespace
+
+}  // namespace open_semap
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::vector<osmium::memory::Buffer> buffers;
+  std::vector<const osmium::Way *> ways;
+  {
+    osmium::io::File input_file(FLAGS_input);
+    osmium::io::Reader reader(input_file, osmium::osm_entity_bits::way);
+    while (osmium::memory::Buffer buffer = reader.read()) {
+      buffers.emplace_back(std::move(buffer));
+    }
+    reader.close();
+  }
+  for (osmium::memory::Buffer &buffer : buffers) {
+    for (const osmium::Way &way : buffer.select<osmium::Way>()) {
+      ways.emplace_back(&way);
+    }
+  }
+  spdlog::info("Checking {} ways {} times.", ways.size(), FLAGS_repeat);
+
+  open_semap::BenchmarkCheck("legacy_predicate", ways, open_semap::LegacyIsValidRoad);
+
+  const open_semap::RoutingProfile &profile = open_semap::RoutingProfile::Default();
+  open_semap::BenchmarkCheck("default", ways, [&profile](const osmium::TagList &tags) {
+    return profile.Accepts(tags);
+  });
+
+  open_semap::BenchmarkCheck("car_strcmp_chain", ways, open_semap::CarStrcmpChain);
+
+  std::unique_ptr<open_semap::RoutingProfile> car =
+      open_semap::RoutingProfile::Parse(open_semap::kCarProfile);
+  open_semap::BenchmarkCheck(
+      "car", ways, [&car](const osmium::TagList &tags) { return car->Accepts(tags); });
+
+  if (!FLAGS_profile.empty()) {
+    std::unique_ptr<open_semap::RoutingProfile> loaded =
+        open_semap::RoutingProfile::LoadFromFile(FLAGS_profile);
+    if (loaded == nullptr) {
+      return 1;
+    }
+    open_semap::BenchmarkCheck(
+        loaded->name(), ways,
+        [&loaded](const osmium::TagList &tags) { return loaded->Accepts(tags); });
+  }
+
+  open_semap::MetricsRegistry::Global().WriteJson(FLAGS_metrics_output);
+  return 0;
+}
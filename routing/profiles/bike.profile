@@ -0,0 +1,14 @@
+# Roads and paths that can be cycled on.
+name bike
+
+allow highway primary primary_link secondary secondary_link tertiary tertiary_link
+allow highway unclassified residential living_street service road
+allow highway cycleway path track
+
+deny access no private
+deny bicycle no private
+deny area yes
+
+# In km/h, capped by the maxspeed tag of the road.
+speed 18 *
+speed 12 track path
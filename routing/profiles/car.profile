@@ -0,0 +1,21 @@
+# Roads that are open to cars.
+name car
+
+allow highway motorway motorway_link trunk trunk_link
+allow highway primary primary_link secondary secondary_link tertiary tertiary_link
+allow highway unclassified residential living_street road
+
+deny access no private
+deny motor_vehicle no private
+deny motorcar no private
+deny area yes
+
+# Typical speeds in km/h, capped by the maxspeed tag of the road.
+speed 110 motorway
+speed 90 trunk
+speed 65 primary
+speed 55 secondary
+speed 45 tertiary motorway_link trunk_link
+speed 40 unclassified primary_link secondary_link tertiary_link
+speed 25 residential road
+speed 10 living_street
@@ -0,0 +1,14 @@
+# Roads and paths that can be walked on. Motorways and trunk roads are
+# excluded.
+name pedestrian
+
+allow highway primary primary_link secondary secondary_link tertiary tertiary_link
+allow highway unclassified residential living_street service road
+allow highway footway pedestrian path steps track cycleway
+
+deny access no private
+deny foot no private
+
+# In km/h, capped by the maxspeed tag of the road.
+speed 5 *
+speed 4 steps track
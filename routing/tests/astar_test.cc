@@ -0,0 +1,128 @@
+#include "algorithms/astar.h"
+
+#include <random>
+
+#include "algorithms/dijkstra.h"
+#include "algorithms/route_testing.h"
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::RoadGraph;
+using graph::Vertex;
+using graph::VertexID;
+
+TEST(AStarTest, BoundNeverOverestimates) {
+  RoadGraph graph       = graph::MakeGridGraph(20, 20, 3);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+  TravelTimeBound bound = TravelTimeBound::Create(csr);
+  ASSERT_GT(bound.weights_per_meter(), 0.0);
+
+  VertexID target           = 211;
+  graph::VertexIndex to     = csr.FindIndex(target);
+  const SearchTree expected = RunDijkstra(csr, target, {});
+  for (const Vertex *vertex : graph.vertices()) {
+    if (vertex->id() == target) {
+      EXPECT_EQ(0u, bound.Estimate(to, to));
+      continue;
+    }
+    // The grid has the same roads both ways, so the costs from the target are
+    // the costs to it.
+    EXPECT_LE(bound.Estimate(csr.FindIndex(vertex->id()), to),
+              expected.Find(vertex->id())->cost());
+  }
+}
+
+TEST(AStarTest, MatchesDijkstraOnGrid) {
+  RoadGraph graph       = graph::MakeGridGraph(15, 15, 5);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+  TravelTimeBound bound = TravelTimeBound::Create(csr);
+
+  std::mt19937 rng(17);
+  std::uniform_int_distribution<size_t> pick(0, graph.vertices().size() - 1);
+  for (PriorityQueueType type :
+       {PriorityQueueType::kLazyBinaryHeap, PriorityQueueType::kIndexedFourAryHeap,
+        PriorityQueueType::kRadixHeap}) {
+    AStarWorkspace workspace(type);
+    for (int i = 0; i < 50; ++i) {
+      VertexID source     = graph.vertices()[pick(rng)]->id();
+      VertexID target     = graph.vertices()[pick(rng)]->id();
+      SearchTree expected = RunDijkstra(csr, source, {});
+      Route route         = RunAStar(csr, bound, source, target, &workspace);
+      ASSERT_TRUE(route.found()) << PriorityQueueName(type);
+      if (source == target) {
+        EXPECT_EQ(0u, route.cost);
+        EXPECT_TRUE(route.edges.empty());
+        continue;
+      }
+      EXPECT_EQ(expected.Find(target)->cost(), route.cost) << PriorityQueueName(type);
+      ExpectConnected(route, source, target);
+    }
+  }
+}
+
+TEST(AStarTest, SettlesLessThanDijkstra) {
+  RoadGraph graph       = graph::MakeGridGraph(40, 40);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+  TravelTimeBound bound = TravelTimeBound::Create(csr);
+
+  // Across the grid, from the middle of a side to the middle of the other.
+  VertexID source = 20 * 40 + 1;
+  VertexID target = 20 * 40 + 40;
+  SearchTree tree = RunDijkstra(csr, source, {target});
+  Route route     = RunAStar(csr, bound, source, target);
+
+  EXPECT_EQ(tree.Find(target)->cost(), route.cost);
+  EXPECT_LT(route.num_settled * 2, tree.size());
+}
+
+TEST(AStarTest, WithoutLocations) {
+  // The builder leaves the locations undefined, so the bound is 0 and the
+  // search is Dijkstra.
+  std::mt19937 rng(19);
+  std::uniform_int_distribution<VertexID> pick(1, 100);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 300; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+  TravelTimeBound bound = TravelTimeBound::Create(csr);
+  EXPECT_EQ(0.0, bound.weights_per_meter());
+
+  AStarWorkspace workspace;
+  for (const Vertex *source : graph.vertices()) {
+    SearchTree expected = RunDijkstra(csr, source->id(), {});
+    for (const Vertex *target : graph.vertices()) {
+      if (source == target) {
+        continue;
+      }
+      Route route = RunAStar(csr, bound, source->id(), target->id(), &workspace);
+      const SearchNode *node = expected.Find(target->id());
+      ASSERT_EQ(node != nullptr, route.found());
+      if (node != nullptr) {
+        EXPECT_EQ(node->cost(), route.cost);
+        ExpectConnected(route, source->id(), target->id());
+      }
+    }
+  }
+}
+
+TEST(AStarTest, NotFound) {
+  RoadGraph graph =
+      graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).AddEdge(3, 4, 5.0).Build();
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+  TravelTimeBound bound;
+
+  EXPECT_FALSE(RunAStar(csr, bound, 1, 4).found());
+  EXPECT_FALSE(RunAStar(csr, bound, 2, 1).found());
+  EXPECT_FALSE(RunAStar(csr, bound, 1, 9).found());
+}
+
+}  // namespace open_semap
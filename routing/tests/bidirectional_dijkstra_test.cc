@@ -0,0 +1,126 @@
+#include "algorithms/bidirectional_dijkstra.h"
+
+#include <random>
+
+#include "algorithms/dijkstra.h"
+#include "algorithms/route_testing.h"
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::RoadGraph;
+using graph::Vertex;
+using graph::VertexID;
+
+TEST(BidirectionalDijkstraTest, SampleGraph) {
+  RoadGraph graph = graph::RoadGraphBuilder()
+                        .AddEdge(1, 2, 15.0)
+                        .AddEdge(1, 4, 4.0)
+                        .AddEdge(4, 3, 3.0)
+                        .AddEdge(3, 2, 10.0)
+                        .AddEdge(2, 5, 1.0)
+                        .Build();
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+
+  Route route = RunBidirectionalDijkstra(csr, 1, 5);
+  EXPECT_EQ(16u, route.cost);
+  ASSERT_EQ(2u, route.edges.size());
+  ExpectConnected(route, 1, 5);
+
+  route = RunBidirectionalDijkstra(csr, 1, 3);
+  EXPECT_EQ(7u, route.cost);
+  ExpectConnected(route, 1, 3);
+}
+
+TEST(BidirectionalDijkstraTest, SourceIsTarget) {
+  RoadGraph graph = graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).Build();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+
+  Route route = RunBidirectionalDijkstra(csr, 2, 2);
+  EXPECT_TRUE(route.found());
+  EXPECT_EQ(0u, route.cost);
+  EXPECT_TRUE(route.edges.empty());
+}
+
+TEST(BidirectionalDijkstraTest, NotFound) {
+  RoadGraph graph =
+      graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).AddEdge(3, 4, 5.0).Build();
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+
+  // Unreachable, against the direction of the edge, and unknown.
+  EXPECT_FALSE(RunBidirectionalDijkstra(csr, 1, 4).found());
+  EXPECT_FALSE(RunBidirectionalDijkstra(csr, 2, 1).found());
+  EXPECT_FALSE(RunBidirectionalDijkstra(csr, 1, 9).found());
+  EXPECT_FALSE(RunBidirectionalDijkstra(csr, 9, 1).found());
+}
+
+TEST(BidirectionalDijkstraTest, MatchesDijkstra) {
+  std::mt19937 rng(13);
+  std::uniform_int_distribution<VertexID> pick(1, 150);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 500; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph = builder.Build();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+
+  // All the pairs with every queue, each queue in its own workspace reused over
+  // all the queries.
+  for (PriorityQueueType type :
+       {PriorityQueueType::kLazyBinaryHeap, PriorityQueueType::kIndexedFourAryHeap,
+        PriorityQueueType::kRadixHeap}) {
+    BidirectionalWorkspace workspace(type);
+    for (const Vertex *source : graph.vertices()) {
+      SearchTree expected = RunDijkstra(csr, source->id(), {});
+      for (const Vertex *target : graph.vertices()) {
+        Route route =
+            RunBidirectionalDijkstra(csr, source->id(), target->id(), &workspace);
+        if (source == target) {
+          EXPECT_EQ(0u, route.cost);
+          continue;
+        }
+        const SearchNode *node = expected.Find(target->id());
+        ASSERT_EQ(node != nullptr, route.found()) << PriorityQueueName(type);
+        if (node != nullptr) {
+          EXPECT_EQ(node->cost(), route.cost) << PriorityQueueName(type);
+          ExpectConnected(route, source->id(), target->id());
+        }
+      }
+    }
+  }
+}
+
+TEST(BidirectionalDijkstraTest, SettlesLessOnGrid) {
+  // A grid of two-way streets, queried from a corner to the opposite one.
+  constexpr VertexID kSize = 40;
+  graph::RoadGraphBuilder builder;
+  for (VertexID row = 0; row < kSize; ++row) {
+    for (VertexID col = 0; col < kSize; ++col) {
+      VertexID id = row * kSize + col + 1;
+      if (col + 1 < kSize) {
+        builder.AddEdge(id, id + 1, 10.0).AddEdge(id + 1, id, 10.0);
+      }
+      if (row + 1 < kSize) {
+        builder.AddEdge(id, id + kSize, 10.0).AddEdge(id + kSize, id, 10.0);
+      }
+    }
+  }
+  RoadGraph graph = builder.Build();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+
+  VertexID target = kSize * kSize;
+  SearchTree tree = RunDijkstra(csr, 1, {target});
+  Route route     = RunBidirectionalDijkstra(csr, 1, target);
+
+  EXPECT_EQ(tree.Find(target)->cost(), route.cost);
+  EXPECT_EQ(2 * (kSize - 1), route.edges.size());
+  EXPECT_LT(route.num_settled, tree.size());
+}
+
+}  // namespace open_semap
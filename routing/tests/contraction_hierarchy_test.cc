@@ -0,0 +1,117 @@
+#include "algorithms/contraction_hierarchy.h"
+
+#include <random>
+
+#include "algorithms/contraction.h"
+#include "algorithms/dijkstra.h"
+#include "algorithms/route_testing.h"
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "graph/simple_indexer.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::MakePaperExampleGraph;
+using graph::RoadGraph;
+using graph::SimpleIndexer;
+using graph::Vertex;
+using graph::VertexID;
+
+// Answers all the pairs of vertices with the hierarchy, and compares them with
+// Dijkstra on the original graph.
+void ExpectMatchesDijkstra(const RoadGraph &graph,
+                           const ContractionHierarchy &hierarchy) {
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+  ChQueryWorkspace workspace;
+  for (const Vertex *source : graph.vertices()) {
+    SearchTree expected = RunDijkstra(csr, source->id(), {});
+    for (const Vertex *target : graph.vertices()) {
+      Route route = RunChQuery(hierarchy, source->id(), target->id(), &workspace);
+      if (source == target) {
+        EXPECT_EQ(0u, route.cost);
+        EXPECT_TRUE(route.edges.empty());
+        continue;
+      }
+      const SearchNode *node = expected.Find(target->id());
+      ASSERT_EQ(node != nullptr, route.found())
+          << source->id() << " -> " << target->id();
+      if (node != nullptr) {
+        EXPECT_EQ(node->cost(), route.cost) << source->id() << " -> " << target->id();
+        ExpectConnected(route, source->id(), target->id());
+      }
+    }
+  }
+}
+
+TEST(ContractionHierarchyTest, GivenOrder) {
+  RoadGraph graph       = MakePaperExampleGraph();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractVertices({1, 2, 3, 4, 5, 6}, &indexer);
+  shortcuts.ReleaseEdges();
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+  EXPECT_EQ(6, hierarchy.num_vertices());
+  for (VertexID id = 1; id <= 6; ++id) {
+    EXPECT_EQ(id - 1, hierarchy.rank(hierarchy.FindIndex(id)));
+  }
+  // Every arc goes up the ranks.
+  for (ContractionHierarchy::Index v = 0; v < hierarchy.num_vertices(); ++v) {
+    for (auto arc = hierarchy.out_begin(v); arc < hierarchy.out_end(v); ++arc) {
+      EXPECT_LT(hierarchy.rank(v), hierarchy.rank(hierarchy.out_head(arc)));
+    }
+    for (auto arc = hierarchy.in_begin(v); arc < hierarchy.in_end(v); ++arc) {
+      EXPECT_LT(hierarchy.rank(v), hierarchy.rank(hierarchy.in_head(arc)));
+    }
+  }
+
+  // 6 -> 1 -> 4 -> 3 -> 5, through the shortcuts of 1, 3 and 4.
+  Route route = RunChQuery(hierarchy, 6, 5);
+  EXPECT_EQ(8u, route.cost);
+  ExpectConnected(route, 6, 5);
+
+  ExpectMatchesDijkstra(graph, hierarchy);
+}
+
+TEST(ContractionHierarchyTest, MatchesDijkstraOnRandomGraph) {
+  std::mt19937 rng(23);
+  std::uniform_int_distribution<VertexID> pick(1, 80);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 240; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+  ExpectMatchesDijkstra(graph, hierarchy);
+}
+
+TEST(ContractionHierarchyTest, MatchesDijkstraOnGrid) {
+  RoadGraph graph       = graph::MakeGridGraph(8, 8, 29);
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+  ExpectMatchesDijkstra(graph, hierarchy);
+}
+
+TEST(ContractionHierarchyTest, NotFound) {
+  RoadGraph graph =
+      graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).AddEdge(3, 4, 5.0).Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+  EXPECT_FALSE(RunChQuery(hierarchy, 1, 4).found());
+  EXPECT_FALSE(RunChQuery(hierarchy, 2, 1).found());
+  EXPECT_FALSE(RunChQuery(hierarchy, 1, 9).found());
+  EXPECT_FALSE(RunChQuery(hierarchy, 9, 1).found());
+}
+
+}  // namespace open_semap
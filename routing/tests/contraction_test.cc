@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "graph/builder.h"
@@ -10,20 +12,26 @@
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 
-using ::testing::AllOf;
 using ::testing::ElementsAre;
-using ::testing::Pointee;
-using ::testing::Property;
 using ::testing::UnorderedElementsAre;
 
 namespace open_semap {
 
 using graph::Edge;
+using graph::MakePaperExampleGraph;
 using graph::RoadGraph;
 using graph::RoadGraphBuilder;
 using graph::SimpleIndexer;
 using graph::Vertex;
 
+// The shortcut replaces the path of the two edges, through the vertex between
+// them.
+MATCHER_P2(IsShortcutOf, first, second,
+           std::string(negation ? "isn't" : "is") + " a shortcut of two edges") {
+  return arg.from == first->from().index() && arg.middle == first->to().index() &&
+         arg.to == second->to().index() && arg.weight == first->cost() + second->cost();
+}
+
 TEST(ContractionTest, SingleVertexContraction1) {
   // Trivial graph: v1 ---> v2 ---> v3
   //                    5       7
@@ -35,40 +43,60 @@ TEST(ContractionTest, SingleVertexContraction1) {
   const Edge *edge12 = indexer.FindEdge(1, 2);
   const Edge *edge23 = indexer.FindEdge(2, 3);
 
-  std::vector<std::unique_ptr<Edge>> shortcuts = ContractVertices({2}, &indexer);
+  Shortcuts shortcuts = ContractVertices({2}, &indexer);
 
   // The edges should have been removed already by contraction.
   EXPECT_EQ(nullptr, indexer.FindEdge(1, 2));
   EXPECT_EQ(nullptr, indexer.FindEdge(2, 3));
 
-  EXPECT_THAT(shortcuts, ElementsAre(Pointee(AllOf(Property(&Edge::car, edge12),
-                                                   Property(&Edge::cdr, edge23)))));
+  EXPECT_THAT(shortcuts, ElementsAre(IsShortcutOf(edge12, edge23)));
 }
 
-RoadGraph MakePaperExampleGraph() {
-  // Example comes from: https://algo2.iti.kit.edu/download/presentation.pdf
+TEST(ContractionTest, EqualCostWitness) {
+  // A square of a grid, both ways:
   //
-  //    2     3     2     1     2
-  // 2 --- 6 --- 1 --- 4 --- 3 --- 5
-  return RoadGraphBuilder()
-      .AddEdge(2, 6, 2.0)
-      .AddEdge(6, 2, 2.0)
-      .AddEdge(6, 1, 3.0)
-      .AddEdge(1, 6, 3.0)
-      .AddEdge(1, 4, 2.0)
-      .AddEdge(4, 1, 2.0)
-      .AddEdge(5, 3, 2.0)
-      .AddEdge(3, 5, 2.0)
-      .AddEdge(3, 4, 1.0)
-      .AddEdge(4, 3, 1.0)
-      .Build();
+  //   v1 --- v2
+  //   |       |
+  //   v4 --- v3
+  //
+  // Contracting 2 adds nothing: 1 -> 4 -> 3 costs as much as 1 -> 2 -> 3.
+  RoadGraph graph = RoadGraphBuilder()
+                        .AddEdge(1, 2, 1.0)
+                        .AddEdge(2, 1, 1.0)
+                        .AddEdge(2, 3, 1.0)
+                        .AddEdge(3, 2, 1.0)
+                        .AddEdge(3, 4, 1.0)
+                        .AddEdge(4, 3, 1.0)
+                        .AddEdge(4, 1, 1.0)
+                        .AddEdge(1, 4, 1.0)
+                        .Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+
+  EXPECT_EQ(0, ContractVertices({2}, &indexer).size());
+}
+
+TEST(ContractionTest, NoShortcutBesideLighterEdge) {
+  // v1 ---> v2 ---> v3, and v1 ---> v3 directly at the same cost. Contracting
+  // 2 adds nothing, but does once the direct edge is heavier.
+  RoadGraph graph = RoadGraphBuilder()
+                        .AddEdge(1, 2, 1.0)
+                        .AddEdge(2, 3, 1.0)
+                        .AddEdge(1, 3, 2.0)
+                        .Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  EXPECT_EQ(0, ContractVertices({2}, &indexer).size());
+
+  graph =
+      RoadGraphBuilder().AddEdge(1, 2, 1.0).AddEdge(2, 3, 1.0).AddEdge(1, 3, 3.0).Build();
+  indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  EXPECT_EQ(1, ContractVertices({2}, &indexer).size());
 }
 
 TEST(ContractionTest, PaperExampleMultiStep) {
   RoadGraph graph       = MakePaperExampleGraph();
   SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
 
-  std::vector<std::unique_ptr<Edge>> shortcuts;
+  Shortcuts shortcuts;
 
   {
     // Contract Node 1: Add 6 --> 4 and 4 --> 6
@@ -78,7 +106,7 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     const Edge *edge41 = indexer.FindEdge(4, 1);
     const Edge *edge14 = indexer.FindEdge(1, 4);
 
-    std::vector<std::unique_ptr<Edge>> added = ContractVertices({1}, &indexer);
+    Shortcuts added = ContractVertices({1}, &indexer);
 
     EXPECT_EQ(nullptr, indexer.FindEdge(6, 1));
     EXPECT_EQ(nullptr, indexer.FindEdge(1, 6));
@@ -86,20 +114,15 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     EXPECT_EQ(nullptr, indexer.FindEdge(1, 4));
     EXPECT_EQ(nullptr, indexer.Find(1));
 
-    EXPECT_THAT(
-        added,
-        UnorderedElementsAre(
-            Pointee(AllOf(Property(&Edge::car, edge61), Property(&Edge::cdr, edge14))),
-            Pointee(AllOf(Property(&Edge::car, edge41), Property(&Edge::cdr, edge16)))));
+    EXPECT_THAT(added, UnorderedElementsAre(IsShortcutOf(edge61, edge14),
+                                            IsShortcutOf(edge41, edge16)));
 
-    for (std::unique_ptr<Edge> &edge : added) {
-      shortcuts.emplace_back(std::move(edge));
-    }
+    shortcuts.Append(std::move(added));
   }
 
   {
     // Node 2 does not contract.
-    std::vector<std::unique_ptr<Edge>> added = ContractVertices({2}, &indexer);
+    Shortcuts added = ContractVertices({2}, &indexer);
     EXPECT_EQ(nullptr, indexer.Find(2));
     ASSERT_EQ(0, added.size());
   }
@@ -111,7 +134,7 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     const Edge *edge35 = indexer.FindEdge(3, 5);
     const Edge *edge53 = indexer.FindEdge(5, 3);
 
-    std::vector<std::unique_ptr<Edge>> added = ContractVertices({3}, &indexer);
+    Shortcuts added = ContractVertices({3}, &indexer);
 
     EXPECT_EQ(nullptr, indexer.FindEdge(4, 3));
     EXPECT_EQ(nullptr, indexer.FindEdge(3, 4));
@@ -119,15 +142,10 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     EXPECT_EQ(nullptr, indexer.FindEdge(5, 3));
     EXPECT_EQ(nullptr, indexer.Find(3));
 
-    EXPECT_THAT(
-        added,
-        UnorderedElementsAre(
-            Pointee(AllOf(Property(&Edge::car, edge43), Property(&Edge::cdr, edge35))),
-            Pointee(AllOf(Property(&Edge::car, edge53), Property(&Edge::cdr, edge34)))));
+    EXPECT_THAT(added, UnorderedElementsAre(IsShortcutOf(edge43, edge35),
+                                            IsShortcutOf(edge53, edge34)));
 
-    for (std::unique_ptr<Edge> &edge : added) {
-      shortcuts.emplace_back(std::move(edge));
-    }
+    shortcuts.Append(std::move(added));
   }
 
   {
@@ -137,7 +155,7 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     const Edge *edge54 = indexer.FindEdge(5, 4);
     const Edge *edge46 = indexer.FindEdge(4, 6);
 
-    std::vector<std::unique_ptr<Edge>> added = ContractVertices({4}, &indexer);
+    Shortcuts added = ContractVertices({4}, &indexer);
 
     EXPECT_EQ(nullptr, indexer.FindEdge(6, 4));
     EXPECT_EQ(nullptr, indexer.FindEdge(4, 5));
@@ -145,20 +163,15 @@ TEST(ContractionTest, PaperExampleMultiStep) {
     EXPECT_EQ(nullptr, indexer.FindEdge(4, 6));
     EXPECT_EQ(nullptr, indexer.Find(4));
 
-    EXPECT_THAT(
-        added,
-        UnorderedElementsAre(
-            Pointee(AllOf(Property(&Edge::car, edge64), Property(&Edge::cdr, edge45))),
-            Pointee(AllOf(Property(&Edge::car, edge54), Property(&Edge::cdr, edge46)))));
+    EXPECT_THAT(added, UnorderedElementsAre(IsShortcutOf(edge64, edge45),
+                                            IsShortcutOf(edge54, edge46)));
 
-    for (std::unique_ptr<Edge> &edge : added) {
-      shortcuts.emplace_back(std::move(edge));
-    }
+    shortcuts.Append(std::move(added));
   }
 
   {
     // Node 5 does not contract.
-    std::vector<std::unique_ptr<Edge>> added = ContractVertices({5}, &indexer);
+    Shortcuts added = ContractVertices({5}, &indexer);
     EXPECT_EQ(nullptr, indexer.Find(5));
     ASSERT_EQ(0, added.size());
   }
@@ -168,10 +181,23 @@ TEST(ContractionTest, PaperExampleOneBatch) {
   RoadGraph graph       = MakePaperExampleGraph();
   SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
 
-  std::vector<std::unique_ptr<Edge>> shortcuts =
-      ContractVertices({1, 2, 3, 4, 5}, &indexer);
+  Shortcuts shortcuts = ContractVertices({1, 2, 3, 4, 5}, &indexer);
 
   EXPECT_EQ(6, shortcuts.size());
+  std::vector<graph::VertexID> order;
+  for (graph::VertexIndex index : shortcuts.contraction_order()) {
+    order.emplace_back(graph.numbering().id(index));
+  }
+  EXPECT_THAT(order, ElementsAre(1, 2, 3, 4, 5));
+
+  // The records outlive the edges that stood for the shortcuts in the indexer.
+  Shortcut first = shortcuts[0];
+  shortcuts.ReleaseEdges();
+  ASSERT_EQ(6, shortcuts.size());
+  EXPECT_EQ(first.from, shortcuts[0].from);
+  EXPECT_EQ(first.middle, shortcuts[0].middle);
+  EXPECT_EQ(first.to, shortcuts[0].to);
+  EXPECT_EQ(first.weight, shortcuts[0].weight);
 }
 
 RoadGraph MakeKightsGrid() {
@@ -216,7 +242,8 @@ TEST(ContractionTest, ContractGraph1) {
   RoadGraph graph       = MakeKightsGrid();
   SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
 
-  std::vector<std::unique_ptr<graph::Edge>> shortcuts = ContractGraph(&indexer);
+  Shortcuts shortcuts = ContractGraph(&indexer);
+  EXPECT_EQ(graph.vertices().size(), shortcuts.contraction_order().size());
 
   // In this particular case, because of D (VertexID = 4), no
   // shortcuts needs to be added.
@@ -227,9 +254,12 @@ TEST(ContractionTest, ContractGraph2) {
   RoadGraph graph       = MakePaperExampleGraph();
   SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
 
-  std::vector<std::unique_ptr<graph::Edge>> shortcuts = ContractGraph(&indexer);
+  Shortcuts shortcuts = ContractGraph(&indexer);
+  EXPECT_EQ(graph.vertices().size(), shortcuts.contraction_order().size());
 
-  EXPECT_EQ(2, shortcuts.size());
+  // The ties of the edge difference are broken by the vertex index, so the
+  // order is always 3, 1, 2, 5, 6, 4, which needs 4 shortcuts.
+  EXPECT_EQ(4, shortcuts.size());
 }
 
 }  // namespace open_semap
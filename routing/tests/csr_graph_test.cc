@@ -0,0 +1,70 @@
+#include "graph/csr_graph.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+namespace open_semap {
+namespace testing {
+
+using graph::CsrGraph;
+
+std::vector<graph::VertexID> OutNeighbors(const CsrGraph &csr, graph::VertexID id) {
+  std::vector<graph::VertexID> result;
+  CsrGraph::Index v = csr.FindIndex(id);
+  for (CsrGraph::Index arc = csr.out_begin(v); arc < csr.out_end(v); ++arc) {
+    result.emplace_back(csr.vertex(csr.out_head(arc)).id());
+  }
+  return result;
+}
+
+std::vector<graph::VertexID> InNeighbors(const CsrGraph &csr, graph::VertexID id) {
+  std::vector<graph::VertexID> result;
+  CsrGraph::Index v = csr.FindIndex(id);
+  for (CsrGraph::Index arc = csr.in_begin(v); arc < csr.in_end(v); ++arc) {
+    result.emplace_back(csr.vertex(csr.in_tail(arc)).id());
+  }
+  return result;
+}
+
+TEST(CsrGraphTest, CreateFromRawGraph) {
+  graph::RoadGraph graph = graph::RoadGraphBuilder()
+                               .AddEdge(1, 2, 15.0)
+                               .AddEdge(1, 3, 10.0)
+                               .AddEdge(1, 4, 4.0)
+                               .AddEdge(3, 1, 10.0)
+                               .AddEdge(2, 3, 7.0)
+                               .AddEdge(2, 4, 7.0)
+                               .AddEdge(4, 3, 3.0)
+                               .Build();
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+
+  EXPECT_EQ(4, csr.num_vertices());
+  EXPECT_EQ(7, csr.num_edges());
+  EXPECT_EQ(CsrGraph::kInvalidIndex, csr.FindIndex(5));
+
+  // The arcs of a vertex keep the order of the edges in the graph.
+  EXPECT_THAT(OutNeighbors(csr, 1), ElementsAre(2, 3, 4));
+  EXPECT_THAT(OutNeighbors(csr, 2), ElementsAre(3, 4));
+  EXPECT_THAT(OutNeighbors(csr, 3), ElementsAre(1));
+  EXPECT_THAT(OutNeighbors(csr, 4), ElementsAre(3));
+
+  EXPECT_THAT(InNeighbors(csr, 1), ElementsAre(3));
+  EXPECT_THAT(InNeighbors(csr, 3), UnorderedElementsAre(1, 2, 4));
+  EXPECT_THAT(InNeighbors(csr, 4), UnorderedElementsAre(1, 2));
+
+  CsrGraph::Index v   = csr.FindIndex(4);
+  CsrGraph::Index arc = csr.out_begin(v);
+  EXPECT_DOUBLE_EQ(3.0, csr.out_weight(arc));
+  EXPECT_EQ(4, csr.out_edge(arc).from().id());
+  EXPECT_EQ(3, csr.out_edge(arc).to().id());
+  EXPECT_EQ(7, csr.out_edge(arc).id());
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -2,21 +2,25 @@
 
 #include <algorithm>
 #include <memory>
+#include <random>
+#include <unordered_set>
 
 #include "gmock/gmock.h"
 #include "graph/builder.h"
+#include "graph/csr_graph.h"
 #include "graph/road_graph.h"
 #include "graph/simple_indexer.h"
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 
 using ::testing::AllOf;
-using ::testing::DoubleEq;
+using ::testing::Eq;
 using ::testing::PrintToString;
 using ::testing::Property;
 
 namespace open_semap {
 
+using graph::CsrGraph;
 using graph::Edge;
 using graph::EdgeID;
 using graph::RoadGraph;
@@ -44,14 +48,54 @@ TEST(DijkstraTest, TrivialGraph1) {
   EXPECT_EQ(nullptr, n1);
 
   const SearchNode *n2 = search_tree.Find(2);
-  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, DoubleEq(5.0)),
+  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, Eq(5u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 2))));
 
   const SearchNode *n3 = search_tree.Find(3);
-  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, DoubleEq(12.0)),
+  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, Eq(12u)),
                          Property(&SearchNode::edge, IsAnEdge(2, 3))));
 }
 
+TEST(DijkstraTest, Limit) {
+  RoadGraph graph       = CreateTrivialGraph();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  DijkstraWorkspace workspace;
+
+  // The search stops at 2, the first vertex past the limit.
+  const SearchTree &tree = RunDijkstra(indexer, 1, {3}, &workspace, 4);
+  ASSERT_NE(nullptr, tree.Find(2));
+  EXPECT_EQ(5u, tree.Find(2)->cost());
+  EXPECT_EQ(nullptr, tree.Find(3));
+
+  // A goal exactly at the limit is still settled.
+  EXPECT_NE(nullptr, RunDijkstra(indexer, 1, {3}, &workspace, 12).Find(3));
+}
+
+TEST(DijkstraTest, MarkedGoals) {
+  RoadGraph graph       = CreateTrivialGraph();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  const graph::VertexNumbering &numbering = *indexer.numbering();
+  DijkstraWorkspace workspace;
+
+  workspace.ClearGoals(numbering.size());
+  workspace.AddGoal(numbering.Find(2));
+  workspace.AddGoal(numbering.Find(2));
+  EXPECT_EQ(1u, workspace.num_goals());
+
+  // The search stops at 2, before 3.
+  const SearchTree &tree = RunDijkstraToMarkedGoals(indexer, 1, &workspace);
+  EXPECT_NE(nullptr, tree.Find(2));
+  EXPECT_EQ(nullptr, tree.Find(3));
+
+  // The marked start is not waited for, so the search goes on to 3.
+  workspace.ClearGoals(numbering.size());
+  workspace.AddGoal(numbering.Find(1));
+  workspace.AddGoal(numbering.Find(3));
+  EXPECT_EQ(2u, workspace.num_goals());
+  ASSERT_NE(nullptr, RunDijkstraToMarkedGoals(indexer, 1, &workspace).Find(3));
+  EXPECT_EQ(12u, RunDijkstraToMarkedGoals(indexer, 1, &workspace).Find(3)->cost());
+}
+
 RoadGraph CreateSampleGraph() {
   return graph::RoadGraphBuilder()
       .AddEdge(1, 2, 15.0)
@@ -75,17 +119,17 @@ TEST(DijkstraTest, SimpleGraphCase1) {
 
   const SearchNode *n2 = search_tree.Find(2);
   EXPECT_NE(nullptr, n2);
-  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, DoubleEq(15.0)),
+  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, Eq(15u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 2))));
 
   const SearchNode *n3 = search_tree.Find(3);
   EXPECT_NE(nullptr, n3);
-  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, DoubleEq(7.0)),
+  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, Eq(7u)),
                          Property(&SearchNode::edge, IsAnEdge(4, 3))));
 
   const SearchNode *n4 = search_tree.Find(4);
   EXPECT_NE(nullptr, n4);
-  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, DoubleEq(4.0)),
+  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, Eq(4u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 4))));
 }
 
@@ -102,17 +146,17 @@ TEST(DijkstraTest, SimpleGraphCase2Partial) {
 
   const SearchNode *n2 = search_tree.Find(2);
   EXPECT_NE(nullptr, n2);
-  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, DoubleEq(15.0)),
+  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, Eq(15u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 2))));
 
   const SearchNode *n3 = search_tree.Find(3);
   EXPECT_NE(nullptr, n3);
-  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, DoubleEq(7.0)),
+  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, Eq(7u)),
                          Property(&SearchNode::edge, IsAnEdge(4, 3))));
 
   const SearchNode *n4 = search_tree.Find(4);
   EXPECT_NE(nullptr, n4);
-  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, DoubleEq(4.0)),
+  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, Eq(4u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 4))));
 }
 
@@ -135,8 +179,157 @@ TEST(DijkstraTest, SimpleGraphCase2EarlyStop) {
 
   const SearchNode *n4 = search_tree.Find(4);
   EXPECT_NE(nullptr, n4);
-  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, DoubleEq(4.0)),
+  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, Eq(4u)),
+                         Property(&SearchNode::edge, IsAnEdge(1, 4))));
+}
+
+TEST(DijkstraTest, CsrGraphCase1) {
+  RoadGraph graph = CreateSampleGraph();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+
+  SearchTree search_tree = RunDijkstra(csr, 1, {2, 3, 4});
+
+  EXPECT_EQ(nullptr, search_tree.Find(1));
+
+  const SearchNode *n2 = search_tree.Find(2);
+  EXPECT_NE(nullptr, n2);
+  EXPECT_THAT(*n2, AllOf(Property(&SearchNode::cost, Eq(15u)),
+                         Property(&SearchNode::edge, IsAnEdge(1, 2))));
+
+  const SearchNode *n3 = search_tree.Find(3);
+  EXPECT_NE(nullptr, n3);
+  EXPECT_THAT(*n3, AllOf(Property(&SearchNode::cost, Eq(7u)),
+                         Property(&SearchNode::edge, IsAnEdge(4, 3))));
+
+  const SearchNode *n4 = search_tree.Find(4);
+  EXPECT_NE(nullptr, n4);
+  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, Eq(4u)),
                          Property(&SearchNode::edge, IsAnEdge(1, 4))));
 }
 
+TEST(DijkstraTest, CsrGraphEarlyStop) {
+  RoadGraph graph = CreateSampleGraph();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+
+  SearchTree search_tree = RunDijkstra(csr, 1, {4});
+
+  EXPECT_EQ(nullptr, search_tree.Find(2));
+  EXPECT_EQ(nullptr, search_tree.Find(3));
+  const SearchNode *n4 = search_tree.Find(4);
+  EXPECT_NE(nullptr, n4);
+  EXPECT_THAT(*n4, AllOf(Property(&SearchNode::cost, Eq(4u)),
+                         Property(&SearchNode::edge, IsAnEdge(1, 4))));
+}
+
+TEST(DijkstraTest, CsrGraphMatchesSimpleIndexer) {
+  // A random sparse graph with integer lengths, so that the costs compare
+  // exactly.
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<VertexID> pick(1, 200);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 800; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+
+  for (const Vertex *start : graph.vertices()) {
+    SearchTree expected = RunDijkstra(indexer, start->id(), {});
+    SearchTree actual   = RunDijkstra(csr, start->id(), {});
+    for (const Vertex *vertex : graph.vertices()) {
+      const SearchNode *a = expected.Find(vertex->id());
+      const SearchNode *b = actual.Find(vertex->id());
+      ASSERT_EQ(a == nullptr, b == nullptr);
+      if (a != nullptr) {
+        EXPECT_EQ(a->cost(), b->cost());
+      }
+    }
+  }
+}
+
+TEST(DijkstraTest, WorkspaceMatchesFreshSearches) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<VertexID> pick(1, 100);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 400; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+
+  // The same workspace is used for all the searches, on both indices, with and
+  // without goals, so that a leftover of a previous search would show.
+  DijkstraWorkspace workspace;
+  for (const Vertex *start : graph.vertices()) {
+    VertexID goal = graph.vertices()[pick(rng) % graph.vertices().size()]->id();
+    for (bool with_goal : {false, true}) {
+      std::unordered_set<VertexID> goals;
+      if (with_goal) {
+        goals.emplace(goal);
+      }
+      SearchTree expected = RunDijkstra(indexer, start->id(), goals);
+      const SearchTree &indexer_tree =
+          RunDijkstra(indexer, start->id(), goals, &workspace);
+      for (const Vertex *vertex : graph.vertices()) {
+        const SearchNode *a = expected.Find(vertex->id());
+        const SearchNode *b = indexer_tree.Find(vertex->id());
+        ASSERT_EQ(a == nullptr, b == nullptr);
+        if (a != nullptr) {
+          EXPECT_EQ(a->cost(), b->cost());
+        }
+      }
+
+      expected                   = RunDijkstra(csr, start->id(), goals);
+      const SearchTree &csr_tree = RunDijkstra(csr, start->id(), goals, &workspace);
+      for (const Vertex *vertex : graph.vertices()) {
+        const SearchNode *a = expected.Find(vertex->id());
+        const SearchNode *b = csr_tree.Find(vertex->id());
+        ASSERT_EQ(a == nullptr, b == nullptr);
+        if (a != nullptr) {
+          EXPECT_EQ(a->cost(), b->cost());
+        }
+      }
+    }
+  }
+}
+
+TEST(DijkstraTest, PriorityQueuesAgree) {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<VertexID> pick(1, 150);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 600; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  CsrGraph csr          = CsrGraph::CreateFromRawGraph(graph);
+
+  DijkstraWorkspace lazy(PriorityQueueType::kLazyBinaryHeap);
+  for (PriorityQueueType type :
+       {PriorityQueueType::kIndexedFourAryHeap, PriorityQueueType::kRadixHeap}) {
+    DijkstraWorkspace workspace(type);
+    for (const Vertex *start : graph.vertices()) {
+      const SearchTree &expected = RunDijkstra(indexer, start->id(), {}, &lazy);
+      const SearchTree &actual   = RunDijkstra(csr, start->id(), {}, &workspace);
+      for (const Vertex *vertex : graph.vertices()) {
+        const SearchNode *a = expected.Find(vertex->id());
+        const SearchNode *b = actual.Find(vertex->id());
+        ASSERT_EQ(a == nullptr, b == nullptr) << PriorityQueueName(type);
+        if (a != nullptr) {
+          EXPECT_EQ(a->cost(), b->cost()) << PriorityQueueName(type);
+        }
+      }
+    }
+    // The indexed heap lowers the keys instead of pushing duplicates.
+    if (type == PriorityQueueType::kIndexedFourAryHeap) {
+      EXPECT_EQ(0, workspace.queue_stats().pushes - workspace.queue_stats().pops);
+    }
+  }
+}
+
 }  // namespace open_semap
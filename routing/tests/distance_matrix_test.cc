@@ -0,0 +1,108 @@
+#include "algorithms/distance_matrix.h"
+
+#include <random>
+#include <vector>
+
+#include "algorithms/contraction.h"
+#include "algorithms/contraction_hierarchy.h"
+#include "algorithms/dijkstra.h"
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "graph/simple_indexer.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::RoadGraph;
+using graph::SimpleIndexer;
+using graph::Vertex;
+using graph::VertexID;
+
+// Checks the matrix against one Dijkstra per source.
+void ExpectMatchesDijkstra(const RoadGraph &graph, const std::vector<VertexID> &sources,
+                           const std::vector<VertexID> &targets,
+                           const DistanceMatrix &matrix) {
+  CsrGraph csr = CsrGraph::CreateFromRawGraph(graph);
+  ASSERT_EQ(sources.size(), matrix.num_sources);
+  ASSERT_EQ(targets.size(), matrix.num_targets);
+  ASSERT_EQ(sources.size() * targets.size(), matrix.costs.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    SearchTree expected = RunDijkstra(csr, sources[i], {});
+    for (size_t j = 0; j < targets.size(); ++j) {
+      if (sources[i] == targets[j]) {
+        EXPECT_EQ(0u, matrix.at(i, j));
+        continue;
+      }
+      const SearchNode *node = expected.Find(targets[j]);
+      EXPECT_EQ(node == nullptr ? graph::kInfiniteWeight : node->cost(), matrix.at(i, j))
+          << sources[i] << " -> " << targets[j];
+    }
+  }
+}
+
+TEST(DistanceMatrixTest, MatchesDijkstra) {
+  std::mt19937 rng(31);
+  std::uniform_int_distribution<VertexID> pick(1, 80);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 240; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph       = builder.Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+
+  // All the vertices both ways, and a rectangular matrix with a repeated
+  // target.
+  std::vector<VertexID> all;
+  for (const Vertex *vertex : graph.vertices()) {
+    all.emplace_back(vertex->id());
+  }
+  ExpectMatchesDijkstra(graph, all, all, ComputeDistanceMatrix(hierarchy, all, all));
+
+  std::vector<VertexID> sources = {all[3], all[5], all[7]};
+  std::vector<VertexID> targets = {all[1], all[2], all[1], all[9], all[3]};
+  ExpectMatchesDijkstra(graph, sources, targets,
+                        ComputeDistanceMatrix(hierarchy, sources, targets));
+}
+
+TEST(DistanceMatrixTest, ThreadsAgree) {
+  RoadGraph graph       = graph::MakeGridGraph(10, 10, 37);
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+
+  std::vector<VertexID> all;
+  for (const Vertex *vertex : graph.vertices()) {
+    all.emplace_back(vertex->id());
+  }
+  DistanceMatrix single = ComputeDistanceMatrix(hierarchy, all, all, 1);
+  ExpectMatchesDijkstra(graph, all, all, single);
+  DistanceMatrix multi = ComputeDistanceMatrix(hierarchy, all, all, 4);
+  EXPECT_EQ(single.costs, multi.costs);
+}
+
+TEST(DistanceMatrixTest, UnknownVertices) {
+  RoadGraph graph =
+      graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).AddEdge(2, 3, 7.0).Build();
+  SimpleIndexer indexer = SimpleIndexer::CreateFromRawGraph(graph);
+  Shortcuts shortcuts   = ContractGraph(&indexer);
+
+  ContractionHierarchy hierarchy = ContractionHierarchy::Create(graph, shortcuts);
+  DistanceMatrix matrix          = ComputeDistanceMatrix(hierarchy, {1, 9}, {3, 9, 2});
+
+  EXPECT_THAT(matrix.costs,
+              ::testing::ElementsAre(12u, graph::kInfiniteWeight, 5u,
+                                     graph::kInfiniteWeight, graph::kInfiniteWeight,
+                                     graph::kInfiniteWeight));
+
+  EXPECT_TRUE(ComputeDistanceMatrix(hierarchy, {}, {1, 2}).costs.empty());
+}
+
+}  // namespace open_semap
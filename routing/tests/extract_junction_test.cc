@@ -0,0 +1,105 @@
+#include "utils/extract_junction.h"
+
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tests/testdata.h"
+#include "utils/extract_testing.h"
+#include "utils/metrics.h"
+
+namespace open_semap {
+namespace testing {
+
+TEST(ExtractJunctionTest, ParallelMatchesSerial) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells.osm";
+
+  IdSet serial = ExtractJunction(path, 1);
+  EXPECT_FALSE(serial.empty());
+
+  for (int num_threads : {2, 4, 8}) {
+    IdSet parallel = ExtractJunction(path, num_threads);
+    EXPECT_EQ(serial.size(), parallel.size());
+    EXPECT_EQ(CollectIds(serial), CollectIds(parallel));
+  }
+}
+
+TEST(ExtractJunctionTest, ParallelRoadNodesMatchSerial) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells.osm";
+
+  IdSet serial_junctions;
+  IdSet serial_road_nodes;
+  std::tie(serial_junctions, serial_road_nodes) = ExtractJunctionAndRoadNodes(path, 1);
+
+  IdSet parallel_junctions;
+  IdSet parallel_road_nodes;
+  std::tie(parallel_junctions, parallel_road_nodes) =
+      ExtractJunctionAndRoadNodes(path, 4);
+
+  EXPECT_EQ(CollectIds(serial_junctions), CollectIds(parallel_junctions));
+  EXPECT_EQ(CollectIds(serial_road_nodes), CollectIds(parallel_road_nodes));
+}
+
+// The metrics of the last "extract_junction_external" stage.
+StageMetrics LastExternalStage() {
+  StageMetrics result;
+  for (StageMetrics &stage : MetricsRegistry::Global().Stages()) {
+    if (stage.name == "extract_junction_external") {
+      result = std::move(stage);
+    }
+  }
+  return result;
+}
+
+TEST(ExtractJunctionTest, ExternalMatchesInMemory) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells.osm";
+
+  IdSet expected = ExtractJunction(path, 1);
+
+  ExternalMemoryOptions options;
+  options.tmp_dir       = ::testing::TempDir();
+  options.memory_budget = size_t{16} << 10;
+  // The 197 road refs of the map fit in one run of the smallest size a budget
+  // gives, so the run size is forced down to spill through the merge. 1 puts
+  // every ref in its own run, and 2 lets the runs keep a duplicate.
+  for (size_t run_size : {1, 2, 16, 64}) {
+    MetricsRegistry::Global().Clear();
+    options.run_size = run_size;
+    IdSet external   = ExtractJunctionExternal(path, options);
+    EXPECT_EQ(CollectIds(expected), CollectIds(external)) << "run size " << run_size;
+
+    StageMetrics stage = LastExternalStage();
+    EXPECT_EQ(run_size, stage.sizes["run_size"]);
+    EXPECT_GE(stage.sizes["runs"], 197u / run_size) << "run size " << run_size;
+    EXPECT_GT(stage.sizes["run_bytes"], 0u);
+    ASSERT_GT(stage.peak_rss_bytes, 0u);
+    RecordProperty("peak_rss_bytes_run_size_" + std::to_string(run_size),
+                   std::to_string(stage.peak_rss_bytes));
+  }
+
+  // Large enough to fit in memory, without any run.
+  MetricsRegistry::Global().Clear();
+  options.memory_budget = size_t{64} << 20;
+  options.run_size      = 0;
+  EXPECT_EQ(CollectIds(expected), CollectIds(ExtractJunctionExternal(path, options)));
+  EXPECT_EQ(0, LastExternalStage().sizes.count("runs"));
+  MetricsRegistry::Global().Clear();
+}
+
+TEST(ExtractJunctionDeathTest, ExternalAbortsWithoutTmpDir) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells.osm";
+
+  ExternalMemoryOptions options;
+  options.tmp_dir = ::testing::TempDir() + "/does_not_exist";
+  // Small enough to spill before the end of the input.
+  options.memory_budget = size_t{16} << 10;
+  options.run_size      = 16;
+  // The message goes to the spdlog default sink, which is stdout.
+  EXPECT_DEATH(ExtractJunctionExternal(path, options), "");
+}
+
+}  // namespace testing
+}  // namespace open_semap
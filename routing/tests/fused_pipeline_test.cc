@@ -0,0 +1,64 @@
+#include "utils/fused_pipeline.h"
+
+#include <string>
+#include <tuple>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "osmium/osm/box.hpp"
+#include "tests/testdata.h"
+#include "utils/extract_junction.h"
+#include "utils/extract_testing.h"
+#include "utils/filter_bounding_box.h"
+#include "utils/filter_isolated_roads.h"
+#include "utils/split_road.h"
+
+namespace open_semap {
+namespace testing {
+
+// Runs the four passes one after another, as extract_routes does without
+// --fused.
+void ExtractRoutesFourPasses(const std::string &path, const std::string &output_path,
+                             const osmium::Box &box) {
+  IdSet junctions = FilterBoundingBox(path, ExtractJunction(path), box);
+  IdSet roads;
+  IdSet useful_nodes;
+  std::tie(roads, useful_nodes) = FilterIsolatedRoads(path, junctions);
+  SplitRoad(path, output_path, junctions, roads, useful_nodes);
+}
+
+// Expects the fused pipeline, with 1 and 4 threads, to write the same bytes as
+// the four passes.
+void ExpectSameOutput(const std::string &name, const osmium::Box &box) {
+  const std::string path       = std::string(TEST_DATA_PATH) + "/" + name + ".osm";
+  const std::string four_path  = ::testing::TempDir() + "/four_passes.osm";
+  const std::string fused_path = ::testing::TempDir() + "/fused.osm";
+
+  ExtractRoutesFourPasses(path, four_path, box);
+  std::string expected = ReadWholeFile(four_path);
+  EXPECT_FALSE(expected.empty());
+  // The split roads carry their lengths, so the node locations were found.
+  EXPECT_NE(std::string::npos, expected.find("\"length\""));
+  for (int num_threads : {1, 4}) {
+    ExtractRoutesFused(path, fused_path, box, num_threads);
+    EXPECT_EQ(expected, ReadWholeFile(fused_path)) << num_threads << " threads";
+  }
+}
+
+TEST(FusedPipelineTest, SameOutputAsFourPasses) {
+  ExpectSameOutput("adobe_wells", osmium::Box(-180.0, -90.0, 180.0, 90.0));
+}
+
+TEST(FusedPipelineTest, SameOutputAsFourPassesInBoundingBox) {
+  // Cuts adobe_wells in half.
+  ExpectSameOutput("adobe_wells", osmium::Box(-121.9953, 37.3999, -121.9912, 37.4032));
+}
+
+TEST(FusedPipelineTest, SameOutputAsFourPassesOnUnsortedIds) {
+  // The node IDs are not ascending, and the file is small enough for the
+  // nodes and the ways to be decoded into the same buffer.
+  ExpectSameOutput("unsorted_ids", osmium::Box(-180.0, -90.0, 180.0, 90.0));
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -0,0 +1,65 @@
+#include "graph/geometry_store.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+graph::PointSpan Span(const std::vector<osmium::Location> &points) {
+  return graph::PointSpan(points.data(), points.data() + points.size());
+}
+
+TEST(GeometryStoreTest, AddAndGet) {
+  graph::GeometryStore store;
+  std::vector<osmium::Location> first{osmium::Location(1.0, 2.0),
+                                      osmium::Location(1.5, 2.5)};
+  std::vector<osmium::Location> second{osmium::Location(3.0, 4.0),
+                                       osmium::Location(3.5, 4.5),
+                                       osmium::Location(4.0, 5.0)};
+
+  graph::GeometryIndex a = store.Add(Span(first));
+  graph::GeometryIndex b = store.Add(Span(second));
+  graph::GeometryIndex c = store.Add(graph::PointSpan());
+
+  EXPECT_EQ(3, store.size());
+  EXPECT_EQ(5, store.num_points());
+  EXPECT_EQ(first, store.Get(a).ToVector());
+  EXPECT_EQ(second, store.Get(b).ToVector());
+  EXPECT_TRUE(store.Get(c).empty());
+  EXPECT_TRUE(store.Get(graph::kNoGeometry).empty());
+  EXPECT_EQ(osmium::Location(3.5, 4.5), store.Get(b)[1]);
+
+  store.Clear();
+  EXPECT_EQ(0, store.size());
+  EXPECT_EQ(0, store.num_points());
+}
+
+TEST(GeometryStoreTest, Release) {
+  graph::GeometryStore store;
+  std::vector<osmium::Location> first{osmium::Location(1.0, 2.0),
+                                      osmium::Location(1.5, 2.5)};
+  std::vector<osmium::Location> second{osmium::Location(3.0, 4.0),
+                                       osmium::Location(3.5, 4.5),
+                                       osmium::Location(4.0, 5.0)};
+
+  graph::GeometryIndex a = store.Add(Span(first));
+  graph::GeometryIndex b = store.Add(Span(second));
+  store.Release(a);
+  store.Release(graph::kNoGeometry);
+
+  // The released range stays in place until the store is rebuilt.
+  EXPECT_EQ(1, store.num_released());
+  EXPECT_EQ(2, store.num_released_points());
+  EXPECT_EQ(5, store.num_points());
+  EXPECT_EQ(second, store.Get(b).ToVector());
+
+  store.Clear();
+  EXPECT_EQ(0, store.num_released());
+  EXPECT_EQ(0, store.num_released_points());
+}
+
+}  // namespace testing
+}  // namespace open_semap
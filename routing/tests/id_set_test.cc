@@ -0,0 +1,81 @@
+#include "utils/id_set.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "utils/extract_testing.h"
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+namespace open_semap {
+namespace testing {
+
+TEST(IdSetTest, InsertAndCount) {
+  for (IdSetBackend backend :
+       {IdSetBackend::kAuto, IdSetBackend::kDense, IdSetBackend::kSparse}) {
+    IdSet set(backend);
+    EXPECT_TRUE(set.empty());
+    EXPECT_TRUE(set.insert(5));
+    EXPECT_TRUE(set.insert(70000));
+    EXPECT_TRUE(set.insert(3));
+    EXPECT_FALSE(set.insert(5));
+    EXPECT_TRUE(set.insert(-12));
+
+    EXPECT_EQ(4, set.size());
+    EXPECT_EQ(1, set.count(3));
+    EXPECT_EQ(1, set.count(5));
+    EXPECT_EQ(1, set.count(70000));
+    EXPECT_EQ(1, set.count(-12));
+    EXPECT_EQ(0, set.count(4));
+    EXPECT_EQ(0, set.count(-11));
+    EXPECT_EQ(0, set.count(1000000000000));
+
+    std::vector<osmium::object_id_type> ids = CollectIds(set);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_THAT(ids, ElementsAre(-12, 3, 5, 70000));
+  }
+}
+
+TEST(IdSetTest, SparseChunkBecomesBitmap) {
+  IdSet set(IdSetBackend::kSparse);
+  std::set<osmium::object_id_type> expected;
+  // Insert in descending order so that the sorted array path is exercised.
+  for (osmium::object_id_type id = 20000; id > 0; id -= 3) {
+    set.insert(id);
+    expected.insert(id);
+  }
+  EXPECT_EQ(expected.size(), set.size());
+  EXPECT_FALSE(set.IsDense());
+  EXPECT_THAT(CollectIds(set), ElementsAreArray(expected));
+  EXPECT_EQ(0, set.count(20001));
+  EXPECT_EQ(1, set.count(19997));
+}
+
+TEST(IdSetTest, AutoSwitchesToDense) {
+  IdSet dense_ids;
+  IdSet sparse_ids;
+  std::mt19937_64 generator(42);
+  for (int i = 0; i < 200000; ++i) {
+    // Dense: half of the IDs in [0, 400000) are present.
+    dense_ids.insert(generator() % 400000);
+    // Sparse: 200000 IDs spread over a range of 10^12.
+    sparse_ids.insert(generator() % 1000000000000);
+  }
+  EXPECT_TRUE(dense_ids.IsDense());
+  EXPECT_FALSE(sparse_ids.IsDense());
+
+  // Switching backend should not lose anything.
+  std::mt19937_64 replay(42);
+  for (int i = 0; i < 200000; ++i) {
+    EXPECT_EQ(1, dense_ids.count(replay() % 400000));
+    EXPECT_EQ(1, sparse_ids.count(replay() % 1000000000000));
+  }
+}
+
+}  // namespace testing
+}  // namespace open_semap
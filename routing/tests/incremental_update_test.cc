@@ -0,0 +1,202 @@
+#include "utils/incremental_update.h"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tests/testdata.h"
+#include "utils/extract_junction.h"
+#include "utils/filter_bounding_box.h"
+#include "utils/filter_isolated_roads.h"
+#include "utils/split_road.h"
+
+namespace open_semap {
+namespace testing {
+
+using ::testing::ElementsAre;
+
+std::vector<osmium::object_id_type> SortedVertexIds(const graph::RoadGraph &graph) {
+  std::vector<osmium::object_id_type> result;
+  for (const auto &vertex : graph.vertices()) {
+    result.emplace_back(vertex->id());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// (edge id, from, to, length in cm) of all the edges, sorted.
+std::vector<std::tuple<graph::EdgeID, graph::VertexID, graph::VertexID, long>>
+SortedEdges(const graph::RoadGraph &graph) {
+  std::vector<std::tuple<graph::EdgeID, graph::VertexID, graph::VertexID, long>> result;
+  for (const auto &edge : graph.edges()) {
+    result.emplace_back(edge->id(), edge->from().id(), edge->to().id(),
+                        static_cast<long>(edge->length_ * 100.0 + 0.5));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Runs the steps of extract_routes on the map and loads the routing graph file,
+// so that the vertex and edge IDs are the ones a server would load.
+graph::RoadGraph ExtractRoutes(const std::string &path, const osmium::Box &box,
+                               const std::string &output_name) {
+  IdSet junctions = FilterBoundingBox(path, ExtractJunction(path), box);
+  IdSet roads;
+  IdSet useful_nodes;
+  std::tie(roads, useful_nodes) = FilterIsolatedRoads(path, junctions);
+  const std::string output_path = ::testing::TempDir() + "/" + output_name;
+  SplitRoad(path, output_path, junctions, roads, useful_nodes);
+  return graph::RoadGraph::LoadFromFile(output_path);
+}
+
+// Same vertices, and same edges by ID, ends, length and points. The lengths in
+// the file are rounded to the millimeter.
+void ExpectSameRoutes(const graph::RoadGraph &expected, const graph::RoadGraph &actual) {
+  EXPECT_EQ(SortedVertexIds(expected), SortedVertexIds(actual));
+  ASSERT_EQ(expected.edges().size(), actual.edges().size());
+  auto by_id = [](const graph::Edge *a, const graph::Edge *b) {
+    return a->id() < b->id();
+  };
+  std::vector<const graph::Edge *> expected_edges(expected.edges().begin(),
+                                                  expected.edges().end());
+  std::vector<const graph::Edge *> actual_edges(actual.edges().begin(),
+                                                actual.edges().end());
+  std::sort(expected_edges.begin(), expected_edges.end(), by_id);
+  std::sort(actual_edges.begin(), actual_edges.end(), by_id);
+  for (size_t i = 0; i < expected_edges.size(); ++i) {
+    const graph::Edge &a = *expected_edges[i];
+    const graph::Edge &b = *actual_edges[i];
+    EXPECT_EQ(a.id(), b.id());
+    EXPECT_EQ(a.from().id(), b.from().id()) << "edge " << a.id();
+    EXPECT_EQ(a.to().id(), b.to().id()) << "edge " << a.id();
+    EXPECT_EQ(a.length_, b.length_) << "edge " << a.id();
+    EXPECT_EQ(a.weight_, b.weight_) << "edge " << a.id();
+    EXPECT_EQ(expected.points(a).ToVector(), actual.points(b).ToVector())
+        << "edge " << a.id();
+  }
+}
+
+TEST(IncrementalUpdateTest, ApplyChangeFile) {
+  const std::string data_path = std::string(TEST_DATA_PATH);
+  const osmium::Box box(-122.0, 37.0, -121.0, 38.0);
+
+  IncrementalUpdater updater =
+      IncrementalUpdater::LoadFromFile(data_path + "/incremental_base.osm", box);
+  graph::RoadGraph graph        = updater.BuildGraph();
+  graph::SimpleIndexer indexer = graph::SimpleIndexer::CreateFromRawGraph(graph);
+
+  EXPECT_THAT(SortedVertexIds(graph), ElementsAre(2, 4, 5, 6));
+  EXPECT_EQ(4, graph.edges().size());
+
+  IncrementalUpdateStats stats =
+      updater.Apply(data_path + "/incremental_change.osc", &graph, &indexer);
+  EXPECT_EQ(2, stats.num_added_vertices);
+  EXPECT_EQ(1, stats.num_removed_vertices);
+
+  // Node 4 is no longer a junction, while node 1 and 3 become junctions.
+  EXPECT_THAT(SortedVertexIds(graph), ElementsAre(1, 2, 3, 5, 6));
+  EXPECT_NE(nullptr, indexer.FindEdge(1, 2));
+  EXPECT_NE(nullptr, indexer.FindEdge(2, 3));
+  EXPECT_NE(nullptr, indexer.FindEdge(6, 1));
+  EXPECT_EQ(nullptr, indexer.FindEdge(2, 4));
+  EXPECT_EQ(nullptr, indexer.Find(4));
+  EXPECT_EQ(SplitWayId(10, 1), indexer.FindEdge(2, 3)->id());
+
+  // Must be the same as running extract_routes on the updated map.
+  ExpectSameRoutes(ExtractRoutes(data_path + "/incremental_updated.osm", box,
+                                 "incremental_updated.routes.osm"),
+                   graph);
+}
+
+TEST(IncrementalUpdateTest, ApplyToExtractedGraph) {
+  const std::string data_path = std::string(TEST_DATA_PATH);
+  const osmium::Box box(-122.0, 37.0, -121.0, 38.0);
+
+  // The way a server runs: the graph comes from the routing graph file of the
+  // base map, and is patched in place.
+  graph::RoadGraph graph = ExtractRoutes(data_path + "/incremental_base.osm", box,
+                                         "incremental_base.routes.osm");
+  IncrementalUpdater updater =
+      IncrementalUpdater::LoadFromFile(data_path + "/incremental_base.osm", box);
+  updater.Attach(graph);
+  graph::SimpleIndexer indexer = graph::SimpleIndexer::CreateFromRawGraph(graph);
+  updater.Apply(data_path + "/incremental_change.osc", &graph, &indexer);
+
+  ExpectSameRoutes(ExtractRoutes(data_path + "/incremental_updated.osm", box,
+                                 "incremental_updated.routes.osm"),
+                   graph);
+}
+
+// Builds the graph from scratch, with the state after applying the change to an
+// empty map.
+graph::RoadGraph BuildFromScratch(const OsmChange &change) {
+  IncrementalUpdater updater(osmium::Box(-122.0, 37.0, -121.0, 38.0));
+  graph::RoadGraph ignored = updater.BuildGraph();
+  updater.Apply(change, &ignored, nullptr);
+  return updater.BuildGraph();
+}
+
+TEST(IncrementalUpdateTest, ApplyToEmptyMap) {
+  const osmium::Box box(-122.0, 37.0, -121.0, 38.0);
+
+  OsmChange change;
+  change.nodes[1].location = osmium::Location(-121.9900, 37.4000);
+  change.nodes[2].location = osmium::Location(-121.9890, 37.4000);
+  change.nodes[3].location = osmium::Location(-121.9880, 37.4000);
+  change.nodes[4].location = osmium::Location(-121.9890, 37.4010);
+  change.nodes[5].location = osmium::Location(-121.9880, 37.4010);
+  change.ways[10].refs     = {1, 2, 3};
+  change.ways[11].refs     = {4, 2};
+  change.ways[12].refs     = {4, 5, 3};
+
+  IncrementalUpdater updater(box);
+  graph::RoadGraph graph = updater.BuildGraph();
+  updater.Apply(change, &graph, nullptr);
+
+  EXPECT_THAT(SortedVertexIds(graph), ElementsAre(2, 3, 4));
+  EXPECT_EQ(3, graph.edges().size());
+
+  // Moving node 5 only changes the length of the edge 4 -> 3.
+  OsmChange move;
+  move.nodes[5].version  = 2;
+  move.nodes[5].location = osmium::Location(-121.9880, 37.4020);
+  IncrementalUpdateStats stats = updater.Apply(move, &graph, nullptr);
+  EXPECT_EQ(1, stats.num_affected_roads);
+  EXPECT_EQ(1, stats.num_removed_edges);
+  EXPECT_EQ(1, stats.num_added_edges);
+  change.nodes[5] = move.nodes[5];
+  EXPECT_EQ(SortedEdges(BuildFromScratch(change)), SortedEdges(graph));
+
+  // Removing road 11, neither node 2 nor node 4 is a junction any more.
+  OsmChange removal;
+  removal.ways[11].removed = true;
+  updater.Apply(removal, &graph, nullptr);
+  EXPECT_THAT(SortedVertexIds(graph), ElementsAre(3));
+  EXPECT_EQ(0, graph.edges().size());
+}
+
+TEST(IncrementalUpdateTest, ReportsMissingLocations) {
+  const std::string data_path = std::string(TEST_DATA_PATH);
+  const osmium::Box box(-122.0, 37.0, -121.0, 38.0);
+
+  IncrementalUpdater updater =
+      IncrementalUpdater::LoadFromFile(data_path + "/incremental_base.osm", box);
+  graph::RoadGraph graph = updater.BuildGraph();
+
+  // Node 8 is only on a footway, so its location is not kept.
+  OsmChange change;
+  change.ways[16].refs = {8, 3};
+  IncrementalUpdateStats stats = updater.Apply(change, &graph, nullptr);
+  EXPECT_EQ(1, stats.num_missing_locations);
+
+  // Once the change carries the node, nothing is missing.
+  change.nodes[8].location = osmium::Location(-121.9890, 37.3990);
+  stats                    = updater.Apply(change, &graph, nullptr);
+  EXPECT_EQ(0, stats.num_missing_locations);
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -0,0 +1,69 @@
+#include "utils/metrics.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+using ::testing::HasSubstr;
+
+TEST(MetricsTest, ScopedStageRecordsIntoRegistry) {
+  MetricsRegistry::Global().Clear();
+  {
+    ScopedStage stage("first");
+    stage.AddObjects(1000);
+    stage.AddObjects(24);
+    stage.AddBytesRead(4096);
+    stage.SetSize("junctions", 42);
+  }
+  { ScopedStage stage("second \"quoted\""); }
+
+  std::vector<StageMetrics> stages = MetricsRegistry::Global().Stages();
+  ASSERT_EQ(2, stages.size());
+  EXPECT_EQ("first", stages[0].name);
+  EXPECT_EQ(1024, stages[0].num_objects);
+  EXPECT_EQ(4096, stages[0].bytes_read);
+  EXPECT_EQ(42, stages[0].sizes.at("junctions"));
+  EXPECT_GE(stages[0].wall_seconds, 0.0);
+  EXPECT_GT(stages[0].rss_start_bytes, 0);
+  EXPECT_GT(stages[0].rss_end_bytes, 0);
+  EXPECT_GT(stages[0].peak_rss_bytes, 0);
+
+  std::string json = MetricsRegistry::Global().ToJson();
+  EXPECT_THAT(json, HasSubstr("\"name\": \"first\""));
+  EXPECT_THAT(json, HasSubstr("\"objects\": 1024"));
+  EXPECT_THAT(json, HasSubstr("\"bytes_read\": 4096"));
+  EXPECT_THAT(json, HasSubstr("\"sizes\": {\"junctions\": 42}"));
+  EXPECT_THAT(json, HasSubstr("\"name\": \"second \\\"quoted\\\"\""));
+  MetricsRegistry::Global().Clear();
+}
+
+// A stage reports the peak reached during the stage, not the one of the whole
+// process, as long as the kernel lets the mark be reset.
+TEST(MetricsTest, ScopedStageMeasuresItsOwnPeak) {
+  if (!ResetPeakRss()) {
+    GTEST_SKIP() << "The peak resident set size cannot be reset.";
+  }
+  MetricsRegistry::Global().Clear();
+  constexpr size_t kLarge = 64 << 20;
+  {
+    ScopedStage stage("large");
+    std::vector<char> touched(kLarge, 1);
+    EXPECT_EQ(1, touched[kLarge / 2]);
+  }
+  { ScopedStage stage("small"); }
+
+  std::vector<StageMetrics> stages = MetricsRegistry::Global().Stages();
+  ASSERT_EQ(2, stages.size());
+  EXPECT_GE(stages[0].peak_rss_bytes, stages[0].rss_start_bytes + kLarge / 2);
+  EXPECT_LT(stages[1].peak_rss_bytes, stages[0].peak_rss_bytes - kLarge / 2);
+  EXPECT_GE(ProcessPeakRssBytes(), stages[0].peak_rss_bytes);
+  MetricsRegistry::Global().Clear();
+}
+
+}  // namespace testing
+}  // namespace open_semap
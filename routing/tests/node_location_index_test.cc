@@ -0,0 +1,47 @@
+#include "graph/node_location_index.h"
+
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+TEST(NodeLocationIndexTest, SetAndGet) {
+  for (graph::NodeLocationIndexType type :
+       {graph::NodeLocationIndexType::kSortedArray,
+        graph::NodeLocationIndexType::kSparseFile,
+        graph::NodeLocationIndexType::kDenseFile}) {
+    SCOPED_TRACE(graph::NodeLocationIndexName(type));
+    std::unique_ptr<graph::NodeLocationIndex> index =
+        graph::CreateNodeLocationIndex(type);
+    ASSERT_NE(nullptr, index);
+
+    // Out of order, as the nodes of an OSM XML file can be.
+    index->set(30, osmium::Location(3.0, 30.0));
+    index->set(10, osmium::Location(1.0, 10.0));
+    index->set(20, osmium::Location(2.0, 20.0));
+    index->sort();
+
+    EXPECT_EQ(osmium::Location(1.0, 10.0), index->get_noexcept(10));
+    EXPECT_EQ(osmium::Location(2.0, 20.0), index->get_noexcept(20));
+    EXPECT_EQ(osmium::Location(3.0, 30.0), index->get_noexcept(30));
+    EXPECT_FALSE(index->get_noexcept(15).valid());
+  }
+}
+
+TEST(NodeLocationIndexTest, ChooseBySize) {
+  EXPECT_EQ(graph::NodeLocationIndexType::kSortedArray,
+            graph::ChooseNodeLocationIndex(0));
+  EXPECT_EQ(graph::NodeLocationIndexType::kSortedArray,
+            graph::ChooseNodeLocationIndex(graph::kSortedArrayMaxInputSize));
+  EXPECT_EQ(graph::NodeLocationIndexType::kSparseFile,
+            graph::ChooseNodeLocationIndex(graph::kSortedArrayMaxInputSize + 1));
+  EXPECT_EQ(graph::NodeLocationIndexType::kDenseFile,
+            graph::ChooseNodeLocationIndex(graph::kSparseFileMaxInputSize + 1));
+  EXPECT_EQ(nullptr, graph::CreateNodeLocationIndex(graph::NodeLocationIndexType::kAuto));
+}
+
+}  // namespace testing
+}  // namespace open_semap
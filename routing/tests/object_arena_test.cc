@@ -0,0 +1,76 @@
+#include "graph/object_arena.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+// Counts the live instances, to check that the arena runs the destructors.
+struct Tracked {
+  Tracked(int value_, int *alive_) : value(value_), alive(alive_) { ++*alive; }
+
+  ~Tracked() { --*alive; }
+
+  int value;
+  int *alive;
+  std::string payload = std::string(64, 'x');
+};
+
+TEST(ObjectArenaTest, CreateAndDestroy) {
+  int alive = 0;
+  {
+    graph::ObjectArena<Tracked, 4> arena;
+    std::vector<Tracked *> objects;
+    for (int i = 0; i < 10; ++i) {
+      objects.emplace_back(arena.Create(i, &alive));
+    }
+    EXPECT_EQ(10, alive);
+    EXPECT_EQ(10, arena.size());
+    // 3 slabs of 4.
+    EXPECT_EQ(3 * 4 * sizeof(Tracked), arena.capacity_bytes());
+
+    // The slot of a destroyed object is reused.
+    arena.Destroy(objects[5]);
+    EXPECT_EQ(9, alive);
+    Tracked *reused = arena.Create(100, &alive);
+    EXPECT_EQ(objects[5], reused);
+    EXPECT_EQ(10, arena.size());
+
+    arena.Destroy(objects[7]);
+    for (int i = 0; i < 10; ++i) {
+      if (i != 5 && i != 7) {
+        EXPECT_EQ(i, objects[i]->value);
+      }
+    }
+  }
+  // Only the live objects are destroyed with the arena.
+  EXPECT_EQ(0, alive);
+}
+
+TEST(ObjectArenaTest, MoveKeepsObjectsInPlace) {
+  int alive = 0;
+  graph::ObjectArena<Tracked, 4> arena;
+  Tracked *object = arena.Create(42, &alive);
+
+  graph::ObjectArena<Tracked, 4> moved = std::move(arena);
+  EXPECT_EQ(0, arena.size());
+  EXPECT_EQ(1, moved.size());
+  EXPECT_EQ(42, object->value);
+
+  graph::ObjectArena<Tracked, 4> other;
+  Tracked *other_object = other.Create(7, &alive);
+  moved.Append(std::move(other));
+  EXPECT_EQ(2, moved.size());
+  EXPECT_EQ(0, other.size());
+  EXPECT_EQ(7, other_object->value);
+
+  moved.Clear();
+  EXPECT_EQ(0, alive);
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -0,0 +1,72 @@
+#include "utils/ordered_task_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+TEST(OrderedTaskQueueTest, ConsumesInSubmissionOrder) {
+  for (int num_threads : {1, 4}) {
+    std::vector<int> consumed;
+    OrderedTaskQueue<int> queue(
+        num_threads, [&consumed](int &&value) { consumed.emplace_back(value); });
+    std::vector<int> expected;
+    for (int i = 0; i < 100; ++i) {
+      expected.emplace_back(i);
+      queue.Submit([i]() {
+        // The early tasks finish last.
+        std::this_thread::sleep_for(std::chrono::microseconds((100 - i) * 10));
+        return i;
+      });
+    }
+    queue.Drain();
+    EXPECT_EQ(expected, consumed) << num_threads << " threads";
+  }
+}
+
+TEST(OrderedTaskQueueTest, UsesAFixedPool) {
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  OrderedTaskQueue<int> queue(3, [](int &&) {});
+  for (int i = 0; i < 50; ++i) {
+    queue.Submit([&running, &max_running]() {
+      int now = ++running;
+      int max = max_running.load();
+      while (now > max && !max_running.compare_exchange_weak(max, now)) {
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      --running;
+      return 0;
+    });
+  }
+  queue.Drain();
+  EXPECT_LE(max_running.load(), 3);
+}
+
+TEST(OrderedTaskQueueTest, RethrowsFromDrain) {
+  OrderedTaskQueue<int> queue(2, [](int &&) {});
+  queue.Submit([]() -> int { throw std::runtime_error("broken buffer"); });
+  EXPECT_THROW(queue.Drain(), std::runtime_error);
+}
+
+TEST(OrderedTaskQueueTest, DestructorDoesNotRethrow) {
+  // The pending failure must not terminate the unwinding from the other
+  // exception.
+  EXPECT_THROW(
+      {
+        OrderedTaskQueue<int> queue(2, [](int &&) {});
+        queue.Submit([]() -> int { throw std::runtime_error("broken buffer"); });
+        throw std::logic_error("leaving early");
+      },
+      std::logic_error);
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -0,0 +1,108 @@
+#include "algorithms/priority_queue.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+// Pushes like Dijkstra does: every key is at least the last popped one, and
+// some vertices are pushed again with a lower key before they are popped. Then
+// checks that the vertices come out by increasing key, each with its lowest key.
+template <typename Queue>
+void ExpectDijkstraOrder(Queue *queue, bool collapses_duplicates) {
+  constexpr graph::VertexIndex kNumVertices = 1000;
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<graph::VertexIndex> pick(0, kNumVertices - 1);
+  std::uniform_int_distribution<graph::Weight> step(0, 100);
+
+  std::vector<graph::Weight> best(kNumVertices, graph::kInfiniteWeight);
+  std::vector<bool> popped(kNumVertices, false);
+  graph::Weight last = 0;
+  size_t num_popped  = 0;
+
+  for (int round = 0; round < 5000; ++round) {
+    graph::VertexIndex vertex = pick(rng);
+    graph::Weight key         = last + step(rng);
+    if (!popped[vertex] && key < best[vertex]) {
+      best[vertex] = key;
+      queue->Push(vertex, key);
+    }
+    if (round % 3 == 0 && !queue->empty()) {
+      QueueEntry entry = queue->Pop();
+      ASSERT_GE(entry.key, last);
+      last = entry.key;
+      if (popped[entry.vertex]) {
+        // A stale duplicate.
+        ASSERT_FALSE(collapses_duplicates);
+        continue;
+      }
+      ASSERT_EQ(best[entry.vertex], entry.key);
+      popped[entry.vertex] = true;
+      ++num_popped;
+    }
+  }
+  while (!queue->empty()) {
+    QueueEntry entry = queue->Pop();
+    ASSERT_GE(entry.key, last);
+    last = entry.key;
+    if (!popped[entry.vertex]) {
+      ASSERT_EQ(best[entry.vertex], entry.key);
+      popped[entry.vertex] = true;
+      ++num_popped;
+    }
+  }
+
+  EXPECT_EQ(std::count(best.begin(), best.end(), graph::kInfiniteWeight),
+            kNumVertices - num_popped);
+  // The queue is drained, so everything pushed has been popped.
+  if (collapses_duplicates) {
+    EXPECT_EQ(num_popped, queue->stats().pops);
+  } else {
+    EXPECT_EQ(queue->stats().pushes, queue->stats().pops);
+  }
+}
+
+TEST(PriorityQueueTest, LazyBinaryHeap) {
+  LazyBinaryHeap queue;
+  ExpectDijkstraOrder(&queue, false);
+}
+
+TEST(PriorityQueueTest, IndexedFourAryHeap) {
+  IndexedFourAryHeap queue;
+  queue.Reserve(1000);
+  ExpectDijkstraOrder(&queue, true);
+  EXPECT_GT(queue.stats().decrease_keys, 0);
+}
+
+TEST(PriorityQueueTest, RadixHeap) {
+  RadixHeap queue;
+  ExpectDijkstraOrder(&queue, false);
+}
+
+TEST(PriorityQueueTest, ClearKeepsWorking) {
+  IndexedFourAryHeap four_ary;
+  four_ary.Reserve(10);
+  RadixHeap radix;
+  for (int round = 0; round < 3; ++round) {
+    four_ary.Push(3, 30);
+    four_ary.Push(5, 50);
+    radix.Push(3, 30);
+    radix.Push(5, 50);
+    EXPECT_EQ(3, four_ary.Pop().vertex);
+    EXPECT_EQ(3, radix.Pop().vertex);
+    // Vertex 5 is left in the queues, and must not survive the Clear().
+    four_ary.Clear();
+    radix.Clear();
+    EXPECT_TRUE(four_ary.empty());
+    EXPECT_TRUE(radix.empty());
+  }
+}
+
+}  // namespace testing
+}  // namespace open_semap
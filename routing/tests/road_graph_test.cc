@@ -1,5 +1,11 @@
 #include "graph/road_graph.h"
 
+#include <cmath>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "graph/builder.h"
 #include "graph/simple_indexer.h"
@@ -43,17 +49,182 @@ TEST(RoadGraphTest, LoadGraphAndIndexing) {
               ElementsAre(AllOf(
                   Property(&graph::Edge::from, Property(&graph::Vertex::id, 421266660)),
                   Property(&graph::Edge::to, Property(&graph::Vertex::id, 421266661)),
-                  Property(&graph::Edge::cost, DoubleNear(49.5252, 1e-3)))));
+                  Property(&graph::Edge::length, DoubleNear(49.5252, 1e-3)))));
 
   EXPECT_THAT(
       conn->inwards,
       ElementsAre(
           AllOf(Property(&graph::Edge::from, Property(&graph::Vertex::id, 421266658)),
                 Property(&graph::Edge::to, Property(&graph::Vertex::id, 421266660)),
-                Property(&graph::Edge::cost, DoubleNear(48.8853, 1e-3))),
+                Property(&graph::Edge::length, DoubleNear(48.8853, 1e-3))),
           AllOf(Property(&graph::Edge::from, Property(&graph::Vertex::id, 421266698)),
                 Property(&graph::Edge::to, Property(&graph::Vertex::id, 421266660)),
-                Property(&graph::Edge::cost, DoubleNear(140.172, 1e-3)))));
+                Property(&graph::Edge::length, DoubleNear(140.172, 1e-3)))));
+}
+
+TEST(RoadGraphTest, LoadTopologyOnly) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells_routes.osm";
+  graph::RoadGraph full  = graph::RoadGraph::LoadFromFile(path);
+
+  graph::LoadOptions options;
+  options.topology_only = true;
+  graph::RoadGraph topology = graph::RoadGraph::LoadFromFile(path, options);
+
+  EXPECT_EQ(44, topology.vertices().size());
+  ASSERT_EQ(full.edges().size(), topology.edges().size());
+
+  for (size_t i = 0; i < full.edges().size(); ++i) {
+    const graph::Edge &expected = *full.edges()[i];
+    const graph::Edge &actual   = *topology.edges()[i];
+    EXPECT_EQ(expected.from().id(), actual.from().id());
+    EXPECT_EQ(expected.to().id(), actual.to().id());
+    EXPECT_THAT(actual.length(), DoubleEq(expected.length()));
+    EXPECT_EQ(expected.cost(), actual.cost());
+    // Only the two ends are kept.
+    EXPECT_EQ(2, topology.points(actual).size());
+  }
+}
+
+TEST(RoadGraphTest, LoadTravelTimes) {
+  // At 36 km/h, or 10 m/s, a road takes as many deciseconds as it has meters.
+  std::unique_ptr<RoutingProfile> profile =
+      RoutingProfile::Parse("allow highway *\nspeed 36 *\n");
+  ASSERT_NE(nullptr, profile);
+
+  graph::LoadOptions options;
+  options.profile        = profile.get();
+  graph::RoadGraph graph = graph::RoadGraph::LoadFromFile(
+      std::string(TEST_DATA_PATH) + "/adobe_wells_routes.osm", options);
+
+  ASSERT_FALSE(graph.edges().empty());
+  for (const graph::Edge *edge : graph.edges()) {
+    EXPECT_EQ(static_cast<graph::Weight>(std::ceil(edge->length())), edge->cost());
+  }
+}
+
+TEST(RoadGraphTest, ParallelLoadMatchesSerialLoad) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells_routes.osm";
+  graph::RoadGraph serial = graph::RoadGraph::LoadFromFile(path);
+
+  graph::LoadOptions options;
+  options.num_threads       = 4;
+  graph::RoadGraph parallel = graph::RoadGraph::LoadFromFile(path, options);
+
+  ASSERT_EQ(serial.vertices().size(), parallel.vertices().size());
+  ASSERT_EQ(serial.edges().size(), parallel.edges().size());
+  for (size_t i = 0; i < serial.edges().size(); ++i) {
+    const graph::Edge &expected = *serial.edges()[i];
+    const graph::Edge &actual   = *parallel.edges()[i];
+    EXPECT_EQ(expected.id(), actual.id());
+    EXPECT_EQ(expected.from().id(), actual.from().id());
+    EXPECT_EQ(expected.to().id(), actual.to().id());
+    EXPECT_EQ(expected.length(), actual.length());
+    EXPECT_EQ(expected.cost(), actual.cost());
+    EXPECT_EQ(serial.points(expected).ToVector(), parallel.points(actual).ToVector());
+  }
+}
+
+TEST(RoadGraphTest, VertexNumbering) {
+  graph::RoadGraph graph = graph::RoadGraphBuilder()
+                               .AddEdge(10, 20, 1.0)
+                               .AddEdge(20, 30, 1.0)
+                               .AddEdge(30, 40, 1.0)
+                               .Build();
+  const graph::VertexNumbering &numbering = graph.numbering();
+  ASSERT_EQ(4, numbering.size());
+  for (size_t i = 0; i < graph.vertices().size(); ++i) {
+    const graph::Vertex &vertex = *graph.vertices()[i];
+    EXPECT_EQ(i, vertex.index());
+    EXPECT_EQ(i, numbering.Find(vertex.id()));
+    EXPECT_EQ(vertex.id(), numbering.id(i));
+  }
+  EXPECT_EQ(graph::kInvalidVertexIndex, numbering.Find(50));
+
+  // Removing a vertex gives its index to the last one.
+  graph.RemoveVertex(20);
+  EXPECT_EQ(3, numbering.size());
+  EXPECT_EQ(graph::kInvalidVertexIndex, numbering.Find(20));
+  EXPECT_EQ(1, numbering.Find(40));
+  EXPECT_EQ(1, graph.FindVertex(40)->index());
+
+  const graph::Vertex &added = graph.AddVertex(50, osmium::Location());
+  EXPECT_EQ(3, added.index());
+  EXPECT_EQ(3, numbering.Find(50));
+
+  // The numbering stays valid when the graph is moved.
+  graph::RoadGraph moved = std::move(graph);
+  EXPECT_EQ(&numbering, &moved.numbering());
+}
+
+TEST(RoadGraphTest, ReorderAlongHilbertCurve) {
+  graph::RoadGraph graph = graph::MakeGridGraph(8, 8);
+  std::map<graph::EdgeID, std::pair<graph::VertexID, graph::VertexID>> expected_edges;
+  std::map<graph::EdgeID, std::vector<osmium::Location>> expected_points;
+  for (const graph::Edge *edge : graph.edges()) {
+    expected_edges[edge->id()]  = {edge->from().id(), edge->to().id()};
+    expected_points[edge->id()] = graph.points(*edge).ToVector();
+  }
+
+  graph.Reorder(graph::VertexOrder::kHilbert);
+
+  ASSERT_EQ(64, graph.vertices().size());
+  ASSERT_EQ(expected_edges.size(), graph.edges().size());
+  for (size_t i = 0; i < graph.vertices().size(); ++i) {
+    const graph::Vertex &vertex = *graph.vertices()[i];
+    EXPECT_EQ(i, vertex.index());
+    EXPECT_EQ(i, graph.numbering().Find(vertex.id()));
+    EXPECT_EQ(&vertex, graph.FindVertex(vertex.id()));
+    if (i > 0) {
+      EXPECT_LT(graph::HilbertKey(graph.vertices()[i - 1]->loc()),
+                graph::HilbertKey(vertex.loc()));
+    }
+  }
+
+  for (size_t i = 0; i < graph.edges().size(); ++i) {
+    const graph::Edge &edge = *graph.edges()[i];
+    EXPECT_EQ(expected_edges[edge.id()],
+              std::make_pair(edge.from().id(), edge.to().id()));
+    EXPECT_EQ(expected_points[edge.id()], graph.points(edge).ToVector());
+    EXPECT_EQ(&edge.from(), graph.vertices()[edge.from().index()]);
+    if (i > 0) {
+      EXPECT_LE(graph.edges()[i - 1]->from().index(), edge.from().index());
+    }
+  }
+}
+
+TEST(RoadGraphTest, PatchingReclaimsPoints) {
+  graph::RoadGraph graph = graph::MakeGridGraph(8, 8);
+  const size_t num_points = graph.geometry().num_points();
+  std::map<graph::EdgeID, std::vector<osmium::Location>> expected_points;
+  for (const graph::Edge *edge : graph.edges()) {
+    expected_points[edge->id()] = graph.points(*edge).ToVector();
+  }
+
+  // Replace the points of every edge, then remove and add back every edge, a
+  // few times over. The store never grows past twice its live size.
+  for (int round = 0; round < 3; ++round) {
+    for (graph::Edge *edge : graph.edges()) {
+      graph.SetPoints(*edge, expected_points[edge->id()]);
+      EXPECT_LE(graph.geometry().num_points(), 2 * num_points);
+    }
+    std::vector<const graph::Edge *> edges(graph.edges().begin(), graph.edges().end());
+    for (const graph::Edge *edge : edges) {
+      const graph::Vertex &from = edge->from();
+      const graph::Vertex &to   = edge->to();
+      graph::EdgeID id          = edge->id();
+      double length             = edge->length_;
+      graph.RemoveEdge(*edge);
+      graph::Edge &added = graph.AddEdge(from, to, length);
+      added.id_          = id;
+      graph.SetPoints(added, expected_points[id]);
+      EXPECT_LE(graph.geometry().num_points(), 2 * num_points);
+    }
+  }
+
+  ASSERT_EQ(expected_points.size(), graph.edges().size());
+  for (const graph::Edge *edge : graph.edges()) {
+    EXPECT_EQ(expected_points[edge->id()], graph.points(*edge).ToVector());
+  }
 }
 
 TEST(SimpleIndexerTest, FindEdge) {
@@ -0,0 +1,182 @@
+#include "utils/routing_profile.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "osmium/builder/osm_object_builder.hpp"
+#include "osmium/memory/buffer.hpp"
+#include "tests/testdata.h"
+
+namespace open_semap {
+namespace testing {
+
+using Tags = std::vector<std::pair<std::string, std::string>>;
+
+// Builds a way with the tags into the buffer.
+const osmium::Way &MakeWay(const Tags &tags, osmium::memory::Buffer *buffer) {
+  {
+    osmium::builder::WayBuilder builder(*buffer);
+    builder.set_id(1);
+    osmium::builder::TagListBuilder tag_builder(builder);
+    for (const auto &tag : tags) {
+      tag_builder.add_tag(tag.first, tag.second);
+    }
+  }
+  size_t offset = buffer->commit();
+  return buffer->get<osmium::Way>(offset);
+}
+
+// Accepts() on a way built with the tags.
+bool Accepts(const RoutingProfile &profile, const Tags &tags) {
+  osmium::memory::Buffer buffer(1024, osmium::memory::Buffer::auto_grow::yes);
+  return profile.Accepts(MakeWay(tags, &buffer));
+}
+
+// Speed() on a way built with the tags.
+double Speed(const RoutingProfile &profile, const Tags &tags) {
+  osmium::memory::Buffer buffer(1024, osmium::memory::Buffer::auto_grow::yes);
+  return profile.Speed(MakeWay(tags, &buffer));
+}
+
+TEST(RoutingProfileTest, PerfectHashTable) {
+  std::vector<std::string> keys = {"motorway", "trunk",       "primary", "secondary",
+                                   "tertiary", "residential", "service", "footway"};
+  PerfectHashTable table(keys);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i), table.Find(keys[i].c_str()));
+  }
+  EXPECT_EQ(-1, table.Find("cycleway"));
+  EXPECT_EQ(-1, table.Find("primar"));
+  EXPECT_EQ(-1, table.Find(""));
+  EXPECT_EQ(-1, PerfectHashTable().Find("primary"));
+
+  // Told apart by the first byte alone.
+  PerfectHashTable small({"footway", "service"});
+  EXPECT_EQ(0, small.Find("footway"));
+  EXPECT_EQ(1, small.Find("service"));
+  EXPECT_EQ(-1, small.Find("services"));
+  EXPECT_EQ(-1, small.Find("residential"));
+
+  // Sharing the first byte, and small enough to be scanned rather than hashed.
+  PerfectHashTable shared({"track", "trunk"});
+  EXPECT_EQ(0, shared.Find("track"));
+  EXPECT_EQ(1, shared.Find("trunk"));
+  EXPECT_EQ(-1, shared.Find("tr"));
+  EXPECT_EQ(-1, shared.Find("tertiary"));
+}
+
+TEST(RoutingProfileDeathTest, PerfectHashTableRejectsDuplicates) {
+  EXPECT_DEATH(PerfectHashTable({"primary", "trunk", "primary"}), "");
+}
+
+TEST(RoutingProfileTest, DefaultMatchesLegacyPredicate) {
+  const RoutingProfile &profile = RoutingProfile::Default();
+  EXPECT_TRUE(Accepts(profile, {{"highway", "residential"}, {"name", "Main St"}}));
+  EXPECT_TRUE(Accepts(profile, {{"highway", "cycleway"}}));
+  EXPECT_FALSE(Accepts(profile, {{"highway", "footway"}}));
+  EXPECT_FALSE(Accepts(profile, {{"highway", "service"}}));
+  EXPECT_FALSE(Accepts(profile, {{"building", "yes"}}));
+  EXPECT_FALSE(Accepts(profile, {}));
+}
+
+TEST(RoutingProfileTest, AllowAndDeny) {
+  std::unique_ptr<RoutingProfile> profile = RoutingProfile::Parse(
+      "# A comment\n"
+      "name test\n"
+      "allow highway primary residential  # trailing comment\n"
+      "allow highway secondary\n"
+      "deny access no private\n"
+      "deny area *\n");
+  ASSERT_NE(nullptr, profile);
+  EXPECT_EQ("test", profile->name());
+
+  EXPECT_TRUE(Accepts(*profile, {{"highway", "primary"}}));
+  EXPECT_TRUE(Accepts(*profile, {{"highway", "secondary"}, {"access", "yes"}}));
+  EXPECT_FALSE(Accepts(*profile, {{"highway", "motorway"}}));
+  EXPECT_FALSE(Accepts(*profile, {{"highway", "residential"}, {"access", "private"}}));
+  EXPECT_FALSE(Accepts(*profile, {{"area", "no"}, {"highway", "residential"}}));
+  EXPECT_FALSE(Accepts(*profile, {{"access", "yes"}}));
+}
+
+TEST(RoutingProfileTest, MalformedProfiles) {
+  EXPECT_EQ(nullptr, RoutingProfile::Parse("allow highway\n"));
+  EXPECT_EQ(nullptr, RoutingProfile::Parse("prefer highway primary\n"));
+  EXPECT_EQ(nullptr, RoutingProfile::Parse("name\n"));
+  EXPECT_EQ(nullptr, RoutingProfile::Parse("speed fast motorway\n"));
+  EXPECT_EQ(nullptr, RoutingProfile::Parse("speed 50\n"));
+  EXPECT_EQ(nullptr, RoutingProfile::LoadFromFile("/nonexistent.profile"));
+}
+
+TEST(RoutingProfileTest, Speeds) {
+  std::unique_ptr<RoutingProfile> profile = RoutingProfile::Parse(
+      "allow highway *\n"
+      "speed 100 motorway\n"
+      "speed 20 residential living_street\n");
+  ASSERT_NE(nullptr, profile);
+
+  EXPECT_DOUBLE_EQ(100.0, Speed(*profile, {{"highway", "motorway"}}));
+  EXPECT_DOUBLE_EQ(20.0, Speed(*profile, {{"highway", "living_street"}}));
+  EXPECT_DOUBLE_EQ(RoutingProfile::kDefaultSpeed,
+                   Speed(*profile, {{"highway", "primary"}}));
+
+  // The maxspeed tag caps the speed, but does not raise it.
+  EXPECT_DOUBLE_EQ(80.0, Speed(*profile, {{"highway", "motorway"}, {"maxspeed", "80"}}));
+  EXPECT_DOUBLE_EQ(100.0,
+                   Speed(*profile, {{"highway", "motorway"}, {"maxspeed", "130"}}));
+  EXPECT_DOUBLE_EQ(100.0,
+                   Speed(*profile, {{"highway", "motorway"}, {"maxspeed", "none"}}));
+
+  profile = RoutingProfile::Parse("allow highway *\nspeed 15 *\n");
+  ASSERT_NE(nullptr, profile);
+  EXPECT_DOUBLE_EQ(15.0, Speed(*profile, {{"highway", "primary"}}));
+}
+
+TEST(RoutingProfileTest, ParseMaxSpeed) {
+  EXPECT_DOUBLE_EQ(50.0, ParseMaxSpeed("50"));
+  EXPECT_DOUBLE_EQ(50.0, ParseMaxSpeed("50 km/h"));
+  EXPECT_NEAR(48.28, ParseMaxSpeed("30 mph"), 1e-2);
+  EXPECT_NEAR(18.52, ParseMaxSpeed("10 knots"), 1e-2);
+  EXPECT_DOUBLE_EQ(0.0, ParseMaxSpeed("none"));
+  EXPECT_DOUBLE_EQ(0.0, ParseMaxSpeed("signals"));
+  EXPECT_DOUBLE_EQ(0.0, ParseMaxSpeed("DE:urban"));
+  EXPECT_DOUBLE_EQ(0.0, ParseMaxSpeed("-5"));
+}
+
+TEST(RoutingProfileTest, ShippedProfiles) {
+  const std::string path = std::string(PROFILE_PATH);
+
+  std::unique_ptr<RoutingProfile> car =
+      RoutingProfile::LoadFromFile(path + "/car.profile");
+  std::unique_ptr<RoutingProfile> bike =
+      RoutingProfile::LoadFromFile(path + "/bike.profile");
+  std::unique_ptr<RoutingProfile> pedestrian =
+      RoutingProfile::LoadFromFile(path + "/pedestrian.profile");
+  ASSERT_NE(nullptr, car);
+  ASSERT_NE(nullptr, bike);
+  ASSERT_NE(nullptr, pedestrian);
+
+  EXPECT_TRUE(Accepts(*car, {{"highway", "motorway"}}));
+  EXPECT_FALSE(Accepts(*bike, {{"highway", "motorway"}}));
+  EXPECT_FALSE(Accepts(*pedestrian, {{"highway", "motorway"}}));
+
+  EXPECT_FALSE(Accepts(*car, {{"highway", "cycleway"}}));
+  EXPECT_TRUE(Accepts(*bike, {{"highway", "cycleway"}}));
+
+  EXPECT_FALSE(Accepts(*car, {{"highway", "footway"}}));
+  EXPECT_FALSE(Accepts(*bike, {{"highway", "footway"}}));
+  EXPECT_TRUE(Accepts(*pedestrian, {{"highway", "footway"}}));
+
+  EXPECT_FALSE(Accepts(*car, {{"highway", "residential"}, {"motor_vehicle", "no"}}));
+  EXPECT_TRUE(Accepts(*bike, {{"highway", "residential"}, {"motor_vehicle", "no"}}));
+
+  EXPECT_GT(Speed(*car, {{"highway", "motorway"}}),
+            Speed(*car, {{"highway", "residential"}}));
+  EXPECT_GT(Speed(*bike, {{"highway", "residential"}}),
+            Speed(*pedestrian, {{"highway", "residential"}}));
+}
+
+}  // namespace testing
+}  // namespace open_semap
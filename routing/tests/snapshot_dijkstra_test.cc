@@ -0,0 +1,128 @@
+#include "algorithms/snapshot_dijkstra.h"
+
+#include <memory>
+#include <random>
+#include <string>
+
+#include "algorithms/dijkstra.h"
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "graph/csr_graph.h"
+#include "graph/road_graph.h"
+#include "graph/snapshot.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+
+using graph::CsrGraph;
+using graph::GraphSnapshot;
+using graph::RoadGraph;
+using graph::SnapshotEdge;
+using graph::Vertex;
+using graph::VertexID;
+
+namespace {
+
+std::unique_ptr<GraphSnapshot> SaveAndOpen(const RoadGraph &graph,
+                                           const std::string &name) {
+  const std::string path = ::testing::TempDir() + "/" + name + ".snapshot";
+  if (!GraphSnapshot::Save(graph, path)) {
+    return nullptr;
+  }
+  return GraphSnapshot::Open(path);
+}
+
+// The edges of the route lead from the source to the target, and add up to
+// the cost of the route.
+void ExpectConnected(const GraphSnapshot &snapshot, const SnapshotRoute &route,
+                     VertexID source, VertexID target) {
+  ASSERT_FALSE(route.edges.empty());
+  EXPECT_EQ(source, snapshot.vertices()[snapshot.edges()[route.edges.front()].from].id);
+  EXPECT_EQ(target, snapshot.vertices()[snapshot.edges()[route.edges.back()].to].id);
+  graph::Weight cost = 0;
+  for (size_t i = 0; i < route.edges.size(); ++i) {
+    const SnapshotEdge &edge = snapshot.edges()[route.edges[i]];
+    if (i > 0) {
+      EXPECT_EQ(snapshot.edges()[route.edges[i - 1]].to, edge.from);
+    }
+    cost += edge.weight;
+  }
+  EXPECT_EQ(route.cost, cost);
+}
+
+}  // namespace
+
+TEST(SnapshotDijkstraTest, SampleGraph) {
+  RoadGraph graph = graph::RoadGraphBuilder()
+                        .AddEdge(1, 2, 15.0)
+                        .AddEdge(1, 4, 4.0)
+                        .AddEdge(4, 3, 3.0)
+                        .AddEdge(3, 2, 10.0)
+                        .AddEdge(2, 5, 1.0)
+                        .Build();
+  std::unique_ptr<GraphSnapshot> snapshot = SaveAndOpen(graph, "sample");
+  ASSERT_NE(nullptr, snapshot);
+
+  SnapshotRoute route = RunDijkstra(*snapshot, 1, 5);
+  EXPECT_EQ(16u, route.cost);
+  ASSERT_EQ(2u, route.edges.size());
+  ExpectConnected(*snapshot, route, 1, 5);
+
+  route = RunDijkstra(*snapshot, 1, 3);
+  EXPECT_EQ(7u, route.cost);
+  ExpectConnected(*snapshot, route, 1, 3);
+}
+
+TEST(SnapshotDijkstraTest, NotFound) {
+  RoadGraph graph =
+      graph::RoadGraphBuilder().AddEdge(1, 2, 5.0).AddEdge(3, 4, 5.0).Build();
+  std::unique_ptr<GraphSnapshot> snapshot = SaveAndOpen(graph, "not_found");
+  ASSERT_NE(nullptr, snapshot);
+
+  EXPECT_EQ(graph::kInvalidVertexIndex, snapshot->FindIndex(9));
+  // Unreachable, against the direction of the edge, and unknown.
+  EXPECT_FALSE(RunDijkstra(*snapshot, 1, 4).found());
+  EXPECT_FALSE(RunDijkstra(*snapshot, 2, 1).found());
+  EXPECT_FALSE(RunDijkstra(*snapshot, 1, 9).found());
+  EXPECT_FALSE(RunDijkstra(*snapshot, 9, 1).found());
+
+  SnapshotRoute route = RunDijkstra(*snapshot, 2, 2);
+  EXPECT_EQ(0u, route.cost);
+  EXPECT_TRUE(route.edges.empty());
+}
+
+TEST(SnapshotDijkstraTest, MatchesDijkstra) {
+  std::mt19937 rng(13);
+  std::uniform_int_distribution<VertexID> pick(1, 150);
+  std::uniform_int_distribution<int> length(1, 20);
+  graph::RoadGraphBuilder builder;
+  for (int i = 0; i < 500; ++i) {
+    builder.AddEdge(pick(rng), pick(rng), length(rng));
+  }
+  RoadGraph graph = builder.Build();
+  CsrGraph csr    = CsrGraph::CreateFromRawGraph(graph);
+  std::unique_ptr<GraphSnapshot> snapshot = SaveAndOpen(graph, "random");
+  ASSERT_NE(nullptr, snapshot);
+
+  // All the pairs, in one workspace reused over all the queries.
+  SnapshotSearchWorkspace workspace;
+  for (const Vertex *source : graph.vertices()) {
+    SearchTree expected = RunDijkstra(csr, source->id(), {});
+    for (const Vertex *target : graph.vertices()) {
+      SnapshotRoute route =
+          RunDijkstra(*snapshot, source->id(), target->id(), &workspace);
+      if (source == target) {
+        EXPECT_EQ(0u, route.cost);
+        continue;
+      }
+      const SearchNode *node = expected.Find(target->id());
+      ASSERT_EQ(node != nullptr, route.found());
+      if (node != nullptr) {
+        EXPECT_EQ(node->cost(), route.cost);
+        ExpectConnected(*snapshot, route, source->id(), target->id());
+      }
+    }
+  }
+}
+
+}  // namespace open_semap
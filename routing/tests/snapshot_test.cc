@@ -0,0 +1,112 @@
+#include "graph/snapshot.h"
+
+#include <fstream>
+
+#include "gmock/gmock.h"
+#include "graph/builder.h"
+#include "gtest/gtest.h"
+#include "tests/testdata.h"
+
+namespace open_semap {
+namespace testing {
+
+void ExpectSameGraph(const graph::RoadGraph &expected, const graph::RoadGraph &actual) {
+  ASSERT_EQ(expected.vertices().size(), actual.vertices().size());
+  ASSERT_EQ(expected.edges().size(), actual.edges().size());
+  for (size_t i = 0; i < expected.vertices().size(); ++i) {
+    EXPECT_EQ(expected.vertices()[i]->id(), actual.vertices()[i]->id());
+    EXPECT_EQ(expected.vertices()[i]->loc(), actual.vertices()[i]->loc());
+  }
+  for (size_t i = 0; i < expected.edges().size(); ++i) {
+    const graph::Edge &a = *expected.edges()[i];
+    const graph::Edge &b = *actual.edges()[i];
+    EXPECT_EQ(a.id(), b.id());
+    EXPECT_EQ(a.from().id(), b.from().id());
+    EXPECT_EQ(a.to().id(), b.to().id());
+    EXPECT_DOUBLE_EQ(a.length_, b.length_);
+    EXPECT_EQ(a.cost(), b.cost());
+    EXPECT_EQ(expected.points(a).ToVector(), actual.points(b).ToVector());
+  }
+}
+
+TEST(SnapshotTest, SaveAndOpen) {
+  graph::RoadGraph graph = graph::RoadGraphBuilder()
+                               .AddEdge(1, 2, 3.0)
+                               .AddEdge(2, 3, 4.0)
+                               .AddEdge(3, 1, 5.5)
+                               .Build();
+  const std::string path = ::testing::TempDir() + "/builder.snapshot";
+  ASSERT_TRUE(graph::GraphSnapshot::Save(graph, path));
+
+  std::unique_ptr<graph::GraphSnapshot> snapshot = graph::GraphSnapshot::Open(path);
+  ASSERT_NE(nullptr, snapshot);
+  ASSERT_EQ(3, snapshot->num_vertices());
+  ASSERT_EQ(3, snapshot->num_edges());
+
+  const graph::SnapshotEdge &edge = snapshot->edges()[2];
+  EXPECT_EQ(3, snapshot->vertices()[edge.from].id);
+  EXPECT_EQ(1, snapshot->vertices()[edge.to].id);
+  EXPECT_DOUBLE_EQ(5.5, edge.length);
+  EXPECT_EQ(6, edge.weight);
+
+  ExpectSameGraph(graph, snapshot->ToRoadGraph());
+}
+
+TEST(SnapshotTest, RoundTripRoutingGraph) {
+  graph::RoadGraph graph = graph::RoadGraph::LoadFromFile(std::string(TEST_DATA_PATH) +
+                                                          "/adobe_wells_routes.osm");
+  const std::string path = ::testing::TempDir() + "/adobe_wells.snapshot";
+  ASSERT_TRUE(graph::GraphSnapshot::Save(graph, path));
+
+  std::unique_ptr<graph::GraphSnapshot> snapshot = graph::GraphSnapshot::Open(path);
+  ASSERT_NE(nullptr, snapshot);
+  EXPECT_EQ(44, snapshot->num_vertices());
+  EXPECT_EQ(66, snapshot->num_edges());
+
+  // The geometry is usable straight from the mapping.
+  const graph::SnapshotEdge &edge = snapshot->edges()[0];
+  ASSERT_GE(edge.points_end - edge.points_begin, 2);
+  EXPECT_EQ(snapshot->vertices()[edge.from].loc(), snapshot->points_begin(edge)->loc());
+  EXPECT_EQ(snapshot->vertices()[edge.to].loc(), (snapshot->points_end(edge) - 1)->loc());
+
+  ExpectSameGraph(graph, snapshot->ToRoadGraph());
+}
+
+TEST(SnapshotTest, RejectInvalidFiles) {
+  EXPECT_EQ(nullptr,
+            graph::GraphSnapshot::Open(::testing::TempDir() + "/missing.snapshot"));
+
+  const std::string garbage_path = ::testing::TempDir() + "/garbage.snapshot";
+  {
+    std::ofstream output(garbage_path, std::ios::binary);
+    output << std::string(256, 'x');
+  }
+  EXPECT_EQ(nullptr, graph::GraphSnapshot::Open(garbage_path));
+
+  graph::RoadGraph graph = graph::RoadGraphBuilder().AddEdge(1, 2, 3.0).Build();
+  const std::string path = ::testing::TempDir() + "/versioned.snapshot";
+  ASSERT_TRUE(graph::GraphSnapshot::Save(graph, path));
+
+  // Bump the version.
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t version = graph::kSnapshotVersion + 1;
+    file.seekp(offsetof(graph::SnapshotHeader, version));
+    file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  }
+  EXPECT_EQ(nullptr, graph::GraphSnapshot::Open(path));
+
+  // Truncate.
+  ASSERT_TRUE(graph::GraphSnapshot::Save(graph, path));
+  {
+    std::ifstream input(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(input)),
+                        std::istreambuf_iterator<char>());
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output.write(content.data(), static_cast<std::streamsize>(content.size() - 4));
+  }
+  EXPECT_EQ(nullptr, graph::GraphSnapshot::Open(path));
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -0,0 +1,46 @@
+#include "graph/space_filling_curve.h"
+
+#include <limits>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace open_semap {
+namespace testing {
+
+// One location in each quadrant of the world.
+const osmium::Location kSouthWest(-90.0, -45.0);
+const osmium::Location kNorthWest(-90.0, 45.0);
+const osmium::Location kNorthEast(90.0, 45.0);
+const osmium::Location kSouthEast(90.0, -45.0);
+
+TEST(SpaceFillingCurveTest, HilbertVisitsAdjacentQuadrants) {
+  EXPECT_LT(graph::HilbertKey(kSouthWest), graph::HilbertKey(kNorthWest));
+  EXPECT_LT(graph::HilbertKey(kNorthWest), graph::HilbertKey(kNorthEast));
+  EXPECT_LT(graph::HilbertKey(kNorthEast), graph::HilbertKey(kSouthEast));
+}
+
+TEST(SpaceFillingCurveTest, MortonVisitsQuadrantsInZOrder) {
+  EXPECT_LT(graph::MortonKey(kSouthWest), graph::MortonKey(kSouthEast));
+  EXPECT_LT(graph::MortonKey(kSouthEast), graph::MortonKey(kNorthWest));
+  EXPECT_LT(graph::MortonKey(kNorthWest), graph::MortonKey(kNorthEast));
+}
+
+TEST(SpaceFillingCurveTest, KeepsNearbyLocationsClose) {
+  // Two points 1m apart are much closer on the curve than two points in
+  // different quadrants.
+  osmium::Location a(-121.99, 37.40);
+  osmium::Location b(-121.99001, 37.40);
+  uint64_t near = graph::HilbertKey(a) > graph::HilbertKey(b)
+                      ? graph::HilbertKey(a) - graph::HilbertKey(b)
+                      : graph::HilbertKey(b) - graph::HilbertKey(a);
+  EXPECT_LT(near, graph::HilbertKey(kNorthEast) - graph::HilbertKey(kNorthWest));
+}
+
+TEST(SpaceFillingCurveTest, InvalidLocationsGoLast) {
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), graph::HilbertKey(osmium::Location()));
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), graph::MortonKey(osmium::Location()));
+}
+
+}  // namespace testing
+}  // namespace open_semap
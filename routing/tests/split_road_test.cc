@@ -0,0 +1,44 @@
+#include "utils/split_road.h"
+
+#include <string>
+#include <tuple>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tests/testdata.h"
+#include "utils/extract_junction.h"
+#include "utils/extract_testing.h"
+#include "utils/filter_isolated_roads.h"
+
+namespace open_semap {
+namespace testing {
+
+TEST(SplitRoadTest, SplitWayIdRoundTrip) {
+  for (osmium::object_id_type source : {1, 42, 1234567890, -1, -77}) {
+    for (size_t segment : {0, 1, 2047}) {
+      EXPECT_EQ(source, SourceWayId(SplitWayId(source, segment)));
+    }
+  }
+  EXPECT_NE(SplitWayId(1, 2047), SplitWayId(2, 0));
+}
+
+TEST(SplitRoadTest, OutputDoesNotDependOnThreads) {
+  const std::string path = std::string(TEST_DATA_PATH) + "/adobe_wells.osm";
+
+  IdSet junctions = ExtractJunction(path);
+  IdSet roads;
+  IdSet useful_nodes;
+  std::tie(roads, useful_nodes) = FilterIsolatedRoads(path, junctions);
+
+  const std::string serial_path   = ::testing::TempDir() + "/split_serial.osm";
+  const std::string parallel_path = ::testing::TempDir() + "/split_parallel.osm";
+  SplitRoad(path, serial_path, junctions, roads, useful_nodes, 1);
+  SplitRoad(path, parallel_path, junctions, roads, useful_nodes, 4);
+
+  std::string serial = ReadWholeFile(serial_path);
+  EXPECT_FALSE(serial.empty());
+  EXPECT_EQ(serial, ReadWholeFile(parallel_path));
+}
+
+}  // namespace testing
+}  // namespace open_semap
@@ -1,25 +1,455 @@
 #include "utils/extract_junction.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <thread>
+
 #include "osmium/io/pbf_input.hpp"
 #include "osmium/io/reader_with_progress_bar.hpp"
 #include "osmium/io/xml_input.hpp"
 #include "osmium/visitor.hpp"
 #include "spdlog/spdlog.h"
 
+#include "utils/metrics.h"
 #include "utils/predicates.h"
 
 namespace open_semap {
 
-std::unordered_set<osmium::object_id_type> ExtractJunction(const std::string& path) {
+namespace {
+
+inline size_t ShardOf(osmium::object_id_type id, size_t num_shards) {
+  // Keep the IDs of the same IdSet chunk in the same shard.
+  return (static_cast<uint64_t>(id) >> SparseIdStorage::kChunkBits) % num_shards;
+}
+
+// Collects the node refs of the regular roads in a buffer, grouped by the
+// shard they belong to.
+class ShardedRefCollector : public osmium::handler::Handler {
+ public:
+  ShardedRefCollector(std::vector<std::vector<osmium::object_id_type>>& refs_)
+      : refs(refs_) {
+  }
+
+  void way(const osmium::Way& way) {
+    if (!predicate::IsValidRoad(way)) {
+      return;
+    }
+    for (const auto& node : way.nodes()) {
+      refs.get()[ShardOf(node.ref(), refs.get().size())].emplace_back(node.ref());
+    }
+  }
+
+ private:
+  std::reference_wrapper<std::vector<std::vector<osmium::object_id_type>>> refs;
+};
+
+// Refs are stored as unsigned keys with the sign bit flipped, so that the
+// unsigned order of the keys is the same as the order of the IDs.
+inline uint64_t RefToKey(osmium::object_id_type ref) {
+  return static_cast<uint64_t>(ref) ^ (uint64_t{1} << 63);
+}
+
+inline osmium::object_id_type KeyToRef(uint64_t key) {
+  return static_cast<osmium::object_id_type>(key ^ (uint64_t{1} << 63));
+}
+
+// A run that cannot be written or read back in full would silently drop
+// junctions, and every later stage would build a wrong graph. So the I/O
+// errors on the runs are fatal.
+[[noreturn]] void AbortOnRunError(const char* action, const std::string& path) {
+  spdlog::critical("Cannot {} {}: {}", action, path, std::strerror(errno));
+  std::abort();
+}
+
+// Writes ascending keys as varint encoded deltas. Neighboring node IDs are
+// close to each other, so most of the keys take 1 or 2 bytes on disk.
+class RunWriter {
+ public:
+  explicit RunWriter(const std::string& path)
+      : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+    if (file_ == nullptr) {
+      AbortOnRunError("open for writing", path_);
+    }
+    buffer_.reserve(kBufferSize + 16);
+  }
+
+  ~RunWriter() {
+    Close();
+  }
+
+  inline void Write(uint64_t key) {
+    uint64_t delta = key - previous_;
+    previous_      = key;
+    while (delta >= 0x80) {
+      buffer_.push_back(static_cast<uint8_t>(delta | 0x80));
+      delta >>= 7;
+    }
+    buffer_.push_back(static_cast<uint8_t>(delta));
+    if (buffer_.size() >= kBufferSize) {
+      Flush();
+    }
+  }
+
+  // Returns the number of bytes written to the file.
+  size_t Close() {
+    if (file_ != nullptr) {
+      Flush();
+      int result = std::fclose(file_);
+      file_      = nullptr;
+      if (result != 0) {
+        AbortOnRunError("close", path_);
+      }
+    }
+    return bytes_written_;
+  }
+
+ private:
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  void Flush() {
+    if (file_ != nullptr && !buffer_.empty()) {
+      size_t written = std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+      if (written != buffer_.size()) {
+        AbortOnRunError("write", path_);
+      }
+      bytes_written_ += written;
+    }
+    buffer_.clear();
+  }
+
+  std::string path_;
+  std::FILE* file_;
+  std::vector<uint8_t> buffer_{};
+  uint64_t previous_    = 0;
+  size_t bytes_written_ = 0;
+};
+
+class RunReader {
+ public:
+  RunReader(const std::string& path, size_t buffer_size)
+      : path_(path), file_(std::fopen(path.c_str(), "rb")), buffer_(buffer_size) {
+    if (file_ == nullptr) {
+      AbortOnRunError("open for reading", path_);
+    }
+  }
+
+  ~RunReader() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  // Returns false at the end of the run.
+  inline bool Next(uint64_t* key) {
+    uint64_t delta = 0;
+    int shift      = 0;
+    while (true) {
+      if (position_ == size_ && !Refill()) {
+        return false;
+      }
+      uint8_t byte = buffer_[position_++];
+      delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+      shift += 7;
+    }
+    previous_ += delta;
+    *key = previous_;
+    return true;
+  }
+
+ private:
+  bool Refill() {
+    if (file_ == nullptr) {
+      return false;
+    }
+    size_     = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+    position_ = 0;
+    if (std::ferror(file_) != 0) {
+      AbortOnRunError("read", path_);
+    }
+    return size_ > 0;
+  }
+
+  std::string path_;
+  std::FILE* file_;
+  std::vector<uint8_t> buffer_;
+  size_t size_       = 0;
+  size_t position_   = 0;
+  uint64_t previous_ = 0;
+};
+
+// Buffers the node refs of the regular roads, and writes them to disk as a
+// sorted run whenever the buffer is full.
+class RunSpillHandler : public osmium::handler::Handler {
+ public:
+  RunSpillHandler(const std::string& tmp_dir_, size_t capacity_)
+      : tmp_dir(tmp_dir_), capacity(capacity_) {
+    keys.reserve(capacity);
+  }
+
+  void way(const osmium::Way& way) {
+    if (!predicate::IsValidRoad(way)) {
+      return;
+    }
+    for (const auto& node : way.nodes()) {
+      keys.push_back(RefToKey(node.ref()));
+      if (keys.size() == capacity) {
+        Spill();
+      }
+    }
+    num_refs += way.nodes().size();
+  }
+
+  // Sorts the buffered keys and writes them as a run. A key that appears more
+  // than once in the buffer is written exactly twice, which is all the merge
+  // needs to know.
+  void Spill() {
+    std::sort(keys.begin(), keys.end());
+    std::string path = tmp_dir + "/open_semap_junctions." + std::to_string(::getpid()) +
+                       "." + std::to_string(run_paths.size()) + ".run";
+    RunWriter writer(path);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (i >= 2 && keys[i] == keys[i - 2]) {
+        continue;
+      }
+      writer.Write(keys[i]);
+    }
+    bytes_on_disk += writer.Close();
+    run_paths.emplace_back(std::move(path));
+    keys.clear();
+  }
+
+  // Computes the junctions from the buffered keys directly. Only valid when
+  // nothing has been spilled, i.e. all the refs fit in the memory budget.
+  IdSet JunctionsInMemory() {
+    std::sort(keys.begin(), keys.end());
+    IdSet junctions;
+    for (size_t i = 1; i < keys.size(); ++i) {
+      if (keys[i] == keys[i - 1]) {
+        junctions.insert(KeyToRef(keys[i]));
+      }
+    }
+    return junctions;
+  }
+
+  // Spills the remaining keys, and releases the buffer.
+  void Finish() {
+    if (!keys.empty()) {
+      Spill();
+    }
+    std::vector<uint64_t>().swap(keys);
+  }
+
+  const std::vector<std::string>& RunPaths() const {
+    return run_paths;
+  }
+
+  size_t NumRefs() const {
+    return num_refs;
+  }
+
+  size_t BytesOnDisk() const {
+    return bytes_on_disk;
+  }
+
+ private:
+  std::string tmp_dir;
+  size_t capacity;
+  std::vector<uint64_t> keys{};
+  std::vector<std::string> run_paths{};
+  size_t num_refs      = 0;
+  size_t bytes_on_disk = 0;
+};
+
+// K-way merge of the runs. A key is a junction if it appears at least twice
+// across all the runs.
+IdSet MergeRuns(const std::vector<std::string>& paths, size_t buffer_size) {
+  std::vector<std::unique_ptr<RunReader>> readers;
+  using Entry = std::pair<uint64_t, size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    readers.emplace_back(std::make_unique<RunReader>(paths[i], buffer_size));
+    uint64_t key = 0;
+    if (readers.back()->Next(&key)) {
+      heap.emplace(key, i);
+    }
+  }
+
+  IdSet junctions;
+  while (!heap.empty()) {
+    uint64_t key = heap.top().first;
+    int count    = 0;
+    while (!heap.empty() && heap.top().first == key) {
+      size_t run = heap.top().second;
+      heap.pop();
+      ++count;
+      uint64_t next = 0;
+      if (readers[run]->Next(&next)) {
+        heap.emplace(next, run);
+      }
+    }
+    if (count >= 2) {
+      junctions.insert(KeyToRef(key));
+    }
+  }
+  return junctions;
+}
+
+void RecordSetSizes(const IdSet& junctions, const IdSet& road_nodes, ScopedStage* stage) {
+  stage->SetSize("junctions", junctions.size());
+  stage->SetSize("junctions_bytes", junctions.UsedMemory());
+  if (!road_nodes.empty()) {
+    stage->SetSize("road_nodes", road_nodes.size());
+    stage->SetSize("road_nodes_bytes", road_nodes.UsedMemory());
+  }
+}
+
+std::pair<IdSet, IdSet> RunExtractJunction(const std::string& path, int num_threads,
+                                           bool keep_road_nodes) {
   spdlog::info("Extracting junction nodes.");
   osmium::io::File input_file(path);
   // Only process the ways.
   osmium::io::ReaderWithProgressBar reader(true, input_file,
                                            osmium::osm_entity_bits::way);
-  ExtractJunctionHandler extract_junction;
-  osmium::apply(reader, extract_junction);
+
+  ScopedStage stage("extract_junction");
+  stage.SetSize("threads", static_cast<uint64_t>(std::max(num_threads, 1)));
+
+  if (num_threads <= 1) {
+    ExtractJunctionHandler extract_junction;
+    ObjectCountHandler count;
+    osmium::apply(reader, extract_junction, count);
+    stage.AddObjects(count.Count());
+    stage.AddBytesRead(reader.offset());
+    reader.close();
+    extract_junction.LogMemoryUsage();
+    IdSet junctions  = extract_junction.ReleaseJunctions();
+    IdSet road_nodes = keep_road_nodes ? extract_junction.ReleaseVisited() : IdSet();
+    RecordSetSizes(junctions, road_nodes, &stage);
+    return std::make_pair(std::move(junctions), std::move(road_nodes));
+  }
+
+  // More shards than threads to keep the lock contention low.
+  ShardedJunctionCounter counter(static_cast<size_t>(num_threads) * 8);
+  std::mutex reader_mutex;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_threads; ++i) {
+    workers.emplace_back([&reader, &reader_mutex, &counter, &stage]() {
+      ObjectCountHandler count;
+      while (true) {
+        osmium::memory::Buffer buffer;
+        {
+          std::lock_guard<std::mutex> lock(reader_mutex);
+          buffer = reader.read();
+        }
+        if (!buffer) {
+          break;
+        }
+        counter.Process(buffer);
+        osmium::apply(buffer, count);
+      }
+      stage.AddObjects(count.Count());
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  stage.AddBytesRead(reader.offset());
   reader.close();
-  return extract_junction.ReleaseJunctions();
+
+  IdSet junctions  = counter.ReleaseJunctions();
+  IdSet road_nodes = keep_road_nodes ? counter.ReleaseVisited() : IdSet();
+  spdlog::info("ExtractJunction: {} junctions with {} threads.", junctions.size(),
+               num_threads);
+  RecordSetSizes(junctions, road_nodes, &stage);
+  return std::make_pair(std::move(junctions), std::move(road_nodes));
+}
+
+}  // namespace
+
+IdSet ExtractJunction(const std::string& path, int num_threads) {
+  return RunExtractJunction(path, num_threads, false).first;
+}
+
+std::pair<IdSet, IdSet> ExtractJunctionAndRoadNodes(const std::string& path,
+                                                    int num_threads) {
+  return RunExtractJunction(path, num_threads, true);
+}
+
+IdSet ExtractJunctionExternal(const std::string& path,
+                              const ExternalMemoryOptions& options) {
+  spdlog::info("Extracting junction nodes with a memory budget of {} MB.",
+               options.memory_budget >> 20);
+  // Leave a quarter of the budget for the decoding buffers of the reader.
+  constexpr size_t kMinRunSize = 1024;
+  size_t run_size =
+      options.run_size > 0
+          ? options.run_size
+          : std::max(options.memory_budget / 4 * 3 / sizeof(uint64_t), kMinRunSize);
+
+  ScopedStage stage("extract_junction_external");
+  stage.SetSize("memory_budget_bytes", options.memory_budget);
+  stage.SetSize("run_size", run_size);
+
+  RunSpillHandler spill(options.tmp_dir, run_size);
+  {
+    osmium::io::File input_file(path);
+    osmium::io::ReaderWithProgressBar reader(true, input_file,
+                                             osmium::osm_entity_bits::way);
+    ObjectCountHandler count;
+    osmium::apply(reader, spill, count);
+    stage.AddObjects(count.Count());
+    stage.AddBytesRead(reader.offset());
+    reader.close();
+  }
+  stage.SetSize("refs", spill.NumRefs());
+
+  if (spill.RunPaths().empty()) {
+    IdSet junctions = spill.JunctionsInMemory();
+    spdlog::info("ExtractJunctionExternal: {} refs fit in memory, {} junctions.",
+                 spill.NumRefs(), junctions.size());
+    RecordSetSizes(junctions, IdSet(), &stage);
+    return junctions;
+  }
+
+  spill.Finish();
+
+  // The run buffer is released, so the read buffers of the merge can take half
+  // of the budget, leaving the other half for the junctions.
+  size_t buffer_size = std::min<size_t>(
+      std::max<size_t>(options.memory_budget / 2 / spill.RunPaths().size(), 4096),
+      16 << 20);
+  IdSet junctions = MergeRuns(spill.RunPaths(), buffer_size);
+  for (const std::string& run_path : spill.RunPaths()) {
+    std::remove(run_path.c_str());
+  }
+
+  spdlog::info(
+      "ExtractJunctionExternal: {} refs in {} runs ({} MB on disk), {} junctions ({} "
+      "MB).",
+      spill.NumRefs(), spill.RunPaths().size(), spill.BytesOnDisk() >> 20,
+      junctions.size(), junctions.UsedMemory() >> 20);
+  stage.SetSize("runs", spill.RunPaths().size());
+  stage.SetSize("run_bytes", spill.BytesOnDisk());
+  RecordSetSizes(junctions, IdSet(), &stage);
+  if (junctions.UsedMemory() > options.memory_budget) {
+    spdlog::warn("The junctions alone take {} MB, which exceeds the memory budget.",
+                 junctions.UsedMemory() >> 20);
+  }
+  // The stage records its peak RSS as well, but only once it ends.
+  spdlog::info("ExtractJunctionExternal: peak RSS {} MB against a budget of {} MB.",
+               PeakRssBytes() >> 20, options.memory_budget >> 20);
+  return junctions;
 }
 
 void ExtractJunctionHandler::way(const osmium::Way& way) {
@@ -28,12 +458,63 @@ void ExtractJunctionHandler::way(const osmium::Way& way) {
   }
 
   for (const auto& node : way.nodes()) {
-    if (visited.count(node.ref()) > 0) {
-      junctions.emplace(node.ref());
-    } else {
-      visited.emplace(node.ref());
+    // A node seen for the second time is a junction.
+    if (!visited.insert(node.ref())) {
+      junctions.insert(node.ref());
+    }
+  }
+}
+
+void ExtractJunctionHandler::LogMemoryUsage() const {
+  spdlog::info("ExtractJunction: {} visited nodes ({} MB, {}), {} junctions ({} MB, {}).",
+               visited.size(), visited.UsedMemory() >> 20,
+               visited.IsDense() ? "dense" : "sparse", junctions.size(),
+               junctions.UsedMemory() >> 20, junctions.IsDense() ? "dense" : "sparse");
+}
+
+ShardedJunctionCounter::ShardedJunctionCounter(size_t num_shards) {
+  for (size_t i = 0; i < std::max<size_t>(num_shards, 1); ++i) {
+    shards_.emplace_back(std::make_unique<Shard>());
+  }
+}
+
+void ShardedJunctionCounter::Process(osmium::memory::Buffer& buffer) {
+  // Group the refs by shard first, so that each shard is locked only once per
+  // buffer.
+  std::vector<std::vector<osmium::object_id_type>> refs(shards_.size());
+  ShardedRefCollector collector(refs);
+  osmium::apply(buffer, collector);
+
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    if (refs[i].empty()) {
+      continue;
     }
+    Shard& shard = *shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (osmium::object_id_type ref : refs[i]) {
+      if (!shard.visited.insert(ref)) {
+        shard.junctions.insert(ref);
+      }
+    }
+  }
+}
+
+IdSet ShardedJunctionCounter::ReleaseJunctions() {
+  IdSet result;
+  for (std::unique_ptr<Shard>& shard : shards_) {
+    shard->junctions.ForEach([&result](osmium::object_id_type id) { result.insert(id); });
+    shard->junctions = IdSet();
+  }
+  return result;
+}
+
+IdSet ShardedJunctionCounter::ReleaseVisited() {
+  IdSet result;
+  for (std::unique_ptr<Shard>& shard : shards_) {
+    shard->visited.ForEach([&result](osmium::object_id_type id) { result.insert(id); });
+    shard->visited = IdSet();
   }
+  return result;
 }
 
 }  // namespace open_semap
@@ -1,22 +1,64 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "osmium/handler.hpp"
+#include "osmium/memory/buffer.hpp"
 #include "osmium/osm.hpp"
 
+#include "utils/id_set.h"
+
 namespace open_semap {
 
 // Main API of this library. Extract all the junction nodes and returns a set of
 // their IDs. A node is called a junction node if it appears in more than one
 // regular roads.
-std::unordered_set<osmium::object_id_type> ExtractJunction(const std::string& path);
+//
+// When `num_threads` is greater than 1, the decoded buffers are processed by
+// that many threads at the same time with a ShardedJunctionCounter. The result
+// is exactly the same as the single threaded one.
+IdSet ExtractJunction(const std::string& path, int num_threads = 1);
+
+// Same as above, but also returns all the nodes that appear on at least one
+// regular road (the first of the pair is the junctions).
+std::pair<IdSet, IdSet> ExtractJunctionAndRoadNodes(const std::string& path,
+                                                    int num_threads = 1);
+
+struct ExternalMemoryOptions {
+  // Memory used to buffer the node refs before they are written to disk, in
+  // bytes. It also bounds the read buffers of the merge.
+  size_t memory_budget = size_t{1} << 30;
+  // Where the sorted runs are written. They are removed after the merge.
+  std::string tmp_dir = "/tmp";
+  // The number of node refs buffered per run. 0 derives it from the memory
+  // budget. Tests set it to spill small inputs into several runs, which a
+  // budget alone cannot do since a run holds at least 1024 refs.
+  size_t run_size = 0;
+};
+
+// External-memory counterpart of ExtractJunction(), for machines that cannot
+// hold all the road nodes in memory. The node refs of the regular roads are
+// buffered up to the memory budget, sorted and written to disk as delta encoded
+// runs. The runs are then merged to find the refs that appear more than once.
+//
+// Only the junctions, which are a small fraction of the road nodes, are held in
+// memory in the end. The result is exactly the same as ExtractJunction().
+//
+// The budget only covers this stage. FilterIsolatedRoads() and SplitRoad() still
+// keep their ID sets and node locations in memory, so a whole extract_routes
+// run at planet scale goes well past the budget.
+//
+// The number of runs, the run size and the peak RSS of the extraction are
+// recorded against the budget in the "extract_junction_external" stage.
+IdSet ExtractJunctionExternal(const std::string& path,
+                              const ExternalMemoryOptions& options);
 
 class ExtractJunctionHandler : public osmium::handler::Handler {
  public:
-  using IdSet = std::unordered_set<osmium::object_id_type>;
-
   ExtractJunctionHandler() = default;
 
   void way(const osmium::Way& way);
@@ -25,9 +67,47 @@ class ExtractJunctionHandler : public osmium::handler::Handler {
     return std::move(junctions);
   }
 
+  // Logs the size and the memory footprint of the ID sets.
+  void LogMemoryUsage() const;
+
+  // All the nodes that appear on at least one regular road. This is a
+  // superset of the junctions.
+  IdSet ReleaseVisited() {
+    return std::move(visited);
+  }
+
  private:
   IdSet visited;
   IdSet junctions;
 };
 
+// Thread-safe counterpart of ExtractJunctionHandler. The node IDs are sharded
+// by their high bits and every shard has its own lock, so that several
+// buffers can be processed at the same time. Since whether a node is a
+// junction only depends on how many times it appears on regular roads, the
+// order in which the buffers are processed does not matter.
+class ShardedJunctionCounter {
+ public:
+  explicit ShardedJunctionCounter(size_t num_shards);
+
+  // Thread-safe. Process all the ways in the buffer.
+  void Process(osmium::memory::Buffer& buffer);
+
+  // Merge the shards. Not thread-safe, call them after all the buffers are
+  // processed.
+  IdSet ReleaseJunctions();
+  IdSet ReleaseVisited();
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    // Each shard only holds a fraction of the ID space, which is better
+    // served by the sparse backend.
+    IdSet visited{IdSetBackend::kSparse};
+    IdSet junctions{IdSetBackend::kSparse};
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
 }  // namespace open_semap
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/id_set.h"
+
+namespace open_semap {
+
+// Shared by the tests of the extract_routes stages. Only include it from the
+// tests.
+//
+// The IDs of the set, in the order IdSet::ForEach() visits them.
+inline std::vector<osmium::object_id_type> CollectIds(const IdSet& set) {
+  std::vector<osmium::object_id_type> result;
+  set.ForEach([&result](osmium::object_id_type id) { result.emplace_back(id); });
+  return result;
+}
+
+// The bytes of the file, to compare the outputs of two runs.
+inline std::string ReadWholeFile(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << input.rdbuf();
+  return buffer.str();
+}
+
+}  // namespace open_semap
@@ -6,26 +6,33 @@
 #include "osmium/visitor.hpp"
 #include "spdlog/spdlog.h"
 
+#include "utils/metrics.h"
+
 namespace open_semap {
 
-std::unordered_set<osmium::object_id_type> FilterBoundingBox(
-    const std::string& path, const std::unordered_set<osmium::object_id_type>& junctions,
-    const osmium::Box& bounding_box) {
+IdSet FilterBoundingBox(const std::string& path, const IdSet& junctions,
+                        const osmium::Box& bounding_box) {
   spdlog::info("Filtering based on bounding box.");
   osmium::io::File input_file(path);
   // Only process the ways.
   osmium::io::ReaderWithProgressBar reader(true, input_file,
                                            osmium::osm_entity_bits::node);
+  ScopedStage stage("filter_bounding_box");
   FilterBoundingBoxHandler handler(junctions, bounding_box);
-  osmium::apply(reader, handler);
+  ObjectCountHandler count;
+  osmium::apply(reader, handler, count);
+  stage.AddObjects(count.Count());
+  stage.AddBytesRead(reader.offset());
   reader.close();
+  stage.SetSize("junctions", handler.FilteredJunctions().size());
+  stage.SetSize("junctions_bytes", handler.FilteredJunctions().UsedMemory());
   return handler.ReleaseJunctions();
 }
 
 void FilterBoundingBoxHandler::node(const osmium::Node& node) {
   if (bounding_box.contains(node.location())) {
     if (junctions.get().count(node.id()) > 0) {
-      filtered_junctions.emplace(node.id());
+      filtered_junctions.insert(node.id());
     }
   }
 }
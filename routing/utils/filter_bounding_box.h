@@ -2,23 +2,21 @@
 
 #include <functional>
 #include <string>
-#include <unordered_set>
 
 #include "osmium/handler.hpp"
 #include "osmium/osm.hpp"
 
+#include "utils/id_set.h"
+
 namespace open_semap {
 
 // Main API of this library. Filter the list of junction nodes, and
 // keep only the ones that are within the bounding box.
-std::unordered_set<osmium::object_id_type> FilterBoundingBox(
-    const std::string& path, const std::unordered_set<osmium::object_id_type>& junctions,
-    const osmium::Box& bounding_box);
+IdSet FilterBoundingBox(const std::string& path, const IdSet& junctions,
+                        const osmium::Box& bounding_box);
 
 class FilterBoundingBoxHandler : public osmium::handler::Handler {
  public:
-  using IdSet = std::unordered_set<osmium::object_id_type>;
-
   FilterBoundingBoxHandler(const IdSet& junctions_, const osmium::Box& bounding_box_)
       : junctions(junctions_), bounding_box(bounding_box_) {
   }
@@ -29,6 +27,10 @@ class FilterBoundingBoxHandler : public osmium::handler::Handler {
     return std::move(filtered_junctions);
   }
 
+  const IdSet& FilteredJunctions() const {
+    return filtered_junctions;
+  }
+
  private:
   std::reference_wrapper<const IdSet> junctions;
   osmium::Box bounding_box;
@@ -6,22 +6,29 @@
 #include "osmium/visitor.hpp"
 #include "spdlog/spdlog.h"
 
+#include "utils/metrics.h"
 #include "utils/predicates.h"
 
 namespace open_semap {
 
-std::pair<std::unordered_set<osmium::object_id_type>,
-          std::unordered_set<osmium::object_id_type>>
-FilterIsolatedRoads(const std::string& path,
-                    const std::unordered_set<osmium::object_id_type>& junctions) {
+std::pair<IdSet, IdSet> FilterIsolatedRoads(const std::string& path,
+                                            const IdSet& junctions) {
   spdlog::info("Prcoessing ways to filter out isolated roads.");
   osmium::io::File input_file(path);
   // Only process the ways.
   osmium::io::ReaderWithProgressBar reader(true, input_file,
                                            osmium::osm_entity_bits::way);
+  ScopedStage stage("filter_isolated_roads");
   FilterIsolatedRoadsHandler filter(junctions);
-  osmium::apply(reader, filter);
+  ObjectCountHandler count;
+  osmium::apply(reader, filter, count);
+  stage.AddObjects(count.Count());
+  stage.AddBytesRead(reader.offset());
   reader.close();
+  stage.SetSize("roads", filter.InterConnectedRoads().size());
+  stage.SetSize("roads_bytes", filter.InterConnectedRoads().UsedMemory());
+  stage.SetSize("useful_nodes", filter.UsefulNodes().size());
+  stage.SetSize("useful_nodes_bytes", filter.UsefulNodes().UsedMemory());
   return filter.ReleaseResult();
 }
 
@@ -33,7 +40,7 @@ void FilterIsolatedRoadsHandler::way(const osmium::Way& way) {
   bool hit = false;
   for (const auto& node : way.nodes()) {
     if (junctions.get().count(node.ref()) > 0) {
-      inter_connected_roads.emplace(way.id());
+      inter_connected_roads.insert(way.id());
       hit = true;
       break;
     }
@@ -41,7 +48,7 @@ void FilterIsolatedRoadsHandler::way(const osmium::Way& way) {
 
   if (hit) {
     for (const auto& node : way.nodes()) {
-      useful_nodes.emplace(node.ref());
+      useful_nodes.insert(node.ref());
     }
   }
 }
@@ -2,27 +2,24 @@
 
 #include <functional>
 #include <string>
-#include <unordered_set>
 #include <utility>
 
 #include "osmium/handler.hpp"
 #include "osmium/osm.hpp"
 
+#include "utils/id_set.h"
+
 namespace open_semap {
 
 // Main API of this library. Go through all the ways in the OSM file
 // and returns a set of roads that are inter-connected with each
 // other, i.e. isolated roads are filtered out. Isolated roads are
 // regular roads that do not contain any junction nodes.
-std::pair<std::unordered_set<osmium::object_id_type>,
-          std::unordered_set<osmium::object_id_type>>
-FilterIsolatedRoads(const std::string& path,
-                    const std::unordered_set<osmium::object_id_type>& junctions);
+std::pair<IdSet, IdSet> FilterIsolatedRoads(const std::string& path,
+                                            const IdSet& junctions);
 
 class FilterIsolatedRoadsHandler : public osmium::handler::Handler {
  public:
-  using IdSet = std::unordered_set<osmium::object_id_type>;
-
   FilterIsolatedRoadsHandler(const IdSet& junctions_) : junctions(junctions_) {
   }
 
@@ -32,6 +29,14 @@ class FilterIsolatedRoadsHandler : public osmium::handler::Handler {
     return std::make_pair(std::move(inter_connected_roads), std::move(useful_nodes));
   }
 
+  const IdSet& InterConnectedRoads() const {
+    return inter_connected_roads;
+  }
+
+  const IdSet& UsefulNodes() const {
+    return useful_nodes;
+  }
+
  private:
   std::reference_wrapper<const IdSet> junctions;
   IdSet inter_connected_roads{};
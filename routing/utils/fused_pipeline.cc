@@ -0,0 +1,161 @@
+#include "utils/fused_pipeline.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "osmium/io/pbf_input.hpp"
+#include "osmium/io/pbf_output.hpp"
+#include "osmium/io/reader_with_progress_bar.hpp"
+#include "osmium/io/xml_input.hpp"
+#include "osmium/io/xml_output.hpp"
+#include "osmium/memory/buffer.hpp"
+#include "osmium/visitor.hpp"
+#include "spdlog/spdlog.h"
+
+#include "utils/filter_bounding_box.h"
+#include "utils/filter_isolated_roads.h"
+#include "utils/metrics.h"
+#include "utils/split_road.h"
+
+namespace open_semap {
+
+namespace {
+
+// Only forwards the ways to the SplitRoadHandler. The nodes are handled at the
+// end of the pass, when the useful nodes are fully known.
+class SplitWayHandler : public osmium::handler::Handler {
+ public:
+  SplitWayHandler(SplitRoadHandler& split_) : split(split_) {
+  }
+
+  void way(const osmium::Way& way) {
+    split.get().way(way);
+  }
+
+ private:
+  std::reference_wrapper<SplitRoadHandler> split;
+};
+
+void WriteStashedNodes(const std::vector<NodeStashHandler::StashedNode>& nodes,
+                       const IdSet& junctions,
+                       const IdSet& useful_nodes,
+                       osmium::io::Writer* writer) {
+  constexpr size_t kDefaultBufferSize = 1024 * 1024;  // By default, 1MB per buffer.
+  constexpr size_t kNumPerBuffer      = 8192;         // Maximum nodes per buffer.
+
+  size_t i = 0;
+  while (i < nodes.size()) {
+    osmium::memory::Buffer output_buffer(kDefaultBufferSize,
+                                         osmium::memory::Buffer::auto_grow::yes);
+    size_t end = std::min(i + kNumPerBuffer, nodes.size());
+    for (; i < end; ++i) {
+      const NodeStashHandler::StashedNode& node = nodes[i];
+      WriteRoadNode(node.id, node.uid, node.location, junctions, useful_nodes,
+                    &output_buffer);
+    }
+    (*writer)(std::move(output_buffer));
+  }
+}
+
+}  // namespace
+
+void NodeStashHandler::node(const osmium::Node& node) {
+  if (road_nodes.get().count(node.id()) > 0) {
+    nodes.push_back(StashedNode{node.id(), node.uid(), node.location()});
+    if (!locations_sorted) {
+      locations.set(static_cast<osmium::unsigned_object_id_type>(node.id()),
+                    node.location());
+    }
+  }
+}
+
+void NodeStashHandler::SortLocations() {
+  locations.sort();
+  locations_sorted = true;
+}
+
+FusedPipelineStats ExtractRoutesFused(const std::string& path,
+                                      const std::string& output_path,
+                                      const osmium::Box& bounding_box,
+                                      int num_threads) {
+  // Pass 1: ways only.
+  spdlog::info("Fused pass 1/2: extracting junction nodes.");
+  IdSet junctions;
+  IdSet road_nodes;
+  std::tie(junctions, road_nodes) = ExtractJunctionAndRoadNodes(path, num_threads);
+
+  // Pass 2: nodes and ways.
+  spdlog::info("Fused pass 2/2: filtering and splitting roads.");
+  ScopedStage stage("fused_split");
+  osmium::io::File input_file(path);
+  osmium::io::ReaderWithProgressBar reader(
+      true, input_file, osmium::osm_entity_bits::way | osmium::osm_entity_bits::node);
+
+  // Construct the writer.
+  osmium::io::Header header = reader.header();
+  header.set("generator", "routing_graph");
+  osmium::io::Writer writer(output_path, header, osmium::io::overwrite::allow);
+
+  FilterBoundingBoxHandler filter_bounding_box(junctions, bounding_box);
+  NodeStashHandler stash(road_nodes);
+  FilterIsolatedRoadsHandler filter_isolated_roads(
+      filter_bounding_box.FilteredJunctions());
+  std::vector<osmium::memory::Buffer> way_buffers;
+  bool ways_started = false;
+  ObjectCountHandler count;
+
+  while (osmium::memory::Buffer input_buffer = reader.read()) {
+    // The nodes of the buffer are stashed before any of its ways is split. The
+    // same buffer may hold both (e.g. from XML input), and since the nodes
+    // come before the ways, this does not change what the handlers see.
+    osmium::apply(input_buffer, filter_bounding_box, stash, count);
+    if (!ways_started && BufferHasWays(input_buffer)) {
+      // The location index is complete from here.
+      stash.SortLocations();
+      ways_started = true;
+    }
+
+    // Allow output buffer to grow if needed.
+    osmium::memory::Buffer output_buffer(input_buffer.committed(),
+                                         osmium::memory::Buffer::auto_grow::yes);
+    // NOTE: A fresh SplitRoadHandler per buffer, exactly as SplitRoad() does.
+    SplitRoadHandler split(filter_bounding_box.FilteredJunctions(),
+                           filter_isolated_roads.InterConnectedRoads(),
+                           filter_isolated_roads.UsefulNodes(), output_buffer,
+                           &stash.Locations());
+    SplitWayHandler split_way(split);
+    // The isolated road filter must see a way before the splitter does, so
+    // that the splitter knows whether the way is approved.
+    osmium::apply(input_buffer, filter_isolated_roads, split_way);
+    if (output_buffer.committed() > 0) {
+      way_buffers.emplace_back(std::move(output_buffer));
+    }
+  }
+  stage.AddObjects(count.Count());
+  stage.AddBytesRead(reader.offset());
+  reader.close();
+
+  // Road nodes are no longer needed, release the memory before writing.
+  road_nodes = IdSet();
+
+  WriteStashedNodes(stash.Nodes(), filter_bounding_box.FilteredJunctions(),
+                    filter_isolated_roads.UsefulNodes(), &writer);
+  for (osmium::memory::Buffer& buffer : way_buffers) {
+    writer(std::move(buffer));
+  }
+  stage.SetSize("output_bytes", writer.close());
+
+  FusedPipelineStats stats;
+  stats.num_useful_nodes = filter_isolated_roads.UsefulNodes().size();
+  stats.num_junctions    = filter_bounding_box.FilteredJunctions().size();
+  stats.num_roads        = filter_isolated_roads.InterConnectedRoads().size();
+  stage.SetSize("stashed_nodes", stash.Nodes().size());
+  stage.SetSize("junctions", stats.num_junctions);
+  stage.SetSize("roads", stats.num_roads);
+  stage.SetSize("useful_nodes", stats.num_useful_nodes);
+  stage.SetSize("useful_nodes_bytes", filter_isolated_roads.UsefulNodes().UsedMemory());
+  return stats;
+}
+
+}  // namespace open_semap
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "osmium/handler.hpp"
+#include "osmium/osm.hpp"
+
+#include "utils/extract_junction.h"
+#include "utils/split_road.h"
+
+namespace open_semap {
+
+struct FusedPipelineStats {
+  size_t num_useful_nodes = 0;
+  size_t num_junctions    = 0;
+  size_t num_roads        = 0;
+};
+
+// Main API of this library. Produces exactly the same routing graph as running
+// ExtractJunction, FilterBoundingBox, FilterIsolatedRoads and SplitRoad one
+// after another, but decodes the input only twice instead of four times.
+//
+// 1. The first pass reads the ways only and extracts the junctions, with
+//    `num_threads` threads.
+//
+// 2. The second pass reads nodes and ways. Bounding box filtering, isolated
+//    road filtering and road splitting run together on each decoded buffer.
+//
+// Because the nodes have to be written before the ways while the set of useful
+// nodes is only known after all the ways are seen, the nodes on regular roads
+// and the split ways are held in memory until the end of the second pass. That
+// is 40 bytes per road node (24 for the stashed node, 16 for its location),
+// plus the split ways in osmium's in-memory layout, which takes more room than
+// the same ways written out. For the planet this adds up to tens of GB. The
+// four passes only hold ID sets and the locations of the useful nodes.
+//
+// The input is expected to be sorted, i.e. all the nodes come before the ways,
+// which is the case for the files distributed by OSM.
+FusedPipelineStats ExtractRoutesFused(const std::string& path,
+                                      const std::string& output_path,
+                                      const osmium::Box& bounding_box,
+                                      int num_threads = 1);
+
+// Remembers the nodes that appear on regular roads during the second pass, so
+// that they can be written out after the useful nodes are known. Their
+// locations are also indexed for computing the lengths of the split roads,
+// until the index is sorted.
+class NodeStashHandler : public osmium::handler::Handler {
+ public:
+  struct StashedNode {
+    osmium::object_id_type id;
+    osmium::user_id_type uid;
+    osmium::Location location;
+  };
+
+  NodeStashHandler(const IdSet& road_nodes_) : road_nodes(road_nodes_) {
+  }
+
+  void node(const osmium::Node& node);
+
+  const std::vector<StashedNode>& Nodes() const {
+    return nodes;
+  }
+
+  // Sorts the location index, which is read only from then on. The nodes
+  // stashed afterwards are still written, but their locations are not
+  // indexed, the same way as SplitRoad() does with unsorted input.
+  void SortLocations();
+
+  const NodeLocations& Locations() const {
+    return locations;
+  }
+
+ private:
+  std::reference_wrapper<const IdSet> road_nodes;
+  std::vector<StashedNode> nodes{};
+  NodeLocations locations{};
+  bool locations_sorted = false;
+};
+
+}  // namespace open_semap
@@ -0,0 +1,130 @@
+#include "utils/id_set.h"
+
+#include <algorithm>
+
+namespace open_semap {
+
+// ==================== DenseIdStorage ====================
+
+void DenseIdStorage::Grow(size_t word) {
+  // Grow geometrically so that inserting increasing IDs stays amortized O(1).
+  size_t new_size = std::max(word + 1, words_.size() + words_.size() / 2);
+  words_.resize(new_size, 0);
+}
+
+size_t DenseIdStorage::UsedMemory() const {
+  // The overflow set is estimated with 32 bytes per entry.
+  return words_.capacity() * sizeof(uint64_t) + negatives_.size() * 32;
+}
+
+// ==================== SparseIdStorage ====================
+
+bool SparseIdStorage::count(osmium::object_id_type id) const {
+  uint64_t key = static_cast<uint64_t>(id) >> kChunkBits;
+  auto iter    = chunks_.find(key);
+  if (iter == chunks_.end()) {
+    return false;
+  }
+  uint16_t low       = static_cast<uint16_t>(id);
+  const Chunk &chunk = iter->second;
+  if (chunk.bitmap != nullptr) {
+    return (chunk.bitmap[low >> 6] >> (low & 63) & 1) == 1;
+  }
+  return std::binary_search(chunk.array.begin(), chunk.array.end(), low);
+}
+
+bool SparseIdStorage::insert(osmium::object_id_type id) {
+  uint64_t key = static_cast<uint64_t>(id) >> kChunkBits;
+  uint16_t low = static_cast<uint16_t>(id);
+  Chunk &chunk = chunks_[key];
+
+  if (chunk.bitmap != nullptr) {
+    uint64_t mask = uint64_t{1} << (low & 63);
+    if ((chunk.bitmap[low >> 6] & mask) != 0) {
+      return false;
+    }
+    chunk.bitmap[low >> 6] |= mask;
+    return true;
+  }
+
+  // IDs mostly arrive in ascending order, so check the back first.
+  if (chunk.array.empty() || chunk.array.back() < low) {
+    chunk.array.emplace_back(low);
+  } else {
+    auto iter = std::lower_bound(chunk.array.begin(), chunk.array.end(), low);
+    if (*iter == low) {
+      return false;
+    }
+    chunk.array.insert(iter, low);
+  }
+
+  // Convert to bitmap when the array becomes too large.
+  if (chunk.array.size() > kMaxArraySize) {
+    constexpr size_t kNumWords = size_t{1} << (kChunkBits - 6);
+    chunk.bitmap.reset(new uint64_t[kNumWords]());
+    for (uint16_t value : chunk.array) {
+      chunk.bitmap[value >> 6] |= uint64_t{1} << (value & 63);
+    }
+    chunk.array = std::vector<uint16_t>();
+  }
+  return true;
+}
+
+std::vector<uint64_t> SparseIdStorage::SortedKeys() const {
+  std::vector<uint64_t> keys;
+  keys.reserve(chunks_.size());
+  for (const auto &item : chunks_) {
+    keys.emplace_back(item.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+size_t SparseIdStorage::UsedMemory() const {
+  // Each entry in the chunk map is estimated with 64 bytes (key, chunk, node
+  // and bucket overhead).
+  size_t result = chunks_.size() * 64;
+  for (const auto &item : chunks_) {
+    if (item.second.bitmap != nullptr) {
+      result += (size_t{1} << kChunkBits) / 8;
+    } else {
+      result += item.second.array.capacity() * sizeof(uint16_t);
+    }
+  }
+  return result;
+}
+
+// ==================== IdSet ====================
+
+// The first density check happens after this many IDs are inserted, and the
+// interval doubles after each check.
+static constexpr size_t kFirstDensityCheck = 1 << 16;
+
+IdSet::IdSet(IdSetBackend backend)
+    : backend_(backend),
+      is_dense_(backend == IdSetBackend::kDense),
+      next_density_check_(backend == IdSetBackend::kAuto ? kFirstDensityCheck : 0) {}
+
+void IdSet::CheckDensity() {
+  next_density_check_ *= 2;
+
+  // The dense backend costs 1 bit per ID up to the largest ID. The sparse
+  // backend costs up to 16 bits per ID in the array chunks.
+  if (is_dense_ || backend_ != IdSetBackend::kAuto || max_id_ < 0 ||
+      static_cast<size_t>(max_id_) / 8 > sparse_.UsedMemory()) {
+    return;
+  }
+
+  DenseIdStorage dense;
+  dense.Grow(static_cast<size_t>(max_id_) >> 6);
+  sparse_.ForEach([&dense](osmium::object_id_type id) { dense.insert(id); });
+  dense_    = std::move(dense);
+  sparse_   = SparseIdStorage();
+  is_dense_ = true;
+}
+
+size_t IdSet::UsedMemory() const {
+  return is_dense_ ? dense_.UsedMemory() : sparse_.UsedMemory();
+}
+
+}  // namespace open_semap
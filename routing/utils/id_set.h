@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "osmium/osm/types.hpp"
+
+namespace open_semap {
+
+enum class IdSetBackend {
+  // Start with the sparse backend, and switch to the dense backend once the
+  // IDs in the set turn out to be dense enough.
+  kAuto,
+  // One bit for every ID between 0 and the largest ID in the set.
+  kDense,
+  // The ID space is cut into chunks of 2^16 IDs. Only the non-empty chunks are
+  // stored, each of them either as a sorted array or as a bitmap.
+  kSparse,
+};
+
+// Bitmap over [0, largest ID]. Negative IDs (only seen in locally edited
+// files) are rare and go to a small overflow set.
+class DenseIdStorage {
+ public:
+  inline bool count(osmium::object_id_type id) const {
+    if (id < 0) {
+      return negatives_.count(id) > 0;
+    }
+    size_t word = static_cast<size_t>(id) >> 6;
+    return word < words_.size() && (words_[word] >> (id & 63) & 1) == 1;
+  }
+
+  // Returns true if the ID was not in the set before.
+  inline bool insert(osmium::object_id_type id) {
+    if (id < 0) {
+      return negatives_.insert(id).second;
+    }
+    size_t word = static_cast<size_t>(id) >> 6;
+    if (word >= words_.size()) {
+      Grow(word);
+    }
+    uint64_t mask = uint64_t{1} << (id & 63);
+    if ((words_[word] & mask) != 0) {
+      return false;
+    }
+    words_[word] |= mask;
+    return true;
+  }
+
+  void Grow(size_t word);
+
+  template <typename Function>
+  void ForEach(Function &&function) const {
+    for (osmium::object_id_type id : negatives_) {
+      function(id);
+    }
+    for (size_t i = 0; i < words_.size(); ++i) {
+      uint64_t bits = words_[i];
+      while (bits != 0) {
+        int offset = __builtin_ctzll(bits);
+        function(static_cast<osmium::object_id_type>((i << 6) + offset));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  size_t UsedMemory() const;
+
+ private:
+  std::vector<uint64_t> words_{};
+  std::unordered_set<osmium::object_id_type> negatives_{};
+};
+
+// Roaring-bitmap-like storage for sparse IDs.
+class SparseIdStorage {
+ public:
+  static constexpr int kChunkBits = 16;
+  // A chunk with more than this many IDs is stored as a bitmap, which costs
+  // the same number of bytes (8 KB) as a sorted array of this many IDs.
+  static constexpr size_t kMaxArraySize = 4096;
+
+  struct Chunk {
+    // Sorted low bits of the IDs, used while the chunk is small.
+    std::vector<uint16_t> array{};
+    // 2^16 bits, used once the chunk is large.
+    std::unique_ptr<uint64_t[]> bitmap{};
+  };
+
+  bool count(osmium::object_id_type id) const;
+
+  // Returns true if the ID was not in the set before.
+  bool insert(osmium::object_id_type id);
+
+  template <typename Function>
+  void ForEach(Function &&function) const {
+    for (uint64_t key : SortedKeys()) {
+      const Chunk &chunk = chunks_.at(key);
+      uint64_t base      = key << kChunkBits;
+      if (chunk.bitmap != nullptr) {
+        for (size_t i = 0; i < (size_t{1} << (kChunkBits - 6)); ++i) {
+          uint64_t bits = chunk.bitmap[i];
+          while (bits != 0) {
+            int offset = __builtin_ctzll(bits);
+            function(static_cast<osmium::object_id_type>(base + (i << 6) + offset));
+            bits &= bits - 1;
+          }
+        }
+      } else {
+        for (uint16_t low : chunk.array) {
+          function(static_cast<osmium::object_id_type>(base + low));
+        }
+      }
+    }
+  }
+
+  size_t UsedMemory() const;
+
+ private:
+  std::vector<uint64_t> SortedKeys() const;
+
+  std::unordered_map<uint64_t, Chunk> chunks_{};
+};
+
+// A set of OSM object IDs. It replaces std::unordered_set<object_id_type>,
+// which costs tens of bytes per ID, in the extraction utilities. Only the
+// operations that the utilities need are provided.
+class IdSet {
+ public:
+  explicit IdSet(IdSetBackend backend = IdSetBackend::kAuto);
+
+  IdSet(IdSet &&) noexcept = default;
+  IdSet &operator=(IdSet &&) noexcept = default;
+
+  inline size_t count(osmium::object_id_type id) const {
+    return (is_dense_ ? dense_.count(id) : sparse_.count(id)) ? 1 : 0;
+  }
+
+  // Returns true if the ID was not in the set before.
+  inline bool insert(osmium::object_id_type id) {
+    bool inserted = is_dense_ ? dense_.insert(id) : sparse_.insert(id);
+    if (inserted) {
+      ++size_;
+      if (id > max_id_) {
+        max_id_ = id;
+      }
+      if (size_ == next_density_check_) {
+        CheckDensity();
+      }
+    }
+    return inserted;
+  }
+
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+  inline bool IsDense() const { return is_dense_; }
+
+  // Calls the function on each of the IDs. Non-negative IDs are visited in
+  // ascending order. Negative IDs, if any, are visited in no particular order.
+  template <typename Function>
+  void ForEach(Function &&function) const {
+    if (is_dense_) {
+      dense_.ForEach(std::forward<Function>(function));
+    } else {
+      sparse_.ForEach(std::forward<Function>(function));
+    }
+  }
+
+  // Approximate number of bytes used by the set.
+  size_t UsedMemory() const;
+
+ private:
+  // In kAuto mode, switch to the dense backend if it would use less memory.
+  void CheckDensity();
+
+  IdSetBackend backend_;
+  bool is_dense_ = false;
+  DenseIdStorage dense_{};
+  SparseIdStorage sparse_{};
+  size_t size_                   = 0;
+  osmium::object_id_type max_id_ = 0;
+  size_t next_density_check_     = 0;
+};
+
+}  // namespace open_semap
@@ -0,0 +1,435 @@
+#include "utils/incremental_update.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "osmium/geom/haversine.hpp"
+#include "osmium/handler.hpp"
+#include "osmium/io/gzip_compression.hpp"
+#include "osmium/io/pbf_input.hpp"
+#include "osmium/io/reader.hpp"
+#include "osmium/io/reader_with_progress_bar.hpp"
+#include "osmium/io/xml_input.hpp"
+#include "osmium/visitor.hpp"
+#include "spdlog/spdlog.h"
+
+#include "utils/predicates.h"
+#include "utils/routing_profile.h"
+#include "utils/split_road.h"
+
+namespace open_semap {
+
+namespace {
+
+class ChangeCollectorHandler : public osmium::handler::Handler {
+ public:
+  ChangeCollectorHandler(OsmChange& change_) : change(change_) {
+  }
+
+  void node(const osmium::Node& node) {
+    OsmChange::NodeChange& entry = change.get().nodes[node.id()];
+    if (entry.version > node.version()) {
+      return;
+    }
+    entry.version  = node.version();
+    entry.deleted  = !node.visible();
+    entry.location = node.location();
+  }
+
+  void way(const osmium::Way& way) {
+    OsmChange::WayChange& entry = change.get().ways[way.id()];
+    if (entry.version > way.version()) {
+      return;
+    }
+    entry.version = way.version();
+    entry.removed = !way.visible() || !predicate::IsValidRoad(way);
+    entry.refs.clear();
+    if (!entry.removed) {
+      for (const auto& node : way.nodes()) {
+        entry.refs.emplace_back(node.ref());
+      }
+      entry.speed = ActiveProfile().Speed(way);
+    }
+  }
+
+ private:
+  std::reference_wrapper<OsmChange> change;
+};
+
+template <typename T>
+void SortAndUnique(std::vector<T>* values) {
+  std::sort(values->begin(), values->end());
+  values->erase(std::unique(values->begin(), values->end()), values->end());
+}
+
+}  // namespace
+
+class IncrementalUpdater::WayLoader : public osmium::handler::Handler {
+ public:
+  WayLoader(IncrementalUpdater& updater_) : updater(updater_) {
+  }
+
+  void way(const osmium::Way& way) {
+    if (!predicate::IsValidRoad(way)) {
+      return;
+    }
+    refs.clear();
+    for (const auto& node : way.nodes()) {
+      refs.emplace_back(node.ref());
+    }
+    updater.get().AddRoad(way.id(), refs, ActiveProfile().Speed(way));
+  }
+
+ private:
+  std::reference_wrapper<IncrementalUpdater> updater;
+  std::vector<osmium::object_id_type> refs{};
+};
+
+class IncrementalUpdater::NodeLoader : public osmium::handler::Handler {
+ public:
+  NodeLoader(IncrementalUpdater& updater_) : updater(updater_) {
+  }
+
+  void node(const osmium::Node& node) {
+    if (updater.get().ref_counts.count(node.id()) > 0) {
+      updater.get().locations[node.id()] = node.location();
+    }
+  }
+
+ private:
+  std::reference_wrapper<IncrementalUpdater> updater;
+};
+
+OsmChange ReadChangeFile(const std::string& path) {
+  OsmChange change;
+  osmium::io::File input_file(path);
+  osmium::io::Reader reader(input_file,
+                            osmium::osm_entity_bits::node | osmium::osm_entity_bits::way);
+  ChangeCollectorHandler handler(change);
+  osmium::apply(reader, handler);
+  reader.close();
+  return change;
+}
+
+IncrementalUpdater IncrementalUpdater::LoadFromFile(const std::string& path,
+                                                    const osmium::Box& bounding_box) {
+  IncrementalUpdater updater(bounding_box);
+
+  {
+    osmium::io::File input_file(path);
+    osmium::io::ReaderWithProgressBar reader(true, input_file,
+                                             osmium::osm_entity_bits::way);
+    WayLoader handler(updater);
+    osmium::apply(reader, handler);
+    reader.close();
+  }
+
+  {
+    osmium::io::File input_file(path);
+    osmium::io::ReaderWithProgressBar reader(true, input_file,
+                                             osmium::osm_entity_bits::node);
+    NodeLoader handler(updater);
+    osmium::apply(reader, handler);
+    reader.close();
+  }
+
+  spdlog::info("IncrementalUpdater: {} roads, {} road nodes.", updater.roads.size(),
+               updater.ref_counts.size());
+  return updater;
+}
+
+bool IncrementalUpdater::IsJunction(osmium::object_id_type node_id) const {
+  auto count = ref_counts.find(node_id);
+  if (count == ref_counts.end() || count->second < 2) {
+    return false;
+  }
+  auto location = locations.find(node_id);
+  return location != locations.end() && bounding_box.contains(location->second);
+}
+
+void IncrementalUpdater::AddRoad(osmium::object_id_type way_id,
+                                 const std::vector<osmium::object_id_type>& refs,
+                                 double speed) {
+  roads[way_id]       = refs;
+  road_speeds[way_id] = speed;
+  for (osmium::object_id_type ref : refs) {
+    ++ref_counts[ref];
+    std::vector<osmium::object_id_type>& ways = node_roads[ref];
+    if (std::find(ways.begin(), ways.end(), way_id) == ways.end()) {
+      ways.emplace_back(way_id);
+    }
+  }
+}
+
+void IncrementalUpdater::RemoveRoad(osmium::object_id_type way_id) {
+  auto road = roads.find(way_id);
+  if (road == roads.end()) {
+    return;
+  }
+  for (osmium::object_id_type ref : road->second) {
+    auto count = ref_counts.find(ref);
+    if (count != ref_counts.end() && --count->second == 0) {
+      ref_counts.erase(count);
+    }
+    auto ways = node_roads.find(ref);
+    if (ways != node_roads.end()) {
+      ways->second.erase(std::remove(ways->second.begin(), ways->second.end(), way_id),
+                         ways->second.end());
+      if (ways->second.empty()) {
+        node_roads.erase(ways);
+      }
+    }
+  }
+  // NOTE: The locations are kept, so that the road can come back later without
+  // its nodes being in the change file.
+  roads.erase(road);
+  road_speeds.erase(way_id);
+}
+
+size_t IncrementalUpdater::AddRoadEdges(osmium::object_id_type way_id,
+                                        graph::RoadGraph* graph,
+                                        graph::SimpleIndexer* indexer) {
+  const std::vector<osmium::object_id_type>& refs = roads.at(way_id);
+  const double speed                               = road_speeds.at(way_id);
+
+  // Same as what SplitRoadHandler::way() does.
+  std::vector<size_t> vertex_indices;
+  for (size_t j = 0; j < refs.size(); ++j) {
+    if (IsJunction(refs[j])) {
+      vertex_indices.emplace_back(j);
+    }
+  }
+  const size_t max_vertices = static_cast<size_t>(kMaxSegmentsPerWay) + 1;
+  if (vertex_indices.size() > max_vertices) {
+    vertex_indices.resize(max_vertices);
+  }
+
+  std::vector<const graph::Edge*>& edges = road_edges[way_id];
+  std::vector<osmium::Location> points;
+  for (size_t i = 0; i + 1 < vertex_indices.size(); ++i) {
+    const graph::Vertex* from = graph->FindVertex(refs[vertex_indices[i]]);
+    const graph::Vertex* to   = graph->FindVertex(refs[vertex_indices[i + 1]]);
+    if (from == nullptr || to == nullptr) {
+      spdlog::critical("Cannot find vertex {} or {} for road {}.",
+                       refs[vertex_indices[i]], refs[vertex_indices[i + 1]], way_id);
+      continue;
+    }
+
+    graph::Edge& edge = graph->AddEdge(*from, *to);
+    edge.id_          = SplitWayId(way_id, i);
+    points.clear();
+    points.emplace_back(from->loc());
+    for (size_t j = vertex_indices[i] + 1; j < vertex_indices[i + 1]; ++j) {
+      auto location = locations.find(refs[j]);
+      if (location == locations.end()) {
+        spdlog::warn("Missing the location of node {} on road {}.", refs[j], way_id);
+        continue;
+      }
+      points.emplace_back(location->second);
+    }
+    points.emplace_back(to->loc());
+    double length = 0.0;
+    for (size_t j = 1; j < points.size(); ++j) {
+      length += osmium::geom::haversine::distance(points[j - 1], points[j]);
+    }
+    // As read back from the routing graph file, so that the weight does not
+    // differ from a rebuild at a rounding boundary.
+    edge.length_ = RoundLength(length);
+    edge.weight_ = graph::TravelTime(edge.length_, speed);
+    graph->SetPoints(edge, points);
+
+    if (indexer != nullptr) {
+      indexer->AddEdge(edge);
+    }
+    edges.emplace_back(&edge);
+  }
+
+  size_t num_edges = edges.size();
+  if (edges.empty()) {
+    road_edges.erase(way_id);
+  }
+  return num_edges;
+}
+
+graph::RoadGraph IncrementalUpdater::BuildGraph() {
+  graph::RoadGraph graph;
+  road_edges.clear();
+
+  // Sorted, so that the graph does not depend on the hash map iteration order.
+  std::vector<osmium::object_id_type> ids;
+  for (const auto& count : ref_counts) {
+    if (IsJunction(count.first)) {
+      ids.emplace_back(count.first);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  for (osmium::object_id_type id : ids) {
+    graph.AddVertex(id, locations.at(id));
+  }
+
+  ids.clear();
+  for (const auto& road : roads) {
+    ids.emplace_back(road.first);
+  }
+  std::sort(ids.begin(), ids.end());
+  for (osmium::object_id_type id : ids) {
+    AddRoadEdges(id, &graph, nullptr);
+  }
+
+  return graph;
+}
+
+void IncrementalUpdater::Attach(const graph::RoadGraph& graph) {
+  road_edges.clear();
+  for (const graph::Edge* edge : graph.edges()) {
+    road_edges[SourceWayId(edge->id())].emplace_back(edge);
+  }
+}
+
+IncrementalUpdateStats IncrementalUpdater::Apply(const std::string& change_path,
+                                                 graph::RoadGraph* graph,
+                                                 graph::SimpleIndexer* indexer) {
+  return Apply(ReadChangeFile(change_path), graph, indexer);
+}
+
+IncrementalUpdateStats IncrementalUpdater::Apply(const OsmChange& change,
+                                                 graph::RoadGraph* graph,
+                                                 graph::SimpleIndexer* indexer) {
+  IncrementalUpdateStats stats;
+  stats.num_changed_nodes = change.nodes.size();
+  stats.num_changed_ways  = change.ways.size();
+
+  // Nodes whose junction status or location may have changed.
+  std::vector<osmium::object_id_type> touched_nodes;
+  // Roads whose edges need to be rebuilt.
+  std::vector<osmium::object_id_type> affected_roads;
+
+  // 1. Update the node lists of the roads and the reference counts.
+  for (const auto& entry : change.ways) {
+    auto road = roads.find(entry.first);
+    if (road != roads.end()) {
+      touched_nodes.insert(touched_nodes.end(), road->second.begin(), road->second.end());
+      affected_roads.emplace_back(entry.first);
+      RemoveRoad(entry.first);
+    }
+    if (!entry.second.removed) {
+      AddRoad(entry.first, entry.second.refs, entry.second.speed);
+      touched_nodes.insert(touched_nodes.end(), entry.second.refs.begin(),
+                           entry.second.refs.end());
+      affected_roads.emplace_back(entry.first);
+    }
+  }
+
+  // 2. Update the locations. Only the nodes that are (or were) on the roads
+  // are interesting.
+  for (const auto& entry : change.nodes) {
+    if (ref_counts.count(entry.first) == 0 && locations.count(entry.first) == 0) {
+      continue;
+    }
+    if (entry.second.deleted) {
+      locations.erase(entry.first);
+    } else {
+      locations[entry.first] = entry.second.location;
+    }
+    touched_nodes.emplace_back(entry.first);
+    // The geometry of the roads through a moved node changes.
+    auto ways = node_roads.find(entry.first);
+    if (ways != node_roads.end()) {
+      affected_roads.insert(affected_roads.end(), ways->second.begin(),
+                            ways->second.end());
+    }
+  }
+
+  // 3. Find the vertices to be added, removed or moved. The roads that go
+  // through them are affected as well. The roads that used to go through them
+  // but no longer do have been changed, and are already affected.
+  SortAndUnique(&touched_nodes);
+  std::vector<osmium::object_id_type> changed_vertices;
+  for (osmium::object_id_type node_id : touched_nodes) {
+    const graph::Vertex* vertex = graph->FindVertex(node_id);
+    bool is_junction            = IsJunction(node_id);
+    if (vertex == nullptr && !is_junction) {
+      continue;
+    }
+    if (vertex != nullptr && is_junction && vertex->loc() == locations.at(node_id)) {
+      continue;
+    }
+    changed_vertices.emplace_back(node_id);
+    auto ways = node_roads.find(node_id);
+    if (ways != node_roads.end()) {
+      affected_roads.insert(affected_roads.end(), ways->second.begin(),
+                            ways->second.end());
+    }
+  }
+  SortAndUnique(&affected_roads);
+  stats.num_affected_roads = affected_roads.size();
+
+  // 4. Remove the edges of the affected roads, which also removes all the
+  // edges connecting the changed vertices.
+  for (osmium::object_id_type way_id : affected_roads) {
+    auto edges = road_edges.find(way_id);
+    if (edges == road_edges.end()) {
+      continue;
+    }
+    for (const graph::Edge* edge : edges->second) {
+      if (indexer != nullptr) {
+        indexer->RemoveEdge(*edge);
+      }
+      graph->RemoveEdge(*edge);
+      ++stats.num_removed_edges;
+    }
+    road_edges.erase(edges);
+  }
+
+  // 5. Replace the changed vertices.
+  for (osmium::object_id_type node_id : changed_vertices) {
+    if (graph->FindVertex(node_id) != nullptr) {
+      if (indexer != nullptr) {
+        indexer->RemoveVertex(node_id);
+      }
+      graph->RemoveVertex(node_id);
+      ++stats.num_removed_vertices;
+    }
+    if (IsJunction(node_id)) {
+      const graph::Vertex& vertex = graph->AddVertex(node_id, locations.at(node_id));
+      if (indexer != nullptr) {
+        indexer->AddVertex(vertex);
+      }
+      ++stats.num_added_vertices;
+    }
+  }
+
+  // 6. Split the affected roads that still exist again.
+  std::vector<osmium::object_id_type> missing_locations;
+  for (osmium::object_id_type way_id : affected_roads) {
+    auto road = roads.find(way_id);
+    if (road == roads.end()) {
+      continue;
+    }
+    for (osmium::object_id_type ref : road->second) {
+      if (locations.count(ref) == 0) {
+        missing_locations.emplace_back(ref);
+      }
+    }
+    stats.num_added_edges += AddRoadEdges(way_id, graph, indexer);
+  }
+  SortAndUnique(&missing_locations);
+  stats.num_missing_locations = missing_locations.size();
+  if (!missing_locations.empty()) {
+    spdlog::critical(
+        "The locations of {} road nodes (e.g. node {}) are not known. The patched "
+        "graph differs from a rebuild, build it again from the updated map.",
+        missing_locations.size(), missing_locations.front());
+  }
+
+  spdlog::info(
+      "Applied {} node and {} way changes: {} roads affected, {} edges removed, "
+      "{} edges added, {} vertices removed, {} vertices added.",
+      stats.num_changed_nodes, stats.num_changed_ways, stats.num_affected_roads,
+      stats.num_removed_edges, stats.num_added_edges, stats.num_removed_vertices,
+      stats.num_added_vertices);
+  return stats;
+}
+
+}  // namespace open_semap
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "osmium/osm.hpp"
+
+#include "graph/road_graph.h"
+#include "graph/simple_indexer.h"
+
+namespace open_semap {
+
+// The content of an OSM change file (.osc), reduced to what the routing graph
+// cares about. When an object appears more than once, only its latest version
+// is kept.
+struct OsmChange {
+  struct NodeChange {
+    osmium::object_version_type version = 0;
+    bool deleted                        = false;
+    osmium::Location location{};
+  };
+
+  struct WayChange {
+    osmium::object_version_type version = 0;
+    // True if the way is deleted, or no longer a valid road.
+    bool removed = false;
+    std::vector<osmium::object_id_type> refs{};
+    // In km/h, from ActiveProfile().
+    double speed = 0.0;
+  };
+
+  std::unordered_map<osmium::object_id_type, NodeChange> nodes{};
+  std::unordered_map<osmium::object_id_type, WayChange> ways{};
+};
+
+OsmChange ReadChangeFile(const std::string& path);
+
+struct IncrementalUpdateStats {
+  size_t num_changed_nodes    = 0;
+  size_t num_changed_ways     = 0;
+  size_t num_affected_roads   = 0;
+  size_t num_removed_edges    = 0;
+  size_t num_added_edges      = 0;
+  size_t num_removed_vertices = 0;
+  size_t num_added_vertices   = 0;
+  // The nodes of the changed roads whose locations are neither known nor in
+  // the change file. While this is not 0, the graph differs from a rebuild.
+  size_t num_missing_locations = 0;
+};
+
+// Applies OSM change files to a routing graph in place, so that a map update
+// does not require running extract_routes and loading the graph again.
+//
+// The updater keeps what the routing graph alone does not tell: the node list
+// of every road, how many times each node is referenced by the roads (a node
+// referenced at least twice is a junction), and the locations of the road
+// nodes. With these, a change only re-splits the roads that are touched by it,
+// either directly or because one of their nodes moved or became (or stopped
+// being) a junction. The cost of an update is therefore proportional to the
+// size of the diff rather than the size of the region.
+//
+// The patched graph is the same as the one extract_routes would produce from
+// the updated map, with the same vertex IDs and edge IDs (see SplitWayId()),
+// as long as the locations of the road nodes are all known.
+//
+// NOTE: Change files only carry the objects that changed, and only the
+// locations of the road nodes are kept. A new road through a node that was not
+// on any road before, and that is not in the change file, misses the location
+// of that node: the node is left out of the geometry and cannot become a
+// junction. Apply() reports such nodes in num_missing_locations, after
+// logging, and the graph should then be built again from the updated map.
+class IncrementalUpdater {
+ public:
+  // Builds the state from the same input that extract_routes ran on. It reads
+  // the ways first and then the nodes.
+  static IncrementalUpdater LoadFromFile(const std::string& path,
+                                         const osmium::Box& bounding_box);
+
+  explicit IncrementalUpdater(const osmium::Box& bounding_box_)
+      : bounding_box(bounding_box_) {
+  }
+
+  IncrementalUpdater(IncrementalUpdater&&) noexcept = default;
+  IncrementalUpdater& operator=(IncrementalUpdater&&) noexcept = default;
+
+  // Builds the routing graph from scratch. The graph is attached to the updater
+  // and can be patched by Apply() afterwards.
+  graph::RoadGraph BuildGraph();
+
+  // Attaches a graph loaded from the output of extract_routes (on the same
+  // input as LoadFromFile()), so that it can be patched by Apply().
+  void Attach(const graph::RoadGraph& graph);
+
+  // Patches the attached graph and the indexer built on it. The indexer is
+  // optional and can be nullptr.
+  IncrementalUpdateStats Apply(const OsmChange& change, graph::RoadGraph* graph,
+                               graph::SimpleIndexer* indexer);
+
+  IncrementalUpdateStats Apply(const std::string& change_path, graph::RoadGraph* graph,
+                               graph::SimpleIndexer* indexer);
+
+  // Same criteria as ExtractJunction followed by FilterBoundingBox.
+  bool IsJunction(osmium::object_id_type node_id) const;
+
+  inline size_t NumRoads() const {
+    return roads.size();
+  }
+
+ private:
+  class WayLoader;
+  class NodeLoader;
+
+  void AddRoad(osmium::object_id_type way_id,
+               const std::vector<osmium::object_id_type>& refs, double speed);
+
+  void RemoveRoad(osmium::object_id_type way_id);
+
+  // Splits the road by its junctions and adds the resulting edges. All the
+  // junctions on the road must already be vertices of the graph. Returns the
+  // number of edges added.
+  size_t AddRoadEdges(osmium::object_id_type way_id, graph::RoadGraph* graph,
+                      graph::SimpleIndexer* indexer);
+
+  osmium::Box bounding_box;
+  std::unordered_map<osmium::object_id_type, std::vector<osmium::object_id_type>> roads{};
+  // The speed of each road, from which the travel times of its edges follow.
+  std::unordered_map<osmium::object_id_type, double> road_speeds{};
+  std::unordered_map<osmium::object_id_type, uint32_t> ref_counts{};
+  // For each road node, the roads that go through it.
+  std::unordered_map<osmium::object_id_type, std::vector<osmium::object_id_type>>
+      node_roads{};
+  std::unordered_map<osmium::object_id_type, osmium::Location> locations{};
+  // The edges in the attached graph that each road is split into.
+  std::unordered_map<osmium::object_id_type, std::vector<const graph::Edge*>>
+      road_edges{};
+};
+
+}  // namespace open_semap
@@ -0,0 +1,217 @@
+#include "utils/metrics.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+namespace {
+
+std::string EscapeJson(const std::string& text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      result += code;
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+// The stages that are running, so that the high-water mark one of them reaches
+// is not lost when another one starts and resets it.
+struct ActiveStages {
+  std::mutex mutex{};
+  // The peaks of the running stages.
+  std::vector<uint64_t*> peaks{};
+  // The highest mark seen before any of the resets.
+  uint64_t process_peak = 0;
+
+  static ActiveStages& Global() {
+    static ActiveStages stages;
+    return stages;
+  }
+
+  // Must be called with the mutex held.
+  void RaisePeaks() {
+    uint64_t peak = PeakRssBytes();
+    for (uint64_t* stage_peak : peaks) {
+      *stage_peak = std::max(*stage_peak, peak);
+    }
+    process_peak = std::max(process_peak, peak);
+  }
+};
+
+}  // namespace
+
+double ProcessCpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+uint64_t CurrentRssBytes() {
+  // The second field of statm is the number of resident pages.
+  std::ifstream statm("/proc/self/statm");
+  uint64_t total_pages    = 0;
+  uint64_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+uint64_t PeakRssBytes() {
+  // VmHWM follows ResetPeakRss(), and is in kilobytes.
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6)) * 1024;
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in kilobytes on Linux.
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+bool ResetPeakRss() {
+  // Writing 5 resets the peak resident set size of the process (Linux 4.0+).
+  FILE* clear_refs = std::fopen("/proc/self/clear_refs", "w");
+  if (clear_refs == nullptr) {
+    return false;
+  }
+  bool written = std::fputs("5", clear_refs) >= 0;
+  return std::fclose(clear_refs) == 0 && written;
+}
+
+uint64_t ProcessPeakRssBytes() {
+  ActiveStages& active = ActiveStages::Global();
+  std::lock_guard<std::mutex> lock(active.mutex);
+  active.RaisePeaks();
+  return active.process_peak;
+}
+
+double StageMetrics::ObjectsPerSecond() const {
+  return wall_seconds > 0.0 ? static_cast<double>(num_objects) / wall_seconds : 0.0;
+}
+
+MetricsRegistry& MetricsRegistry::Global() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+void MetricsRegistry::Record(StageMetrics&& stage) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.emplace_back(std::move(stage));
+}
+
+std::vector<StageMetrics> MetricsRegistry::Stages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stages_;
+}
+
+void MetricsRegistry::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.clear();
+}
+
+std::string MetricsRegistry::ToJson() const {
+  std::vector<StageMetrics> stages = Stages();
+  std::ostringstream out;
+  out.precision(6);
+  out << std::fixed;
+  out << "{\n  \"peak_rss_bytes\": " << ProcessPeakRssBytes() << ",\n  \"stages\": [";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const StageMetrics& stage = stages[i];
+    out << (i == 0 ? "\n" : ",\n");
+    out << "    {\n";
+    out << "      \"name\": \"" << EscapeJson(stage.name) << "\",\n";
+    out << "      \"wall_seconds\": " << stage.wall_seconds << ",\n";
+    out << "      \"cpu_seconds\": " << stage.cpu_seconds << ",\n";
+    out << "      \"objects\": " << stage.num_objects << ",\n";
+    out << "      \"objects_per_second\": " << stage.ObjectsPerSecond() << ",\n";
+    out << "      \"bytes_read\": " << stage.bytes_read << ",\n";
+    out << "      \"rss_start_bytes\": " << stage.rss_start_bytes << ",\n";
+    out << "      \"rss_end_bytes\": " << stage.rss_end_bytes << ",\n";
+    out << "      \"peak_rss_bytes\": " << stage.peak_rss_bytes << ",\n";
+    out << "      \"sizes\": {";
+    size_t j = 0;
+    for (const auto& size : stage.sizes) {
+      out << (j++ == 0 ? "" : ", ") << "\"" << EscapeJson(size.first)
+          << "\": " << size.second;
+    }
+    out << "}\n    }";
+  }
+  out << (stages.empty() ? "]\n}\n" : "\n  ]\n}\n");
+  return out.str();
+}
+
+bool MetricsRegistry::WriteJson(const std::string& path) const {
+  std::ofstream output(path);
+  if (!output) {
+    spdlog::warn("Cannot write the metrics to {}.", path);
+    return false;
+  }
+  output << ToJson();
+  spdlog::info("Metrics written to {}.", path);
+  return static_cast<bool>(output);
+}
+
+ScopedStage::ScopedStage(const std::string& name)
+    : wall_start_(std::chrono::steady_clock::now()), cpu_start_(ProcessCpuSeconds()) {
+  metrics_.name = name;
+  ActiveStages& active = ActiveStages::Global();
+  std::lock_guard<std::mutex> lock(active.mutex);
+  // Hand the mark reached so far to the running stages before resetting it.
+  active.RaisePeaks();
+  ResetPeakRss();
+  active.peaks.emplace_back(&metrics_.peak_rss_bytes);
+  metrics_.rss_start_bytes = CurrentRssBytes();
+}
+
+ScopedStage::~ScopedStage() {
+  metrics_.wall_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - wall_start_)
+                              .count();
+  metrics_.cpu_seconds   = ProcessCpuSeconds() - cpu_start_;
+  metrics_.num_objects   = num_objects_.load();
+  metrics_.bytes_read    = bytes_read_.load();
+  metrics_.rss_end_bytes = CurrentRssBytes();
+  {
+    ActiveStages& active = ActiveStages::Global();
+    std::lock_guard<std::mutex> lock(active.mutex);
+    active.RaisePeaks();
+    active.peaks.erase(
+        std::find(active.peaks.begin(), active.peaks.end(), &metrics_.peak_rss_bytes));
+  }
+  spdlog::info(
+      "Stage {}: {:.2f}s wall, {:.2f}s cpu, {:.0f} objects/s, RSS {} -> {} MB, "
+      "peak {} MB.",
+      metrics_.name, metrics_.wall_seconds, metrics_.cpu_seconds,
+      metrics_.ObjectsPerSecond(), metrics_.rss_start_bytes >> 20,
+      metrics_.rss_end_bytes >> 20, metrics_.peak_rss_bytes >> 20);
+  MetricsRegistry::Global().Record(std::move(metrics_));
+}
+
+void ScopedStage::SetSize(const std::string& key, uint64_t value) {
+  metrics_.sizes[key] = value;
+}
+
+}  // namespace open_semap
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "osmium/handler.hpp"
+#include "osmium/osm.hpp"
+
+namespace open_semap {
+
+// What a stage of the extraction reports.
+struct StageMetrics {
+  std::string name{};
+  double wall_seconds = 0.0;
+  // User plus system time of the whole process, i.e. summed over all threads.
+  double cpu_seconds = 0.0;
+  // The number of OSM objects handed to the stage by the reader.
+  uint64_t num_objects = 0;
+  // The number of bytes of the input file read by the stage, i.e. the offset of
+  // the reader, which is compressed for .pbf files.
+  uint64_t bytes_read = 0;
+  // The resident set size of the process when the stage starts and ends.
+  uint64_t rss_start_bytes = 0;
+  uint64_t rss_end_bytes   = 0;
+  // The high-water mark of the resident set size during the stage. It falls
+  // back to the high-water mark of the process so far when the kernel does not
+  // let the mark be reset, see ResetPeakRss().
+  uint64_t peak_rss_bytes = 0;
+  // Sizes of the data structures, e.g. the number of junctions and the bytes
+  // used by them.
+  std::map<std::string, uint64_t> sizes{};
+
+  double ObjectsPerSecond() const;
+};
+
+// Collects the metrics of all the stages of a run, so that they can be written
+// as JSON at the end and compared across runs.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& Global();
+
+  // Thread-safe.
+  void Record(StageMetrics&& stage);
+
+  std::vector<StageMetrics> Stages() const;
+
+  void Clear();
+
+  std::string ToJson() const;
+
+  // Returns false if the file cannot be written.
+  bool WriteJson(const std::string& path) const;
+
+ private:
+  mutable std::mutex mutex_{};
+  std::vector<StageMetrics> stages_{};
+};
+
+// Measures a stage from construction to destruction, and records it into the
+// global registry on destruction.
+class ScopedStage {
+ public:
+  explicit ScopedStage(const std::string& name);
+
+  ~ScopedStage();
+
+  ScopedStage(const ScopedStage&) = delete;
+  ScopedStage& operator=(const ScopedStage&) = delete;
+
+  // Thread-safe.
+  inline void AddObjects(uint64_t count) {
+    num_objects_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  inline void AddBytesRead(uint64_t bytes) {
+    bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // Not thread-safe.
+  void SetSize(const std::string& key, uint64_t value);
+
+ private:
+  StageMetrics metrics_;
+  std::chrono::steady_clock::time_point wall_start_;
+  double cpu_start_;
+  std::atomic<uint64_t> num_objects_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+};
+
+// Counts the objects that go through osmium::apply().
+class ObjectCountHandler : public osmium::handler::Handler {
+ public:
+  void node(const osmium::Node&) {
+    ++count;
+  }
+
+  void way(const osmium::Way&) {
+    ++count;
+  }
+
+  uint64_t Count() const {
+    return count;
+  }
+
+ private:
+  uint64_t count = 0;
+};
+
+// User plus system CPU time of the process, in seconds.
+double ProcessCpuSeconds();
+
+// The resident set size of the process right now.
+uint64_t CurrentRssBytes();
+
+// The high-water mark of the resident set size since the last ResetPeakRss(),
+// or since the process started.
+uint64_t PeakRssBytes();
+
+// Resets the high-water mark to the current resident set size, through
+// /proc/self/clear_refs. Returns false if the kernel does not support it.
+bool ResetPeakRss();
+
+// The high-water mark of the resident set size over the whole process, which
+// survives the resets done by the stages.
+uint64_t ProcessPeakRssBytes();
+
+}  // namespace open_semap
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace open_semap {
+
+// Runs tasks on a fixed pool of worker threads while handing their results to
+// the consumer in the order in which the tasks are submitted. At most twice as
+// many tasks as workers are running, waiting to run or waiting to be consumed
+// at any time, which bounds the memory held by the pending results and keeps
+// the workers busy while the consumer is.
+//
+// Typical use is to process the buffers of an osmium::io::Reader in parallel
+// and feed the results to an osmium::io::Writer in the original order.
+//
+// Submit() and Drain() must be called from the same thread, which is also the
+// thread that runs the consumer. An exception thrown by a task is rethrown
+// from the Submit() or Drain() that consumes its result.
+template <typename TResult>
+class OrderedTaskQueue {
+ public:
+  // With `num_threads` of 0 or 1, tasks run synchronously in Submit() and no
+  // thread is started.
+  OrderedTaskQueue(int num_threads, std::function<void(TResult&&)> consume)
+      : max_in_flight_(num_threads <= 1 ? 1 : 2 * static_cast<size_t>(num_threads)),
+        consume_(std::move(consume)) {
+    if (num_threads <= 1) {
+      return;
+    }
+    for (int i = 0; i < num_threads; ++i) {
+      workers_.emplace_back([this]() { RunWorker(); });
+    }
+  }
+
+  OrderedTaskQueue(const OrderedTaskQueue&) = delete;
+  OrderedTaskQueue& operator=(const OrderedTaskQueue&) = delete;
+
+  // Does not consume the pending results, so that an exception of a task is
+  // never rethrown from here, e.g. while the stack unwinds. Call Drain() first
+  // to keep them. The tasks that have not started are dropped, and the running
+  // ones are waited for.
+  ~OrderedTaskQueue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+      tasks_.clear();
+    }
+    ready_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  template <typename TTask>
+  void Submit(TTask&& task) {
+    if (workers_.empty()) {
+      consume_(task());
+      return;
+    }
+    while (pending_.size() >= max_in_flight_) {
+      ConsumeFront();
+    }
+    std::packaged_task<TResult()> packaged(std::forward<TTask>(task));
+    pending_.emplace_back(packaged.get_future());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace_back(std::move(packaged));
+    }
+    ready_.notify_one();
+  }
+
+  // Waits for all the submitted tasks and consumes their results.
+  void Drain() {
+    while (!pending_.empty()) {
+      ConsumeFront();
+    }
+  }
+
+ private:
+  void RunWorker() {
+    while (true) {
+      std::packaged_task<TResult()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+        if (stopped_) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      // Any exception is stored in the future.
+      task();
+    }
+  }
+
+  void ConsumeFront() {
+    std::future<TResult> front = std::move(pending_.front());
+    pending_.pop_front();
+    consume_(front.get());
+  }
+
+  size_t max_in_flight_;
+  std::function<void(TResult&&)> consume_;
+  // The results, in the order of submission.
+  std::deque<std::future<TResult>> pending_{};
+
+  std::mutex mutex_{};
+  std::condition_variable ready_{};
+  // The tasks that no worker has picked up yet, guarded by mutex_.
+  std::deque<std::packaged_task<TResult()>> tasks_{};
+  bool stopped_ = false;
+  std::vector<std::thread> workers_{};
+};
+
+}  // namespace open_semap
@@ -0,0 +1,353 @@
+#include "utils/routing_profile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include "spdlog/spdlog.h"
+
+namespace open_semap {
+
+namespace {
+
+constexpr char kDefaultProfile[] =
+    "name default\n"
+    "allow highway *\n"
+    "deny highway footway service\n"
+    "speed 110 motorway\n"
+    "speed 90 trunk\n"
+    "speed 65 primary\n"
+    "speed 55 secondary\n"
+    "speed 45 tertiary motorway_link trunk_link\n"
+    "speed 40 unclassified primary_link secondary_link tertiary_link\n"
+    "speed 25 residential road\n"
+    "speed 10 living_street track\n";
+
+std::unique_ptr<RoutingProfile> active_profile{};
+
+}  // namespace
+
+PerfectHashTable::PerfectHashTable(const std::vector<std::string>& keys) : keys_(keys) {
+  std::vector<std::string> sorted = keys_;
+  std::sort(sorted.begin(), sorted.end());
+  auto duplicate = std::adjacent_find(sorted.begin(), sorted.end());
+  if (duplicate != sorted.end()) {
+    // Otherwise the seed search below would never end.
+    spdlog::critical("PerfectHashTable: the key \"{}\" appears more than once.",
+                     *duplicate);
+    std::abort();
+  }
+
+  first_byte_keys_.fill(kNoKey);
+  for (size_t i = 0; i < keys_.size(); ++i) {
+    int32_t& entry = first_byte_keys_[static_cast<uint8_t>(keys_[i].c_str()[0])];
+    entry          = entry == kNoKey ? static_cast<int32_t>(i) : kSharedFirstByte;
+  }
+
+  if (keys_.size() <= kMaxLinearKeys) {
+    return;
+  }
+
+  size_t num_slots = 1;
+  while (num_slots < keys_.size() * 2) {
+    num_slots <<= 1;
+  }
+
+  // With a load factor of at most 1/2, a collision free seed is usually found
+  // within a few hundred attempts for the tens of values in a profile. Grow
+  // the table if it is not.
+  constexpr uint32_t kMaxAttempts = 4096;
+  while (true) {
+    for (uint32_t seed = 0; seed < kMaxAttempts; ++seed) {
+      slots_.assign(num_slots, -1);
+      bool success = true;
+      for (size_t i = 0; i < keys_.size(); ++i) {
+        size_t length = 0;
+        uint32_t slot = Hash(keys_[i].c_str(), seed, &length) & (num_slots - 1);
+        if (slots_[slot] >= 0) {
+          success = false;
+          break;
+        }
+        slots_[slot] = static_cast<int32_t>(i);
+      }
+      if (success) {
+        seed_ = seed;
+        mask_ = static_cast<uint32_t>(num_slots - 1);
+        return;
+      }
+    }
+    num_slots <<= 1;
+  }
+}
+
+uint32_t PerfectHashTable::Hash(const char* text, uint32_t seed, size_t* length) {
+  // FNV-1a, with the seed mixed into the offset basis.
+  uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+  const char* p = text;
+  for (; *p != '\0'; ++p) {
+    hash ^= static_cast<uint8_t>(*p);
+    hash *= 16777619u;
+  }
+  *length = static_cast<size_t>(p - text);
+  return hash ^ (hash >> 15);
+}
+
+int PerfectHashTable::FindShared(const char* text) const {
+  if (keys_.size() <= kMaxLinearKeys) {
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (std::strcmp(keys_[i].c_str(), text) == 0) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+  size_t length = 0;
+  int32_t index = slots_[Hash(text, seed_, &length) & mask_];
+  if (index < 0) {
+    return -1;
+  }
+  const std::string& key = keys_[index];
+  if (key.size() != length || std::memcmp(key.data(), text, length) != 0) {
+    return -1;
+  }
+  return index;
+}
+
+std::unique_ptr<RoutingProfile> RoutingProfile::Parse(const std::string& text) {
+  struct RawRule {
+    bool allow_any = false;
+    bool deny_any  = false;
+    // Ordered, so that the compiled tables do not depend on the hash order.
+    std::map<std::string, Verdict> verdicts{};
+  };
+  std::map<std::string, RawRule> raw_rules;
+  std::map<std::string, double> raw_speeds;
+  std::unique_ptr<RoutingProfile> profile(new RoutingProfile());
+
+  std::istringstream input(text);
+  std::string line;
+  for (int line_number = 1; std::getline(input, line); ++line_number) {
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+    std::istringstream tokens(line);
+    std::string directive;
+    if (!(tokens >> directive)) {
+      continue;
+    }
+
+    if (directive == "name") {
+      if (!(tokens >> profile->name_)) {
+        spdlog::critical("Profile line {}: missing the name.", line_number);
+        return nullptr;
+      }
+      continue;
+    }
+
+    if (directive == "speed") {
+      double speed = 0.0;
+      std::vector<std::string> values;
+      std::string value;
+      tokens >> speed;
+      while (tokens >> value) {
+        values.emplace_back(std::move(value));
+      }
+      if (!(speed > 0.0) || values.empty()) {
+        spdlog::critical("Profile line {}: expect \"speed KMH VALUE...\".", line_number);
+        return nullptr;
+      }
+      for (const std::string& v : values) {
+        if (v == "*") {
+          profile->default_speed_ = speed;
+        } else {
+          raw_speeds[v] = speed;
+        }
+      }
+      continue;
+    }
+
+    if (directive != "allow" && directive != "deny") {
+      spdlog::critical("Profile line {}: unknown directive \"{}\".", line_number,
+                       directive);
+      return nullptr;
+    }
+
+    std::string key;
+    std::vector<std::string> values;
+    std::string value;
+    tokens >> key;
+    while (tokens >> value) {
+      values.emplace_back(std::move(value));
+    }
+    if (key.empty() || values.empty()) {
+      spdlog::critical("Profile line {}: expect \"{} KEY VALUE...\".", line_number,
+                       directive);
+      return nullptr;
+    }
+
+    RawRule& rule = raw_rules[key];
+    for (const std::string& v : values) {
+      if (directive == "allow") {
+        if (v == "*") {
+          rule.allow_any = true;
+        } else {
+          // Deny wins over allow.
+          rule.verdicts.emplace(v, Verdict::kAllow);
+        }
+      } else {
+        if (v == "*") {
+          rule.deny_any = true;
+        } else {
+          rule.verdicts[v] = Verdict::kDeny;
+        }
+      }
+    }
+  }
+
+  if (raw_rules.size() > kMaxKeys) {
+    spdlog::critical("Profile {} has {} keys, at most {} are supported.", profile->name_,
+                     raw_rules.size(), kMaxKeys);
+    return nullptr;
+  }
+
+  // Compile.
+  std::vector<std::string> keys;
+  for (const auto& entry : raw_rules) {
+    const RawRule& raw = entry.second;
+    KeyRule rule;
+    rule.allow_any = raw.allow_any;
+    rule.deny_any  = raw.deny_any;
+    std::vector<std::string> values;
+    for (const auto& verdict : raw.verdicts) {
+      values.emplace_back(verdict.first);
+      rule.verdicts.emplace_back(verdict.second);
+      if (verdict.second == Verdict::kAllow) {
+        rule.required = true;
+      }
+    }
+    rule.required = rule.required || rule.allow_any;
+    rule.values   = PerfectHashTable(values);
+    if (rule.required) {
+      profile->required_mask_ |= uint64_t{1} << keys.size();
+    }
+    keys.emplace_back(entry.first);
+    profile->rules_.emplace_back(std::move(rule));
+  }
+  profile->keys_ = PerfectHashTable(keys);
+
+  std::vector<std::string> speed_classes;
+  for (const auto& entry : raw_speeds) {
+    speed_classes.emplace_back(entry.first);
+    profile->speeds_.emplace_back(entry.second);
+  }
+  profile->speed_classes_ = PerfectHashTable(speed_classes);
+
+  return profile;
+}
+
+std::unique_ptr<RoutingProfile> RoutingProfile::LoadFromFile(const std::string& path) {
+  std::ifstream input(path);
+  if (!input) {
+    spdlog::critical("Cannot open the profile {}.", path);
+    return nullptr;
+  }
+  std::stringstream buffer;
+  buffer << input.rdbuf();
+  std::unique_ptr<RoutingProfile> profile = Parse(buffer.str());
+  if (profile != nullptr) {
+    spdlog::info("Loaded the routing profile \"{}\" from {}.", profile->name(), path);
+  }
+  return profile;
+}
+
+const RoutingProfile& RoutingProfile::Default() {
+  static const std::unique_ptr<RoutingProfile> profile = Parse(kDefaultProfile);
+  return *profile;
+}
+
+bool RoutingProfile::Accepts(const osmium::TagList& tags) const {
+  uint64_t satisfied = 0;
+  // The keys of an OSM object are unique, so the tags after the last key of
+  // the profile cannot change the verdict.
+  size_t num_found = 0;
+  for (const osmium::Tag& tag : tags) {
+    if (num_found == keys_.size()) {
+      break;
+    }
+    int k = keys_.Find(tag.key());
+    if (k < 0) {
+      continue;
+    }
+    ++num_found;
+    const KeyRule& rule = rules_[k];
+    if (rule.deny_any) {
+      return false;
+    }
+    int v = rule.values.Find(tag.value());
+    if (v >= 0 && rule.verdicts[v] == Verdict::kDeny) {
+      return false;
+    }
+    if (rule.allow_any || v >= 0) {
+      satisfied |= uint64_t{1} << k;
+    }
+  }
+  return (satisfied & required_mask_) == required_mask_;
+}
+
+double RoutingProfile::Speed(const osmium::TagList& tags) const {
+  double speed        = default_speed_;
+  const char* highway = tags["highway"];
+  if (highway != nullptr) {
+    int index = speed_classes_.Find(highway);
+    if (index >= 0) {
+      speed = speeds_[index];
+    }
+  }
+  const char* maxspeed = tags["maxspeed"];
+  if (maxspeed != nullptr) {
+    double limit = ParseMaxSpeed(maxspeed);
+    if (limit > 0.0 && limit < speed) {
+      speed = limit;
+    }
+  }
+  return speed;
+}
+
+double ParseMaxSpeed(const char* text) {
+  char* end    = nullptr;
+  double value = std::strtod(text, &end);
+  if (end == text || !(value > 0.0)) {
+    return 0.0;
+  }
+  while (*end == ' ') {
+    ++end;
+  }
+  if (*end == '\0') {
+    return value;
+  }
+  if (std::strcmp(end, "mph") == 0) {
+    return value * 1.609344;
+  }
+  if (std::strcmp(end, "knots") == 0) {
+    return value * 1.852;
+  }
+  if (std::strcmp(end, "km/h") == 0 || std::strcmp(end, "kmh") == 0) {
+    return value;
+  }
+  return 0.0;
+}
+
+const RoutingProfile& ActiveProfile() {
+  return active_profile != nullptr ? *active_profile : RoutingProfile::Default();
+}
+
+void SetActiveProfile(std::unique_ptr<RoutingProfile>&& profile) {
+  active_profile = std::move(profile);
+}
+
+}  // namespace open_semap
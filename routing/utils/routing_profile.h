@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "osmium/osm.hpp"
+
+namespace open_semap {
+
+// Maps a fixed set of strings to their indices. The hash seed is searched when
+// the table is built so that no two strings share a slot, hence a lookup costs
+// one pass over the queried string and at most one comparison.
+//
+// Cheaper paths come first, as a hash costs more than a comparison or two and
+// most lookups on a way are misses. The first byte of the string picks the
+// only key that starts with it, which is compared with strcmp(), or rejects
+// the string if no key starts with it. Only the strings whose first byte
+// starts several keys are hashed, or scanned with strcmp() on a table of at
+// most kMaxLinearKeys strings.
+class PerfectHashTable {
+ public:
+  PerfectHashTable() {
+    first_byte_keys_.fill(kNoKey);
+  }
+
+  // The keys must be distinct, since no seed can separate equal keys.
+  explicit PerfectHashTable(const std::vector<std::string>& keys);
+
+  // Returns the index of the string in the keys, or -1 if it is not one of
+  // them.
+  // The first byte paths are inlined, since they answer most lookups.
+  inline int Find(const char* text) const {
+    int32_t candidate = first_byte_keys_[static_cast<uint8_t>(text[0])];
+    if (candidate == kNoKey) {
+      return -1;
+    }
+    if (candidate >= 0) {
+      return std::strcmp(keys_[candidate].c_str(), text) == 0 ? candidate : -1;
+    }
+    return FindShared(text);
+  }
+
+  inline size_t size() const {
+    return keys_.size();
+  }
+
+ private:
+  static constexpr size_t kMaxLinearKeys = 2;
+
+  // The entries of first_byte_keys_ that are not key indices.
+  static constexpr int32_t kNoKey          = -1;
+  static constexpr int32_t kSharedFirstByte = -2;
+
+  static uint32_t Hash(const char* text, uint32_t seed, size_t* length);
+
+  // Find() for the strings whose first byte starts several keys.
+  int FindShared(const char* text) const;
+
+  uint32_t seed_ = 0;
+  uint32_t mask_ = 0;
+  // The index of the only key starting with each byte, or one of the two
+  // constants above.
+  std::array<int32_t, 256> first_byte_keys_{};
+  std::vector<int32_t> slots_{-1};
+  std::vector<std::string> keys_{};
+};
+
+// A declarative description of the ways that count as roads, so that car,
+// bike and pedestrian graphs can be built without recompiling. A profile is a
+// text file with one directive per line:
+//
+//   # Comments start with '#'.
+//   name car
+//   allow highway motorway trunk primary secondary residential
+//   deny access no private
+//   speed 110 motorway
+//   speed 50 *
+//
+// - "allow KEY VALUE..." requires the way to have the tag KEY, with one of the
+//   listed values. "*" stands for any value.
+// - "deny KEY VALUE..." rejects the way if its tag KEY has one of the listed
+//   values. "*" stands for any value. Deny wins over allow.
+// - "speed KMH VALUE..." sets the speed on the roads whose highway tag has one
+//   of the listed values. "*" stands for any other road. Roads that no speed
+//   directive covers are travelled at kDefaultSpeed. The maxspeed tag of a road
+//   caps its speed.
+//
+// Directives on the same key accumulate. The profile is compiled into perfect
+// hash tables over the keys and the values, so that checking a way costs at
+// most one lookup per tag instead of a chain of strcmp calls. That is not
+// faster on the default profile, only on par with the two strcmp calls it
+// replaces. It pays off on profiles that list more values, e.g. the car profile
+// in profile_benchmark checks a way about 1.7x faster than its strcmp chain.
+class RoutingProfile {
+ public:
+  static constexpr size_t kMaxKeys = 64;
+
+  // In km/h.
+  static constexpr double kDefaultSpeed = 30.0;
+
+  // Returns nullptr, after logging the reason, if the text is malformed.
+  static std::unique_ptr<RoutingProfile> Parse(const std::string& text);
+
+  static std::unique_ptr<RoutingProfile> LoadFromFile(const std::string& path);
+
+  // Any highway except footways and service roads, which is what
+  // predicate::IsValidRoad() used to hard-code.
+  static const RoutingProfile& Default();
+
+  bool Accepts(const osmium::TagList& tags) const;
+
+  inline bool Accepts(const osmium::Way& way) const {
+    return Accepts(way.tags());
+  }
+
+  // The speed in km/h on a road with the tags.
+  double Speed(const osmium::TagList& tags) const;
+
+  inline double Speed(const osmium::Way& way) const {
+    return Speed(way.tags());
+  }
+
+  inline const std::string& name() const {
+    return name_;
+  }
+
+ private:
+  enum class Verdict : uint8_t { kAllow, kDeny };
+
+  struct KeyRule {
+    // True if there is at least one allow directive on the key.
+    bool required  = false;
+    bool allow_any = false;
+    bool deny_any  = false;
+    PerfectHashTable values{};
+    std::vector<Verdict> verdicts{};
+  };
+
+  RoutingProfile() = default;
+
+  std::string name_ = "unnamed";
+  PerfectHashTable keys_{};
+  std::vector<KeyRule> rules_{};
+  // Bit i is set if the i-th key is required.
+  uint64_t required_mask_ = 0;
+  // The speeds of the highway values in speed_classes_.
+  PerfectHashTable speed_classes_{};
+  std::vector<double> speeds_{};
+  double default_speed_ = kDefaultSpeed;
+};
+
+// Parses the maxspeed tag of OSM, e.g. "50", "30 mph" or "10 knots", into km/h.
+// Returns 0 if the value is not a number, e.g. "none", "signals" or "DE:urban".
+double ParseMaxSpeed(const char* text);
+
+// The profile used by predicate::IsValidRoad(). It is RoutingProfile::Default()
+// unless replaced by SetActiveProfile().
+const RoutingProfile& ActiveProfile();
+
+// Not thread-safe, call it before the extraction starts.
+void SetActiveProfile(std::unique_ptr<RoutingProfile>&& profile);
+
+}  // namespace open_semap
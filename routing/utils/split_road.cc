@@ -1,8 +1,13 @@
 #include "utils/split_road.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
 #include <vector>
 
 #include "osmium/builder/osm_object_builder.hpp"
+#include "osmium/geom/haversine.hpp"
 #include "osmium/io/pbf_input.hpp"
 #include "osmium/io/pbf_output.hpp"
 #include "osmium/io/reader_with_progress_bar.hpp"
@@ -11,12 +16,82 @@
 #include "osmium/visitor.hpp"
 #include "spdlog/spdlog.h"
 
+#include "utils/metrics.h"
+#include "utils/ordered_task_queue.h"
+
 namespace open_semap {
 
+namespace {
+
+using LocationList =
+    std::vector<std::pair<osmium::unsigned_object_id_type, osmium::Location>>;
+
+// Records the locations of the useful nodes, in the order they appear.
+class NodeLocationRecorder : public osmium::handler::Handler {
+ public:
+  NodeLocationRecorder(const IdSet& useful_nodes_, LocationList& result_)
+      : useful_nodes(useful_nodes_), result(result_) {
+  }
+
+  void node(const osmium::Node& node) {
+    if (useful_nodes.get().count(node.id()) > 0) {
+      result.get().emplace_back(static_cast<osmium::unsigned_object_id_type>(node.id()),
+                                node.location());
+    }
+  }
+
+ private:
+  std::reference_wrapper<const IdSet> useful_nodes;
+  std::reference_wrapper<LocationList> result;
+};
+
+// The "length" tag, in meters.
+constexpr const char* kLengthFormat = "%.3f";
+
+struct SplitResult {
+  osmium::memory::Buffer output_buffer;
+  LocationList locations;
+};
+
+}  // namespace
+
+bool BufferHasWays(const osmium::memory::Buffer& buffer) {
+  for (const auto& entity : buffer) {
+    if (entity.type() == osmium::item_type::way) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double RoundLength(double length) {
+  char text[32];
+  std::snprintf(text, sizeof(text), kLengthFormat, length);
+  return std::strtod(text, nullptr);
+}
+
+void WriteRoadNode(osmium::object_id_type id, osmium::user_id_type uid,
+                   const osmium::Location& location, const IdSet& junctions,
+                   const IdSet& useful_nodes, osmium::memory::Buffer* buffer) {
+  if (junctions.count(id) > 0) {
+    osmium::builder::NodeBuilder builder(*buffer);
+    builder.set_id(id).set_uid(uid).set_location(location);
+    osmium::builder::TagListBuilder tag_builder(builder);
+    tag_builder.add_tag("junction", "yes");
+    tag_builder.add_tag("vertex", "yes");
+  } else if (useful_nodes.count(id) > 0) {
+    osmium::builder::NodeBuilder builder(*buffer);
+    builder.set_id(id).set_uid(uid).set_location(location);
+    osmium::builder::TagListBuilder tag_builder(builder);
+    tag_builder.add_tag("junction", "no");
+    tag_builder.add_tag("vertex", "no");
+  }
+  buffer->commit();
+}
+
 void SplitRoad(const std::string& path, const std::string& output_path,
-               const std::unordered_set<osmium::object_id_type>& junctions,
-               const std::unordered_set<osmium::object_id_type>& roads,
-               const std::unordered_set<osmium::object_id_type>& useful_nodes) {
+               const IdSet& junctions, const IdSet& roads, const IdSet& useful_nodes,
+               int num_threads) {
   spdlog::info("Splitting roads and generating routing graph.");
   osmium::io::File input_file(path);
   // Process both ways and nodes.
@@ -28,34 +103,95 @@ void SplitRoad(const std::string& path, const std::string& output_path,
   header.set("generator", "routing_graph");
   osmium::io::Writer writer(output_path, header, osmium::io::overwrite::allow);
 
+  // Node locations are collected (in order) until the first way shows up,
+  // and are read only afterwards.
+  NodeLocations locations;
+  bool ways_started = false;
+
+  ScopedStage stage("split_road");
+  stage.SetSize("threads", static_cast<uint64_t>(std::max(num_threads, 1)));
+
+  OrderedTaskQueue<SplitResult> queue(
+      num_threads, [&writer, &locations, &ways_started](SplitResult&& result) {
+        if (!ways_started) {
+          for (const auto& item : result.locations) {
+            locations.set(item.first, item.second);
+          }
+        }
+        writer(std::move(result.output_buffer));
+      });
+
   while (osmium::memory::Buffer input_buffer = reader.read()) {
-    // Allow output buffer to grow if needed.
-    osmium::memory::Buffer output_buffer(input_buffer.committed(),
-                                         osmium::memory::Buffer::auto_grow::yes);
-    SplitRoadHandler handler(junctions, roads, useful_nodes, output_buffer);
-    osmium::apply(input_buffer, handler);
-    writer(std::move(output_buffer));
+    if (!ways_started && BufferHasWays(input_buffer)) {
+      // All the preceding node buffers need to be recorded before any way is
+      // split.
+      queue.Drain();
+      // This buffer may contain nodes as well (e.g. from XML input).
+      LocationList remaining;
+      NodeLocationRecorder recorder(useful_nodes, remaining);
+      osmium::apply(input_buffer, recorder);
+      for (const auto& item : remaining) {
+        locations.set(item.first, item.second);
+      }
+      locations.sort();
+      ways_started = true;
+      spdlog::info("Recorded the locations of {} nodes.", locations.size());
+    }
+
+    const NodeLocations* way_locations = ways_started ? &locations : nullptr;
+    queue.Submit([&junctions, &roads, &useful_nodes, &stage, way_locations,
+                  input_buffer = std::move(input_buffer)]() mutable {
+      SplitResult result;
+      // Allow output buffer to grow if needed.
+      result.output_buffer = osmium::memory::Buffer(
+          input_buffer.committed(), osmium::memory::Buffer::auto_grow::yes);
+      SplitRoadHandler handler(junctions, roads, useful_nodes, result.output_buffer,
+                               way_locations);
+      ObjectCountHandler count;
+      if (way_locations == nullptr) {
+        NodeLocationRecorder recorder(useful_nodes, result.locations);
+        osmium::apply(input_buffer, handler, recorder, count);
+      } else {
+        osmium::apply(input_buffer, handler, count);
+      }
+      stage.AddObjects(count.Count());
+      return result;
+    });
   }
+  queue.Drain();
 
-  writer.close();
+  stage.AddBytesRead(reader.offset());
+  stage.SetSize("output_bytes", writer.close());
+  stage.SetSize("node_locations", locations.size());
   reader.close();
 }
 
 void SplitRoadHandler::node(const osmium::Node& node) {
-  if (junctions.get().count(node.id()) > 0) {
-    osmium::builder::NodeBuilder builder(output_buffer.get());
-    builder.set_id(node.id()).set_uid(node.uid()).set_location(node.location());
-    osmium::builder::TagListBuilder tag_builder(builder);
-    tag_builder.add_tag("junction", "yes");
-    tag_builder.add_tag("vertex", "yes");
-  } else if (useful_nodes.get().count(node.id()) > 0) {
-    osmium::builder::NodeBuilder builder(output_buffer.get());
-    builder.set_id(node.id()).set_uid(node.uid()).set_location(node.location());
-    osmium::builder::TagListBuilder tag_builder(builder);
-    tag_builder.add_tag("junction", "no");
-    tag_builder.add_tag("vertex", "no");
+  WriteRoadNode(node.id(), node.uid(), node.location(), junctions.get(),
+                useful_nodes.get(), &output_buffer.get());
+}
+
+bool SplitRoadHandler::ComputeLength(const osmium::Way& way, size_t begin, size_t end,
+                                     double* length) const {
+  if (locations == nullptr) {
+    return false;
   }
-  output_buffer.get().commit();
+
+  osmium::Location prev_loc;
+  for (size_t j = begin; j <= end; ++j) {
+    osmium::Location loc = locations->get_noexcept(
+        static_cast<osmium::unsigned_object_id_type>(way.nodes()[j].ref()));
+    if (!loc.valid()) {
+      spdlog::warn("Cannot find the location of node {}, skip the length of way {}.",
+                   way.nodes()[j].ref(), way.id());
+      return false;
+    }
+    if (j > begin) {
+      *length += osmium::geom::haversine::distance(prev_loc, loc);
+    }
+    prev_loc = loc;
+  }
+  return true;
 }
 
 void SplitRoadHandler::way(const osmium::Way& way) {
@@ -63,8 +199,9 @@ void SplitRoadHandler::way(const osmium::Way& way) {
     return;
   }
 
-  const char* highway = way.tags()["highway"];
-  const char* name    = way.tags()["name"];
+  const char* highway  = way.tags()["highway"];
+  const char* name     = way.tags()["name"];
+  const char* maxspeed = way.tags()["maxspeed"];
 
   std::vector<size_t> vertex_indices;
   vertex_indices.reserve(way.nodes().size());
@@ -75,10 +212,17 @@ void SplitRoadHandler::way(const osmium::Way& way) {
     }
   }
 
+  const size_t max_vertices = static_cast<size_t>(kMaxSegmentsPerWay) + 1;
+  if (vertex_indices.size() > max_vertices) {
+    spdlog::critical("Way {} has {} junctions, only the first {} segments are kept.",
+                     way.id(), vertex_indices.size(), kMaxSegmentsPerWay);
+    vertex_indices.resize(max_vertices);
+  }
+
   for (size_t i = 0; i + 1 < vertex_indices.size(); ++i) {
     osmium::builder::WayBuilder builder(output_buffer.get());
-    // NOTE: new_way_id is atomic.
-    osmium::object_id_type way_id = new_way_id++;
+    // The uid of a split road is its own ID.
+    osmium::object_id_type way_id = SplitWayId(way.id(), i);
     builder.set_id(way_id).set_uid(way_id);
 
     // Add nodes
@@ -89,11 +233,21 @@ void SplitRoadHandler::way(const osmium::Way& way) {
       }
     }
 
-    // Add highway tag and from/to tag
+    // Add highway tag and from/to tag. The maxspeed tag caps the speed of the
+    // profile when the graph is loaded.
     {
       osmium::builder::TagListBuilder tag_builder(builder);
       tag_builder.add_tag("highway", highway == nullptr ? "road" : highway);
       tag_builder.add_tag("name", name == nullptr ? "NONAME Rd" : name);
+      if (maxspeed != nullptr) {
+        tag_builder.add_tag("maxspeed", maxspeed);
+      }
+      double length = 0.0;
+      if (ComputeLength(way, vertex_indices[i], vertex_indices[i + 1], &length)) {
+        char text[32];
+        std::snprintf(text, sizeof(text), kLengthFormat, length);
+        tag_builder.add_tag("length", text);
+      }
     }
   }
 
@@ -1,14 +1,15 @@
 #pragma once
 
-#include <atomic>
 #include <functional>
 #include <string>
-#include <unordered_set>
 
 #include "osmium/handler.hpp"
+#include "osmium/index/map/sparse_mem_array.hpp"
 #include "osmium/memory/buffer.hpp"
 #include "osmium/osm.hpp"
 
+#include "utils/id_set.h"
+
 namespace open_semap {
 
 // Main API of this library. Given the junction nodes and the roads,
@@ -20,22 +21,72 @@ namespace open_semap {
 // 2. The resulting graph will have junctions as the vertex and the
 //    split roads as the edges.
 //
-// 3. The length of the split roads will be written.
+// 3. The length of the split roads will be written, as the "length" tag in
+//    meters. The nodes must come before the ways in the input (which is the
+//    case for the files distributed by OSM) for the lengths to be computed.
+//
+// 4. The ID of a split road is derived from the ID of the original road and
+//    the index of the segment, see SplitWayId().
+//
+// When `num_threads` is greater than 1, the input buffers are split on that
+// many threads, and the output buffers are written in the input order. The
+// output does not depend on the number of threads.
 void SplitRoad(const std::string& path, const std::string& output_path,
-               const std::unordered_set<osmium::object_id_type>& junctions,
-               const std::unordered_set<osmium::object_id_type>& roads,
-               const std::unordered_set<osmium::object_id_type>& useful_nodes);
+               const IdSet& junctions, const IdSet& roads, const IdSet& useful_nodes,
+               int num_threads = 1);
+
+// Locations of the useful nodes, which are needed to compute the lengths of
+// the split roads. It is a sorted flat array, which is safe to be read by
+// multiple threads once sorted.
+using NodeLocations =
+    osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+// Returns true if the buffer contains at least one way.
+bool BufferHasWays(const osmium::memory::Buffer& buffer);
+
+// Writes the node into the buffer, tagged as a vertex if it is a junction, or
+// as a plain node if it is only useful. Other nodes are dropped. Shared by
+// SplitRoadHandler and the fused pipeline, so that both write the same nodes.
+void WriteRoadNode(osmium::object_id_type id, osmium::user_id_type uid,
+                   const osmium::Location& location, const IdSet& junctions,
+                   const IdSet& useful_nodes, osmium::memory::Buffer* buffer);
+
+// The length of a split road as RoadGraph::LoadFromFile() reads it back from
+// the "length" tag, i.e. rounded to the millimeter. Whatever builds edges
+// without going through the tag rounds with it, so that the weights match.
+double RoundLength(double length);
+
+// OSM limits a way to 2000 nodes, so a way cannot be split into more than this
+// many segments.
+constexpr osmium::object_id_type kMaxSegmentsPerWay = 2048;
+
+// The ID of the `segment_index`-th split road of the original road. It is
+// collision free and does not depend on the processing order.
+inline osmium::object_id_type SplitWayId(osmium::object_id_type source_way_id,
+                                         size_t segment_index) {
+  return source_way_id * kMaxSegmentsPerWay +
+         static_cast<osmium::object_id_type>(segment_index);
+}
+
+// Inverse of SplitWayId(), gives the ID of the original road.
+inline osmium::object_id_type SourceWayId(osmium::object_id_type split_way_id) {
+  osmium::object_id_type source = split_way_id / kMaxSegmentsPerWay;
+  // Round towards negative infinity for negative IDs.
+  return split_way_id % kMaxSegmentsPerWay < 0 ? source - 1 : source;
+}
 
 class SplitRoadHandler : public osmium::handler::Handler {
  public:
-  using IdSet = std::unordered_set<osmium::object_id_type>;
-
+  // The lengths of the split roads are only written when `locations_` is
+  // provided.
   SplitRoadHandler(const IdSet& junctions_, const IdSet& approved_roads_,
-                   const IdSet& useful_nodes_, osmium::memory::Buffer& output_buffer_)
+                   const IdSet& useful_nodes_, osmium::memory::Buffer& output_buffer_,
+                   const NodeLocations* locations_ = nullptr)
       : junctions(junctions_),
         approved_roads(approved_roads_),
         useful_nodes(useful_nodes_),
-        output_buffer(output_buffer_) {
+        output_buffer(output_buffer_),
+        locations(locations_) {
   }
 
   void node(const osmium::Node& node);
@@ -43,11 +94,16 @@ class SplitRoadHandler : public osmium::handler::Handler {
   void way(const osmium::Way& way);
 
  private:
+  // Computes the length of the part of the way between the two node indices
+  // (inclusive). Returns false if any of the locations is missing.
+  bool ComputeLength(const osmium::Way& way, size_t begin, size_t end,
+                     double* length) const;
+
   std::reference_wrapper<const IdSet> junctions;
   std::reference_wrapper<const IdSet> approved_roads;
   std::reference_wrapper<const IdSet> useful_nodes;
   std::reference_wrapper<osmium::memory::Buffer> output_buffer;
-  std::atomic<osmium::object_id_type> new_way_id = 1;
+  const NodeLocations* locations;
 };
 
 }  // namespace open_semap